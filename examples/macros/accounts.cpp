@@ -0,0 +1,43 @@
+#include <unittest/unittest.h>
+#include <vector>
+
+UT_FIXTURE(Accounts)
+	int balance;
+	std::vector<int> history;
+
+	UT_SETUP_TEST
+		balance = 100;
+		history.clear();
+	UT_SETUP_TEST_END
+
+	UT_TEST(deposit)
+		balance += 50;
+		history.push_back(50);
+		UT_ASSERT_EQUALS(balance, 150);
+		UT_ASSERT_EQUALS(history.size(), 1u);
+	UT_TEST_END
+
+	UT_TEST(withdraw)
+		balance -= 20;
+		UT_ASSERT_EQUALS(balance, 80);
+	UT_TEST_END
+UT_FIXTURE_END
+
+UT_FIXTURE(Fresh)
+	UT_FRESH_FIXTURE
+	int calls;
+
+	UT_SETUP_FIXTURE
+		calls = 0;
+	UT_SETUP_FIXTURE_END
+
+	UT_TEST(first)
+		UT_ASSERT_EQUALS(++calls, 1);
+	UT_TEST_END
+
+	UT_TEST(second)
+		UT_ASSERT_EQUALS(++calls, 1);
+	UT_TEST_END
+UT_FIXTURE_END
+
+UT_MAIN()
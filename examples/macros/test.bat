@@ -0,0 +1,22 @@
+@echo off
+rem Fixtures written with the macros alone are built without the script.
+del run_tests.exe 2>nul
+g++ -I../../include accounts.cpp -o run_tests.exe -lpthread
+if errorlevel 1 exit /b 1
+
+set failed=0
+
+run_tests.exe --list > list.txt
+findstr /b /c:"Fresh::second" list.txt >nul && echo ok: --list names every test || (echo FAILED: --list names every test& set failed=1)
+
+run_tests.exe --list --tests=Accounts > list.txt
+findstr /b /c:"Fresh" list.txt >nul && (echo FAILED: --list --tests=Accounts lists Fresh& set failed=1) || echo ok: --list --tests=Accounts
+
+run_tests.exe --tests=Accounts::withdraw > run.txt
+findstr /b /c:"1 passes" run.txt >nul && echo ok: --tests=Accounts::withdraw runs one test || (echo FAILED: --tests=Accounts::withdraw runs one test& set failed=1)
+
+run_tests.exe > run.txt
+findstr /b /c:"0 failures" run.txt >nul && echo ok: every test passes || (echo FAILED: every test passes& set failed=1)
+
+del list.txt run.txt
+exit /b %failed%
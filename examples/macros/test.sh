@@ -0,0 +1,22 @@
+#!/bin/sh
+# Fixtures written with the macros alone are built without the script.
+rm -f run_tests
+g++ -I../../include accounts.cpp -o run_tests -pthread -ldl -lrt || exit 1
+
+failed=0
+expect() { if grep -q "$1" "$2"; then echo "ok: $3"; else echo "FAILED: $3"; failed=1; fi; }
+
+./run_tests --list > list.txt
+expect "^Fresh::second$" list.txt "--list names every test"
+
+./run_tests --list --tests=Accounts > list.txt
+if grep -q "^Fresh" list.txt; then echo "FAILED: --list --tests=Accounts lists Fresh"; failed=1; else echo "ok: --list --tests=Accounts"; fi
+
+./run_tests --tests=Accounts::withdraw > run.txt
+expect "^1 passes" run.txt "--tests=Accounts::withdraw runs one test"
+
+./run_tests > run.txt
+expect "^0 failures" run.txt "every test passes"
+
+rm -f list.txt run.txt
+exit $failed
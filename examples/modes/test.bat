@@ -0,0 +1,35 @@
+@echo off
+rem Runs the tests in each of the modes, and checks that each does what it should.
+rem Some of the tests fail on purpose.  Journals are only kept on Unix.
+del run_tests.exe 2>nul
+python ../../scripts/unittest.py --build=windows --track-allocations modes.test
+call build_tests.bat
+if not exist run_tests.exe exit /b 1
+
+set failed=0
+
+rem The same seed gives the same order.
+run_tests.exe --tests=Order --shuffle --seed=7 | findstr /b /c:"ran" > first.txt
+run_tests.exe --tests=Order --shuffle --seed=7 | findstr /b /c:"ran" > second.txt
+fc /b first.txt second.txt >nul && echo ok: --shuffle --seed=7 runs in the same order || (echo FAILED: --shuffle --seed=7 runs in the same order& set failed=1)
+
+run_tests.exe --tests=Floating > run.txt
+findstr /b /c:"0 failures" run.txt >nul && echo ok: the ULP and array assertions pass || (echo FAILED: the ULP and array assertions pass& set failed=1)
+
+run_tests.exe --tests=Leaks --fail-leaks > run.txt
+findstr /c:"modes.test:47:1: no leaks failed : leaked 16 bytes" run.txt >nul && echo ok: --fail-leaks fails Leaks::leak || (echo FAILED: --fail-leaks fails Leaks::leak& set failed=1)
+
+run_tests.exe --tests=Flaky --repeat=6 > run.txt
+findstr /c:"Flaky::sometimes is flaky : failed 2 of 6 runs" run.txt >nul && echo ok: --repeat=6 finds Flaky::sometimes flaky || (echo FAILED: --repeat=6 finds Flaky::sometimes flaky& set failed=1)
+
+rem The counterexample is the failing case the search found, shrunk.
+for %%s in (1 2 3 5) do (
+   run_tests.exe --tests=Properties --property-threads=1 --property-seed=%%s > run.txt
+   findstr /c:"by a = 501, b = 901" run.txt >nul && echo ok: Properties::notBothLarge shrinks to a = 501, b = 901 with --property-seed=%%s || (echo FAILED: Properties::notBothLarge shrinks to a = 501, b = 901 with --property-seed=%%s& set failed=1)
+)
+
+run_tests.exe --tests=Golden > run.txt
+findstr /c:"'golden/report.txt' differs from line 2" run.txt >nul && echo ok: Golden::report does not match its golden file || (echo FAILED: Golden::report does not match its golden file& set failed=1)
+
+del first.txt second.txt run.txt
+exit /b %failed%
@@ -0,0 +1,42 @@
+#!/bin/sh
+# Runs the tests in each of the modes, and checks that each does what it should.
+# Some of the tests fail on purpose.
+rm -f run_tests run.journal
+python ../../scripts/unittest.py --build=unix --track-allocations modes.test
+sh build_tests.sh || exit 1
+
+failed=0
+expect() { if grep -q "$1" "$2"; then echo "ok: $3"; else echo "FAILED: $3"; failed=1; fi; }
+
+# The same seed gives the same order.
+./run_tests --tests=Order --shuffle --seed=7 | grep "^ran" > first.txt
+./run_tests --tests=Order --shuffle --seed=7 | grep "^ran" > second.txt
+if cmp -s first.txt second.txt; then echo "ok: --shuffle --seed=7 runs in the same order"; else echo "FAILED: --shuffle --seed=7 runs in the same order"; failed=1; fi
+
+./run_tests --tests=Floating > run.txt
+expect "^0 failures" run.txt "the ULP and array assertions pass"
+
+./run_tests --tests=Leaks --fail-leaks > run.txt
+expect "modes.test:47:1: no leaks failed : leaked 16 bytes" run.txt "--fail-leaks fails Leaks::leak"
+
+./run_tests --tests=Flaky --repeat=6 > run.txt
+expect "Flaky::sometimes is flaky : failed 2 of 6 runs" run.txt "--repeat=6 finds Flaky::sometimes flaky"
+
+# The counterexample is the failing case the search found, shrunk.
+for seed in 1 2 3 5; do
+   ./run_tests --tests=Properties --property-threads=1 --property-seed=$seed > run.txt
+   expect "by a = 501, b = 901" run.txt "Properties::notBothLarge shrinks to a = 501, b = 901 with --property-seed=$seed"
+done
+
+./run_tests --tests=Golden > run.txt
+expect "'golden/report.txt' differs from line 2" run.txt "Golden::report does not match its golden file"
+
+# The resumed run replays Floating and Order from the journal, and only runs Golden.
+./run_tests --journal=run.journal --tests=Floating,Order > run.txt
+./run_tests --resume=run.journal --tests=Floating,Order,Golden > run.txt
+if grep -q "^ran" run.txt; then echo "FAILED: --resume runs Order again"; failed=1; fi
+expect "^5 passes" run.txt "--resume replays the journaled fixtures"
+expect "^1 failures" run.txt "--resume runs the rest"
+
+rm -f first.txt second.txt run.txt run.journal
+exit $failed
@@ -0,0 +1,5 @@
+#!/bin/sh
+# Builds the Gtk+ outputter plugin loaded by test binaries run with --output=gtk.
+UNITTEST_INCLUDE_PATH="-I../../include"
+
+g++ -shared -fPIC $UNITTEST_INCLUDE_PATH `pkg-config --cflags gtk+-2.0` unittest_gtk.cpp `pkg-config --libs gtk+-2.0` -o libunittest_gtk.so
@@ -0,0 +1,11 @@
+// Gtk+ outputter plugin.  Build it with build_gtk_plugin.sh and put
+// libunittest_gtk.so next to the test binary (or on the library path), then
+// run the tests with --output=gtk.
+
+#include <unittest/gtk_outputter.h>
+
+extern "C" unittest::Listener *unittest_create_outputter(std::ostream * /*out*/)
+{
+   // Gtk+ is initialised by the outputter's own UI thread.
+   return new unittest::GtkOutputter;
+}
@@ -0,0 +1,278 @@
+#ifndef __TEST_ALLOCATIONS_H__
+#define __TEST_ALLOCATIONS_H__
+
+#include <new>
+#include <cstdlib>
+#include <string>
+#include <sstream>
+#include "config.h"
+#include "listener.h"
+#include "options.h"
+#include "instruments.h"
+
+namespace unittest
+{
+	/** The allocations made by one thread, kept by the operator new that
+	 * UT_TRACK_ALLOCATIONS puts in the test binary. */
+	struct AllocationCounters
+	{
+		/** Allocations made, and the bytes asked for. */
+		uint64_t count, bytes;
+
+		/** Bytes allocated and not yet freed by this thread, and the most
+		 * there have been since the current test started. */
+		int64_t live, peak;
+	};
+
+	/** Returns the counters of this thread.  They are plain data, so using
+	 * them from inside operator new is safe. */
+	inline AllocationCounters& allocationCounters()
+	{
+		static __thread AllocationCounters counters;
+		return counters;
+	}
+
+	/** Returns true once the tracking operator new is linked in. */
+	inline bool& allocationsTracked()
+	{
+		static bool tracked = false;
+		return tracked;
+	}
+
+	/** @brief Checks the allocations made by a block of code.
+	 *
+	 *  UT_ASSERT_MAX_ALLOCS runs its block in a for loop, so this is made
+	 * before the block and finish() is called once after it. */
+	class AllocationCheck
+	{
+		uint64_t limit, count, bytes;
+		bool done;
+
+	public:
+		AllocationCheck(uint64_t _limit):limit(_limit), done(false)
+		{
+			AllocationCounters &c = allocationCounters();
+			count = c.count;
+			bytes = c.bytes;
+		}
+
+		/** Returns true until the block has run once. */
+		bool running() const { return !done; }
+
+		/** Reports the event.  The message is taken as it is, so building it
+		 * is not counted. */
+		template<class M>
+		void finish(Event &e, Listener *listener, const char *source, const char *test, uint32_t line, const char *expr, const M &msg)
+		{
+			AllocationCounters &c = allocationCounters();
+			uint64_t made = c.count - count, size = c.bytes - bytes;
+
+			done = true;
+
+			e.pass = allocationsTracked() && made <= limit;
+			e.expr = expr;
+			e.msg = msg;
+			e.filename = source;
+			e.filename += "::";
+			e.filename += test;
+			e.line_num = line;
+
+			std::ostringstream out;
+			if (!allocationsTracked()) out << "allocations are not being tracked; generate the tests with --track-allocations";
+			else if (!e.pass) out << "made " << made << " allocations (" << size << " bytes), more than " << limit;
+
+			if (!out.str().empty()) e.msg += (e.msg.empty() ? "" : "\n") + out.str();
+
+			listener->OnEvent(e);
+		}
+	};
+
+	/** @brief Reports the allocations of every test.
+	 *
+	 *  Counts the allocations made on the test's own thread, from its per
+	 * test setup to its teardown, leaving out those of the listener, as the
+	 * metrics "allocations", "allocated-bytes", "peak-bytes" and
+	 * "leaked-bytes".  With --fail-leaks a test that does not free all it
+	 * allocated also fails. */
+	class AllocationInstrument : public Instrument
+	{
+		/** The counters when the test started. */
+		struct Start
+		{
+			uint64_t count, bytes;
+			int64_t live;
+		};
+
+		static Start& start()
+		{
+			static __thread Start s;
+			return s;
+		}
+
+		/** The counters when the listener was called. */
+		struct Paused
+		{
+			uint64_t count, bytes;
+			int64_t live, peak;
+			int depth;
+		};
+
+		static Paused& paused()
+		{
+			static __thread Paused p;
+			return p;
+		}
+
+	public:
+		virtual void startTest()
+		{
+			AllocationCounters &c = allocationCounters();
+			Start &s = start();
+
+			s.count = c.count;
+			s.bytes = c.bytes;
+			s.live = c.live;
+			c.peak = c.live;
+		}
+
+		/** Forgets whatever the listener allocates or frees. */
+		virtual void pause()
+		{
+			Paused &p = paused();
+			if (p.depth++ > 0) return;
+
+			AllocationCounters &c = allocationCounters();
+			p.count = c.count;
+			p.bytes = c.bytes;
+			p.live = c.live;
+			p.peak = c.peak;
+		}
+
+		virtual void resume()
+		{
+			Paused &p = paused();
+			if (--p.depth > 0) return;
+
+			AllocationCounters &c = allocationCounters();
+			c.count = p.count;
+			c.bytes = p.bytes;
+			c.live = p.live;
+			c.peak = p.peak;
+		}
+
+		virtual void stopTest(Listener &listener, const std::string &test, const char *source, uint32_t line)
+		{
+			AllocationCounters &c = allocationCounters();
+			Start &s = start();
+
+			uint64_t count = c.count - s.count, bytes = c.bytes - s.bytes;
+			int64_t peak = c.peak - s.live, leaked = c.live - s.live;
+
+			listener.OnMetric(test, "allocations", double(count));
+			listener.OnMetric(test, "allocated-bytes", double(bytes));
+			listener.OnMetric(test, "peak-bytes", double(peak));
+			listener.OnMetric(test, "leaked-bytes", double(leaked));
+
+			if (leaked > 0 && getOptions().has("fail-leaks"))
+			{
+				std::ostringstream out;
+				out << "leaked " << leaked << " bytes";
+
+				Event e;
+				e.pass = false;
+				e.expr = "no leaks";
+				e.msg = out.str();
+				e.filename = source;
+				e.filename += "::";
+				e.filename += test;
+				e.line_num = line;
+				listener.OnEvent(e);
+			}
+		}
+	};
+}
+
+#ifdef UT_TRACK_ALLOCATIONS
+
+namespace unittest
+{
+	/** Room kept in front of each block for its size.  16 bytes keeps the
+	 * block as aligned as malloc made it. */
+	static const size_t allocation_header = 16;
+
+	inline void *trackedAlloc(size_t size)
+	{
+		char *block = static_cast<char *>(std::malloc(size + allocation_header));
+		if (block == NULL) return NULL;
+
+		*reinterpret_cast<size_t *>(block) = size;
+
+		AllocationCounters &c = allocationCounters();
+		++c.count;
+		c.bytes += size;
+		c.live += size;
+		if (c.live > c.peak) c.peak = c.live;
+
+		return block + allocation_header;
+	}
+
+	inline void trackedFree(void *p)
+	{
+		if (p == NULL) return;
+
+		char *block = static_cast<char *>(p) - allocation_header;
+		allocationCounters().live -= *reinterpret_cast<size_t *>(block);
+		std::free(block);
+	}
+
+	/** Turns the tracking on when the test binary starts. */
+	static struct AllocationTracking
+	{
+		AllocationInstrument instrument;
+
+		AllocationTracking()
+		{
+			allocationsTracked() = true;
+			registerInstrument(&instrument);
+		}
+	} allocation_tracking;
+}
+
+#if __cplusplus < 201103L
+#define UT_THROWS_BAD_ALLOC throw(std::bad_alloc)
+#else
+#define UT_THROWS_BAD_ALLOC
+#endif
+
+void *operator new(size_t size) UT_THROWS_BAD_ALLOC
+{
+	void *p = unittest::trackedAlloc(size ? size : 1);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t size) UT_THROWS_BAD_ALLOC
+{
+	void *p = unittest::trackedAlloc(size ? size : 1);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) throw() { return unittest::trackedAlloc(size ? size : 1); }
+void *operator new[](size_t size, const std::nothrow_t &) throw() { return unittest::trackedAlloc(size ? size : 1); }
+
+void operator delete(void *p) throw() { unittest::trackedFree(p); }
+void operator delete[](void *p) throw() { unittest::trackedFree(p); }
+void operator delete(void *p, const std::nothrow_t &) throw() { unittest::trackedFree(p); }
+void operator delete[](void *p, const std::nothrow_t &) throw() { unittest::trackedFree(p); }
+
+#if __cplusplus >= 201402L
+void operator delete(void *p, size_t) throw() { unittest::trackedFree(p); }
+void operator delete[](void *p, size_t) throw() { unittest::trackedFree(p); }
+#endif
+
+#undef UT_THROWS_BAD_ALLOC
+
+#endif
+
+#endif
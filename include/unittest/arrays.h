@@ -0,0 +1,641 @@
+#ifndef __TEST_ARRAYS_H__
+#define __TEST_ARRAYS_H__
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <algorithm>
+#include "config.h"
+#include "options.h"
+#include "floating.h"
+#include "values.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && !defined(UT_NO_SIMD)
+#define UT_ARRAY_SIMD
+#include <immintrin.h>
+#endif
+
+namespace unittest
+{
+	/** How many elements are checked one at a time where a kernel reports a
+	 * possible mismatch, before handing back to the kernel. */
+	static const size_t array_block = 32;
+
+	/** The instruction sets the array kernels can use. */
+	enum ArraySimd { array_scalar, array_sse2, array_avx2 };
+
+	/** @brief Returns the best instruction set this processor has.
+	 *
+	 *  --array-simd=scalar or --array-simd=sse2 limits the choice, which
+	 * is useful for checking the kernels against each other. */
+	inline int arraySimd()
+	{
+		static int level = -1;
+
+		if (level < 0)
+		{
+			int best = array_scalar;
+
+#ifdef UT_ARRAY_SIMD
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2")) best = array_avx2;
+			else if (__builtin_cpu_supports("sse2")) best = array_sse2;
+#endif
+
+			std::string forced = getOptions().get("array-simd");
+			if (forced == "scalar") best = array_scalar;
+			else if (forced == "sse2" && best > array_sse2) best = array_sse2;
+
+			level = best;
+		}
+
+		return level;
+	}
+
+#ifdef UT_ARRAY_SIMD
+	/** Returns the first byte at or after from where a and b differ, or size. */
+	__attribute__((target("sse2")))
+	inline size_t arrayBytesSse2(const char *a, const char *b, size_t from, size_t size)
+	{
+		for(; from+16 <= size; from+=16)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a+from));
+			__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b+from));
+			int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+
+			if (mask != 0xffff) return from + __builtin_ctz(~mask);
+		}
+
+		for(; from<size && a[from] == b[from]; ++from);
+		return from;
+	}
+
+	__attribute__((target("avx2")))
+	inline size_t arrayBytesAvx2(const char *a, const char *b, size_t from, size_t size)
+	{
+		for(; from+32 <= size; from+=32)
+		{
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a+from));
+			__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b+from));
+			unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+
+			if (mask != 0xffffffffu) return from + __builtin_ctz(~mask);
+		}
+
+		return arrayBytesSse2(a, b, from, size);
+	}
+
+	/** Returns the first element at or after from that might not be within
+	 * eps, or where the last whole vector ends.  NaNs and infinities are
+	 * always reported, for the caller to judge. */
+	__attribute__((target("sse2")))
+	inline size_t arrayNearSse2(const float *a, const float *b, size_t from, size_t n, float eps)
+	{
+		const __m128 magnitude = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		const __m128 e = _mm_set1_ps(eps);
+
+		for(; from+4 <= n; from+=4)
+		{
+			__m128 d = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(a+from), _mm_loadu_ps(b+from)), magnitude);
+			int mask = _mm_movemask_ps(_mm_cmpnlt_ps(d, e));
+
+			if (mask) return from + __builtin_ctz(mask);
+		}
+
+		return from;
+	}
+
+	__attribute__((target("sse2")))
+	inline size_t arrayNearSse2(const double *a, const double *b, size_t from, size_t n, double eps)
+	{
+		const __m128d magnitude = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+		const __m128d e = _mm_set1_pd(eps);
+
+		for(; from+2 <= n; from+=2)
+		{
+			__m128d d = _mm_and_pd(_mm_sub_pd(_mm_loadu_pd(a+from), _mm_loadu_pd(b+from)), magnitude);
+			int mask = _mm_movemask_pd(_mm_cmpnlt_pd(d, e));
+
+			if (mask) return from + __builtin_ctz(mask);
+		}
+
+		return from;
+	}
+
+	__attribute__((target("avx2")))
+	inline size_t arrayNearAvx2(const float *a, const float *b, size_t from, size_t n, float eps)
+	{
+		const __m256 magnitude = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+		const __m256 e = _mm256_set1_ps(eps);
+
+		for(; from+8 <= n; from+=8)
+		{
+			__m256 d = _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(a+from), _mm256_loadu_ps(b+from)), magnitude);
+			int mask = _mm256_movemask_ps(_mm256_cmp_ps(d, e, _CMP_NLT_UQ));
+
+			if (mask) return from + __builtin_ctz(mask);
+		}
+
+		return from;
+	}
+
+	__attribute__((target("avx2")))
+	inline size_t arrayNearAvx2(const double *a, const double *b, size_t from, size_t n, double eps)
+	{
+		const __m256d magnitude = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+		const __m256d e = _mm256_set1_pd(eps);
+
+		for(; from+4 <= n; from+=4)
+		{
+			__m256d d = _mm256_and_pd(_mm256_sub_pd(_mm256_loadu_pd(a+from), _mm256_loadu_pd(b+from)), magnitude);
+			int mask = _mm256_movemask_pd(_mm256_cmp_pd(d, e, _CMP_NLT_UQ));
+
+			if (mask) return from + __builtin_ctz(mask);
+		}
+
+		return from;
+	}
+
+	/** Returns the first element at or after from whose relative error might
+	 * be more than rel, or where the last whole vector ends. */
+	__attribute__((target("sse2")))
+	inline size_t arrayRelSse2(const float *a, const float *b, size_t from, size_t n, float rel)
+	{
+		const __m128 magnitude = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		const __m128 r = _mm_set1_ps(rel);
+
+		for(; from+4 <= n; from+=4)
+		{
+			__m128 x = _mm_loadu_ps(a+from), y = _mm_loadu_ps(b+from);
+			__m128 d = _mm_and_ps(_mm_sub_ps(x, y), magnitude);
+			__m128 limit = _mm_mul_ps(_mm_max_ps(_mm_and_ps(x, magnitude), _mm_and_ps(y, magnitude)), r);
+			int mask = _mm_movemask_ps(_mm_cmpnle_ps(d, limit));
+
+			if (mask) return from + __builtin_ctz(mask);
+		}
+
+		return from;
+	}
+
+	__attribute__((target("sse2")))
+	inline size_t arrayRelSse2(const double *a, const double *b, size_t from, size_t n, double rel)
+	{
+		const __m128d magnitude = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+		const __m128d r = _mm_set1_pd(rel);
+
+		for(; from+2 <= n; from+=2)
+		{
+			__m128d x = _mm_loadu_pd(a+from), y = _mm_loadu_pd(b+from);
+			__m128d d = _mm_and_pd(_mm_sub_pd(x, y), magnitude);
+			__m128d limit = _mm_mul_pd(_mm_max_pd(_mm_and_pd(x, magnitude), _mm_and_pd(y, magnitude)), r);
+			int mask = _mm_movemask_pd(_mm_cmpnle_pd(d, limit));
+
+			if (mask) return from + __builtin_ctz(mask);
+		}
+
+		return from;
+	}
+
+	__attribute__((target("avx2")))
+	inline size_t arrayRelAvx2(const float *a, const float *b, size_t from, size_t n, float rel)
+	{
+		const __m256 magnitude = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+		const __m256 r = _mm256_set1_ps(rel);
+
+		for(; from+8 <= n; from+=8)
+		{
+			__m256 x = _mm256_loadu_ps(a+from), y = _mm256_loadu_ps(b+from);
+			__m256 d = _mm256_and_ps(_mm256_sub_ps(x, y), magnitude);
+			__m256 limit = _mm256_mul_ps(_mm256_max_ps(_mm256_and_ps(x, magnitude), _mm256_and_ps(y, magnitude)), r);
+			int mask = _mm256_movemask_ps(_mm256_cmp_ps(d, limit, _CMP_NLE_UQ));
+
+			if (mask) return from + __builtin_ctz(mask);
+		}
+
+		return from;
+	}
+
+	__attribute__((target("avx2")))
+	inline size_t arrayRelAvx2(const double *a, const double *b, size_t from, size_t n, double rel)
+	{
+		const __m256d magnitude = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+		const __m256d r = _mm256_set1_pd(rel);
+
+		for(; from+4 <= n; from+=4)
+		{
+			__m256d x = _mm256_loadu_pd(a+from), y = _mm256_loadu_pd(b+from);
+			__m256d d = _mm256_and_pd(_mm256_sub_pd(x, y), magnitude);
+			__m256d limit = _mm256_mul_pd(_mm256_max_pd(_mm256_and_pd(x, magnitude), _mm256_and_pd(y, magnitude)), r);
+			int mask = _mm256_movemask_pd(_mm256_cmp_pd(d, limit, _CMP_NLE_UQ));
+
+			if (mask) return from + __builtin_ctz(mask);
+		}
+
+		return from;
+	}
+
+	/** @brief Returns the first element at or after from that might be more
+	 * than ulps apart, or where the last whole vector ends.
+	 *
+	 *  The bits of each float are turned into integers that order like the
+	 * values, and subtracted.  Values on opposite sides of zero, infinities
+	 * and NaNs are left for the caller to judge. */
+	__attribute__((target("sse2")))
+	inline size_t arrayUlpSse2(const float *a, const float *b, size_t from, size_t n, uint64_t ulps)
+	{
+		const __m128i special = _mm_set1_epi32(0x7f800000);
+		const __m128i limit = _mm_set1_epi32(ulps > 0x7fffffff ? 0x7fffffff : int(ulps));
+
+		for(; from+4 <= n; from+=4)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a+from));
+			__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b+from));
+			__m128i kx = _mm_xor_si128(x, _mm_srli_epi32(_mm_srai_epi32(x, 31), 1));
+			__m128i ky = _mm_xor_si128(y, _mm_srli_epi32(_mm_srai_epi32(y, 31), 1));
+
+			__m128i d = _mm_sub_epi32(kx, ky);
+			__m128i sign = _mm_srai_epi32(d, 31);
+			d = _mm_sub_epi32(_mm_xor_si128(d, sign), sign);
+
+			__m128i bad = _mm_srai_epi32(_mm_xor_si128(kx, ky), 31);
+			bad = _mm_or_si128(bad, _mm_cmpeq_epi32(_mm_and_si128(x, special), special));
+			bad = _mm_or_si128(bad, _mm_cmpeq_epi32(_mm_and_si128(y, special), special));
+			bad = _mm_or_si128(bad, _mm_cmpgt_epi32(d, limit));
+
+			int mask = _mm_movemask_ps(_mm_castsi128_ps(bad));
+			if (mask) return from + __builtin_ctz(mask);
+		}
+
+		return from;
+	}
+
+	__attribute__((target("avx2")))
+	inline size_t arrayUlpAvx2(const float *a, const float *b, size_t from, size_t n, uint64_t ulps)
+	{
+		const __m256i special = _mm256_set1_epi32(0x7f800000);
+		const __m256i limit = _mm256_set1_epi32(ulps > 0x7fffffff ? 0x7fffffff : int(ulps));
+
+		for(; from+8 <= n; from+=8)
+		{
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a+from));
+			__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b+from));
+			__m256i kx = _mm256_xor_si256(x, _mm256_srli_epi32(_mm256_srai_epi32(x, 31), 1));
+			__m256i ky = _mm256_xor_si256(y, _mm256_srli_epi32(_mm256_srai_epi32(y, 31), 1));
+			__m256i d = _mm256_abs_epi32(_mm256_sub_epi32(kx, ky));
+
+			__m256i bad = _mm256_srai_epi32(_mm256_xor_si256(kx, ky), 31);
+			bad = _mm256_or_si256(bad, _mm256_cmpeq_epi32(_mm256_and_si256(x, special), special));
+			bad = _mm256_or_si256(bad, _mm256_cmpeq_epi32(_mm256_and_si256(y, special), special));
+			bad = _mm256_or_si256(bad, _mm256_cmpgt_epi32(d, limit));
+
+			int mask = _mm256_movemask_ps(_mm256_castsi256_ps(bad));
+			if (mask) return from + __builtin_ctz(mask);
+		}
+
+		return from;
+	}
+
+	__attribute__((target("avx2")))
+	inline size_t arrayUlpAvx2(const double *a, const double *b, size_t from, size_t n, uint64_t ulps)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i special = _mm256_set1_epi64x(0x7ff0000000000000LL);
+		const __m256i limit = _mm256_set1_epi64x(ulps > 0x7fffffffffffffffULL ? 0x7fffffffffffffffLL : (long long)ulps);
+
+		for(; from+4 <= n; from+=4)
+		{
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a+from));
+			__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b+from));
+			__m256i kx = _mm256_xor_si256(x, _mm256_srli_epi64(_mm256_cmpgt_epi64(zero, x), 1));
+			__m256i ky = _mm256_xor_si256(y, _mm256_srli_epi64(_mm256_cmpgt_epi64(zero, y), 1));
+
+			__m256i d = _mm256_sub_epi64(kx, ky);
+			__m256i sign = _mm256_cmpgt_epi64(zero, d);
+			d = _mm256_sub_epi64(_mm256_xor_si256(d, sign), sign);
+
+			__m256i bad = _mm256_cmpgt_epi64(zero, _mm256_xor_si256(kx, ky));
+			bad = _mm256_or_si256(bad, _mm256_cmpeq_epi64(_mm256_and_si256(x, special), special));
+			bad = _mm256_or_si256(bad, _mm256_cmpeq_epi64(_mm256_and_si256(y, special), special));
+			bad = _mm256_or_si256(bad, _mm256_cmpgt_epi64(d, limit));
+
+			int mask = _mm256_movemask_pd(_mm256_castsi256_pd(bad));
+			if (mask) return from + __builtin_ctz(mask);
+		}
+
+		return from;
+	}
+#endif
+
+	/** Returns the first byte at or after from where a and b differ, or size,
+	 * using the best kernel available. */
+	inline size_t arrayBytes(const char *a, const char *b, size_t from, size_t size)
+	{
+#ifdef UT_ARRAY_SIMD
+		switch (arraySimd())
+		{
+		case array_avx2: return arrayBytesAvx2(a, b, from, size);
+		case array_sse2: return arrayBytesSse2(a, b, from, size);
+		}
+#endif
+
+		// memcmp is usually vectorised itself, so let it skip equal pages.
+		for(; from+4096 <= size && std::memcmp(a+from, b+from, 4096) == 0; from+=4096);
+		for(; from<size && a[from] == b[from]; ++from);
+		return from;
+	}
+
+	/** The kernels for each element type.  Types without kernels are checked
+	 * one element at a time. */
+	template<class T>
+	size_t arrayNearKernel(const T *, const T *, size_t from, size_t, const T &) { return from; }
+
+	template<class T>
+	size_t arrayRelKernel(const T *, const T *, size_t from, size_t, const T &) { return from; }
+
+	template<class T>
+	size_t arrayUlpKernel(const T *a, const T *b, size_t from, size_t n, uint64_t)
+	{
+		// Equal bits are always near, so at least skip those quickly.
+		return arrayBytes(reinterpret_cast<const char *>(a), reinterpret_cast<const char *>(b), from*sizeof(T), n*sizeof(T)) / sizeof(T);
+	}
+
+#ifdef UT_ARRAY_SIMD
+#define UT_ARRAY_KERNEL(name, type, arg, sse2, avx2) \
+	inline size_t name(const type *a, const type *b, size_t from, size_t n, arg) \
+	{ \
+		switch (arraySimd()) \
+		{ \
+		case array_avx2: return avx2; \
+		case array_sse2: return sse2; \
+		} \
+		return from; \
+	}
+
+	UT_ARRAY_KERNEL(arrayNearKernel, float, const float &eps, arrayNearSse2(a, b, from, n, eps), arrayNearAvx2(a, b, from, n, eps))
+	UT_ARRAY_KERNEL(arrayNearKernel, double, const double &eps, arrayNearSse2(a, b, from, n, eps), arrayNearAvx2(a, b, from, n, eps))
+	UT_ARRAY_KERNEL(arrayRelKernel, float, const float &rel, arrayRelSse2(a, b, from, n, rel), arrayRelAvx2(a, b, from, n, rel))
+	UT_ARRAY_KERNEL(arrayRelKernel, double, const double &rel, arrayRelSse2(a, b, from, n, rel), arrayRelAvx2(a, b, from, n, rel))
+	UT_ARRAY_KERNEL(arrayUlpKernel, float, uint64_t ulps, arrayUlpSse2(a, b, from, n, ulps), arrayUlpAvx2(a, b, from, n, ulps))
+	UT_ARRAY_KERNEL(arrayUlpKernel, double, uint64_t ulps, arrayUlpKernel<double>(a, b, from, n, ulps), arrayUlpAvx2(a, b, from, n, ulps))
+
+#undef UT_ARRAY_KERNEL
+#endif
+
+	/** Elements compared one at a time with ==, and shown with ToString. */
+	template<class T>
+	struct BasicArrayTraits
+	{
+		/** True if the elements are numbers, so errors can be measured. */
+		static const bool numeric = false;
+
+		/** True if the error in units in the last place can be measured. */
+		static const bool ulp = false;
+
+		static bool same(const T &a, const T &b) { return a == b; }
+		static bool near(const T &a, const T &b, const T &eps) { return (a < b ? b - a : a - b) < eps; }
+
+		/** Return the first element at or after from that might differ. */
+		static size_t scanSame(const T *, const T *, size_t from, size_t) { return from; }
+		static size_t scanNear(const T *, const T *, size_t from, size_t, const T &) { return from; }
+
+		static double absError(const T &, const T &) { return 0; }
+		static uint64_t ulpError(const T &, const T &) { return 0; }
+		static void format(std::ostream &out, const T &value) { out << toString(value); }
+	};
+
+	/** @brief How arrays of T are compared.
+	 *
+	 *  Arithmetic types are specialized below, to use the kernels and report
+	 * errors. */
+	template<class T>
+	struct ArrayTraits : public BasicArrayTraits<T> {};
+
+	/** Integers, whose bytes are equal exactly when they are. */
+	template<class T>
+	struct IntegerArrayTraits : public BasicArrayTraits<T>
+	{
+		static const bool numeric = true;
+
+		static size_t scanSame(const T *a, const T *b, size_t from, size_t n)
+		{
+			return arrayBytes(reinterpret_cast<const char *>(a), reinterpret_cast<const char *>(b), from*sizeof(T), n*sizeof(T)) / sizeof(T);
+		}
+
+		static double absError(const T &a, const T &b) { return std::fabs(double(a) - double(b)); }
+
+		// The + shows char types as numbers.
+		static void format(std::ostream &out, const T &value) { out << +value; }
+	};
+
+	/** Floating point types.  NaN is the same as NaN, infinities are near
+	 * only to themselves, and -0 is the same as 0. */
+	template<class T>
+	struct FloatArrayTraits : public IntegerArrayTraits<T>
+	{
+		static const bool ulp = true;
+
+		static bool same(const T &a, const T &b) { return a == b || (a != a && b != b); }
+		static bool near(const T &a, const T &b, const T &eps) { return std::fabs(a - b) < eps || same(a, b); }
+
+		static size_t scanNear(const T *a, const T *b, size_t from, size_t n, const T &eps)
+		{
+			return arrayNearKernel(a, b, from, n, eps);
+		}
+
+		static double absError(const T &a, const T &b)
+		{
+			if (same(a, b)) return 0;
+
+			T error = std::fabs(a - b);
+			return error == error ? error : HUGE_VAL;
+		}
+
+		static uint64_t ulpError(const T &a, const T &b) { return same(a, b) ? 0 : ulpDistance(a, b); }
+
+		static void format(std::ostream &out, const T &value)
+		{
+			out << std::setprecision(std::numeric_limits<T>::digits10 + 2) << value;
+		}
+	};
+
+#define UT_ARRAY_TRAITS(type, traits) template<> struct ArrayTraits<type> : public traits<type> {};
+
+	UT_ARRAY_TRAITS(char, IntegerArrayTraits)
+	UT_ARRAY_TRAITS(signed char, IntegerArrayTraits)
+	UT_ARRAY_TRAITS(unsigned char, IntegerArrayTraits)
+	UT_ARRAY_TRAITS(short, IntegerArrayTraits)
+	UT_ARRAY_TRAITS(unsigned short, IntegerArrayTraits)
+	UT_ARRAY_TRAITS(int, IntegerArrayTraits)
+	UT_ARRAY_TRAITS(unsigned int, IntegerArrayTraits)
+	UT_ARRAY_TRAITS(long, IntegerArrayTraits)
+	UT_ARRAY_TRAITS(unsigned long, IntegerArrayTraits)
+	UT_ARRAY_TRAITS(long long, IntegerArrayTraits)
+	UT_ARRAY_TRAITS(unsigned long long, IntegerArrayTraits)
+	UT_ARRAY_TRAITS(float, FloatArrayTraits)
+	UT_ARRAY_TRAITS(double, FloatArrayTraits)
+	UT_ARRAY_TRAITS(long double, FloatArrayTraits)
+
+#undef UT_ARRAY_TRAITS
+
+	/** @brief Matches elements that are the same.
+	 *
+	 *  Each kind of match also knows the kernel that skips elements it is
+	 * sure match. */
+	template<class T>
+	struct ArraySame
+	{
+		bool operator()(const T &a, const T &b) const { return ArrayTraits<T>::same(a, b); }
+		size_t scan(const T *a, const T *b, size_t from, size_t n) const { return ArrayTraits<T>::scanSame(a, b, from, n); }
+	};
+
+	/** Matches elements that are within eps of each other. */
+	template<class T>
+	struct ArrayNear
+	{
+		T eps;
+
+		ArrayNear(const T &_eps):eps(_eps) {}
+
+		bool operator()(const T &a, const T &b) const { return ArrayTraits<T>::near(a, b, eps); }
+		size_t scan(const T *a, const T *b, size_t from, size_t n) const { return ArrayTraits<T>::scanNear(a, b, from, n, eps); }
+	};
+
+	/** Matches floating point elements at most ulps apart. */
+	template<class T>
+	struct ArrayUlpNear
+	{
+		uint64_t ulps;
+
+		ArrayUlpNear(uint64_t _ulps):ulps(_ulps) {}
+
+		bool operator()(const T &a, const T &b) const { return ulpNear(a, b, ulps); }
+		size_t scan(const T *a, const T *b, size_t from, size_t n) const { return arrayUlpKernel(a, b, from, n, ulps); }
+	};
+
+	/** Matches floating point elements within a relative error of rel. */
+	template<class T>
+	struct ArrayRelNear
+	{
+		T rel;
+
+		ArrayRelNear(const T &_rel):rel(_rel) {}
+
+		bool operator()(const T &a, const T &b) const { return relNear(a, b, rel); }
+		size_t scan(const T *a, const T *b, size_t from, size_t n) const { return arrayRelKernel(a, b, from, n, rel); }
+	};
+
+	/** @brief Describes how two arrays differ.
+	 *
+	 *  Only run once an array is known to fail, so it can afford to visit
+	 * every element.  The first --array-mismatches (10 by default) mismatched
+	 * elements are listed, and for numbers the largest and mean error over
+	 * the whole array. */
+	template<class T, class Match>
+	std::string arrayReport(const T *a, const T *b, size_t n, const Match &match)
+	{
+		typedef ArrayTraits<T> traits;
+
+		size_t limit = getOptions().getInt("array-mismatches", 10), count = 0;
+		double max_abs = 0, sum_abs = 0, sum_ulp = 0;
+		uint64_t max_ulp = 0;
+		std::ostringstream listed;
+
+		for(size_t i=0; i<n; ++i)
+		{
+			if (traits::numeric)
+			{
+				double error = traits::absError(a[i], b[i]);
+				max_abs = std::max(max_abs, error);
+				sum_abs += error;
+			}
+
+			if (traits::ulp)
+			{
+				uint64_t error = traits::ulpError(a[i], b[i]);
+				max_ulp = std::max(max_ulp, error);
+				sum_ulp += error;
+			}
+
+			if (match(a[i], b[i])) continue;
+
+			if (count < limit)
+			{
+				listed << (count ? ", [" : "[") << i << "] ";
+				traits::format(listed, a[i]);
+				listed << " vs ";
+				traits::format(listed, b[i]);
+			}
+
+			++count;
+		}
+
+		std::ostringstream out;
+		out << count << " of " << n << " elements differ: " << listed.str();
+		if (count > limit) out << ", ...";
+
+		if (traits::numeric) out << "; max abs error " << max_abs << ", mean abs error " << sum_abs / n;
+		if (traits::ulp)
+		{
+			if (max_ulp == ulp_infinite) out << "; max ulp error inf, mean ulp error inf";
+			else out << "; max ulp error " << max_ulp << ", mean ulp error " << sum_ulp / n;
+		}
+
+		return out.str();
+	}
+
+	/** @brief Returns true if match(a[i], b[i]) for every i below n.
+	 *
+	 *  The kernel skips over elements that surely match; wherever it stops,
+	 * a few elements are checked one at a time.  If the arrays differ,
+	 * report describes how. */
+	template<class T, class Match>
+	bool matchArrays(const T *a, const T *b, size_t n, const Match &match, std::string &report)
+	{
+		for(size_t i=match.scan(a, b, 0, n); i<n; i=match.scan(a, b, i, n))
+		{
+			for(size_t stop=std::min(i+array_block, n); i<stop; ++i)
+			{
+				if (match(a[i], b[i])) continue;
+
+				report = arrayReport(a, b, n, match);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/** Returns true if a[i] == b[i] for every i below n. */
+	template<class T>
+	bool compareArrays(const T *a, const T *b, size_t n, std::string &report)
+	{
+		return matchArrays(a, b, n, ArraySame<T>(), report);
+	}
+
+	/** Returns true if a[i] is within eps of b[i] for every i below n. */
+	template<class T, class E>
+	bool nearArrays(const T *a, const T *b, size_t n, const E &eps, std::string &report)
+	{
+		return matchArrays(a, b, n, ArrayNear<T>(T(eps)), report);
+	}
+
+	/** Returns true if a[i] is at most ulps from b[i] for every i below n. */
+	template<class T>
+	bool ulpNearArrays(const T *a, const T *b, size_t n, uint64_t ulps, std::string &report)
+	{
+		return matchArrays(a, b, n, ArrayUlpNear<T>(ulps), report);
+	}
+
+	/** Returns true if the relative error of a[i] and b[i] is at most rel
+	 * for every i below n. */
+	template<class T, class R>
+	bool relNearArrays(const T *a, const T *b, size_t n, const R &rel, std::string &report)
+	{
+		return matchArrays(a, b, n, ArrayRelNear<T>(T(rel)), report);
+	}
+}
+
+#endif
@@ -62,7 +62,7 @@
 #define UT_EVENT_BODY(passed, the_expr) 		\
 	__event__.pass = passed;  	 			    \
  	__event__.expr = #the_expr;	    			\
- 	__event__.filename = __FILE__ "::" __TEST_NAME__;	    \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;	    \
  	__event__.line_num = __LINE__; \
  	__event__.total_tests =  __total_tests__; \
  	__event__.current_test = __current_test__;			    
@@ -282,7 +282,7 @@
 	__event__.pass = (UT_EVALUATE_EXPR(((expr1) == true), false)); \
  	__event__.expr = #expr1 " is true";	    \
  	__event__.msg =  _msg;					    \
- 	__event__.filename = __FILE__ "::" __TEST_NAME__;			    \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
  	__event__.line_num = __LINE__;			    \
  												\
  	listener->OnEvent(__event__);
@@ -303,7 +303,7 @@
 	__event__.pass = (UT_EVALUATE_EXPR(((expr1) == false), false)); \
  	__event__.expr = #expr1 " is true";	    \
  	__event__.msg =  _msg;					    \
- 	__event__.filename = __FILE__ "::" __TEST_NAME__;			    \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
  	__event__.line_num = __LINE__;			    \
  												\
  	listener->OnEvent(__event__);
@@ -315,19 +315,27 @@
 #define UT_ASSERT_FALSE(expr1) UT_ASSERT_FALSE_MSG(expr1, "") 	
  
 
+/** Passes an operand of UT_ASSERT_EQUALS on, or a literal 0 or NULL as a
+ * unittest::NullLiteral.  The operand is evaluated once. */
+#define UT_OPERAND(expr) unittest::null_literal::Operand<sizeof(unittest::null_literal::test(expr)) == 1>::pass(expr)
+
 /**
  * \def UT_ASSERT_EQUALS_MSG
  * @brief Assert is true if expr1 and expr2 equal each other.  msg is 
  * additional information you would like printed in the error if it
  * fails. */
 #define UT_ASSERT_EQUALS_MSG(expr1, expr2, _msg) 	\
-	__event__.pass = UT_EVALUATE_EXPR(((expr1) == (expr2)), false); \
+	{ \
+	std::string __values__; \
+	__event__.pass = UT_EVALUATE_EXPR(unittest::checkValues(UT_OPERAND(expr1), UT_OPERAND(expr2), unittest::Equal(), __values__), false); \
  	__event__.expr = #expr1 "==" #expr2;	    \
  	__event__.msg =  _msg;					    \
- 	__event__.filename = __FILE__ "::" __TEST_NAME__;			    \
+ 	if (!__values__.empty()) __event__.msg += (__event__.msg.empty() ? "" : "\n") + __values__; \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
  	__event__.line_num = __LINE__;			    \
  												\
- 	listener->OnEvent(__event__);
+ 	listener->OnEvent(__event__); \
+	}
 
 /**  
  * 
@@ -340,13 +348,17 @@
  * @brief Assert is true if expr1 is less than expr2.  msg is 
  * additional information you would like printed in the error if it fails. */
 #define UT_ASSERT_LESS_MSG(expr1, expr2, _msg) 	\
-	__event__.pass = UT_EVALUATE_EXPR((expr1) < (expr2), false); \
+	{ \
+	std::string __values__; \
+	__event__.pass = UT_EVALUATE_EXPR(unittest::checkValues((expr1), (expr2), unittest::Less(), __values__), false); \
  	__event__.expr = #expr1 " < " #expr2;	    \
  	__event__.msg =  _msg;					    \
- 	__event__.filename = __FILE__ "::" __TEST_NAME__;			    \
+ 	if (!__values__.empty()) __event__.msg += (__event__.msg.empty() ? "" : "\n") + __values__; \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
  	__event__.line_num = __LINE__;			    \
  												\
- 	listener->OnEvent(__event__);
+ 	listener->OnEvent(__event__); \
+	}
 
 /** 
  * \def UT_ASSERT_LESS
@@ -359,13 +371,17 @@
  * @brief Assert is true if expr1 is greater than expr2.  msg is 
  * additional information you would like printed in the error if it fails. */
 #define UT_ASSERT_GREATER_MSG(expr1, expr2, _msg) 	\
-	__event__.pass = UT_EVALUATE_EXPR((expr1) > (expr2), false); \
+	{ \
+	std::string __values__; \
+	__event__.pass = UT_EVALUATE_EXPR(unittest::checkValues((expr1), (expr2), unittest::Greater(), __values__), false); \
  	__event__.expr = #expr1 " > " #expr2;	    \
  	__event__.msg =  _msg;					    \
- 	__event__.filename = __FILE__ "::" __TEST_NAME__;			    \
+ 	if (!__values__.empty()) __event__.msg += (__event__.msg.empty() ? "" : "\n") + __values__; \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
  	__event__.line_num = __LINE__;			    \
  												\
- 	listener->OnEvent(__event__);
+ 	listener->OnEvent(__event__); \
+	}
 
 /**  
  * \def UT_ASSERT_GREATER
@@ -384,13 +400,17 @@
  * additional information you would like printed in the error if it
  * fails. */
 #define UT_ASSERT_FLOAT_NEAR_MSG(expr1, expr2, epsilon, _msg) 	\
-	__event__.pass = UT_EVALUATE_EXPR((std::fabs((expr1)-(expr2))<(epsilon)) , false); \
+	{ \
+	std::string __values__; \
+	__event__.pass = UT_EVALUATE_EXPR(unittest::checkFloatNear((expr1), (expr2), (epsilon), __values__), false); \
  	__event__.expr = #expr1 " near " #expr2 " by " #epsilon;	    \
  	__event__.msg =  _msg;					    \
- 	__event__.filename = __FILE__ "::" __TEST_NAME__;			    \
+ 	if (!__values__.empty()) __event__.msg += (__event__.msg.empty() ? "" : "\n") + __values__; \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
  	__event__.line_num = __LINE__;			    \
  												\
- 	listener->OnEvent(__event__);
+ 	listener->OnEvent(__event__); \
+	}
 
 /** 
  * \def UT_ASSERT_FLOAT_NEAR
@@ -402,6 +422,66 @@
  * Can handle floating point formats up to double.  */
 #define UT_ASSERT_FLOAT_NEAR(expr1, expr2, epsilon) UT_ASSERT_FLOAT_NEAR_MSG(expr1, expr2, epsilon, "") 
 
+/**
+ * \def UT_ASSERT_ULP_NEAR_MSG
+ * @param expr1 The left side of the expression.
+ * @param expr2 The right side of the expression.
+ * @param ulps  How many representable values apart expr1 and expr2 may be in order to pass.
+ * @param _msg  The message to include in the test event.
+ *
+ * @brief Assert true if floating point expr1 and expr2 are at most ulps units in the last
+ * place apart.  0 asks for bit-exact results, except that -0 matches 0.  NaN matches only
+ * NaN, an infinity only itself, and denormals are counted like any other value.  Works
+ * for float, double and long double; each expression is evaluated once. */
+#define UT_ASSERT_ULP_NEAR_MSG(expr1, expr2, ulps, _msg) 	\
+	{ \
+	std::string __float_report__; \
+	__event__.pass = UT_EVALUATE_EXPR(unittest::checkUlpNear((expr1), (expr2), (ulps), __float_report__), false); \
+ 	__event__.expr = #expr1 " near " #expr2 " by " #ulps " ulps";	    \
+ 	__event__.msg =  _msg;					    \
+ 	if (!__float_report__.empty()) __event__.msg += (__event__.msg.empty() ? "" : "\n") + __float_report__; \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
+ 	__event__.line_num = __LINE__;			    \
+ 												\
+ 	listener->OnEvent(__event__); \
+	}
+
+/**
+ * \def UT_ASSERT_ULP_NEAR
+ * @brief Assert true if floating point expr1 and expr2 are at most ulps units in the last
+ * place apart. */
+#define UT_ASSERT_ULP_NEAR(expr1, expr2, ulps) UT_ASSERT_ULP_NEAR_MSG(expr1, expr2, ulps, "")
+
+/**
+ * \def UT_ASSERT_REL_NEAR_MSG
+ * @param expr1 The left side of the expression.
+ * @param expr2 The right side of the expression.
+ * @param rel   The largest relative error that passes, such as 1e-6.
+ * @param _msg  The message to include in the test event.
+ *
+ * @brief Assert true if floating point expr1 and expr2 differ by at most rel times the
+ * larger of them.  Values closer together than the smallest normal number always pass.
+ * NaN matches only NaN and an infinity only itself.  Works for float, double and long
+ * double; each expression is evaluated once. */
+#define UT_ASSERT_REL_NEAR_MSG(expr1, expr2, rel, _msg) 	\
+	{ \
+	std::string __float_report__; \
+	__event__.pass = UT_EVALUATE_EXPR(unittest::checkRelNear((expr1), (expr2), (rel), __float_report__), false); \
+ 	__event__.expr = #expr1 " near " #expr2 " within " #rel;	    \
+ 	__event__.msg =  _msg;					    \
+ 	if (!__float_report__.empty()) __event__.msg += (__event__.msg.empty() ? "" : "\n") + __float_report__; \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
+ 	__event__.line_num = __LINE__;			    \
+ 												\
+ 	listener->OnEvent(__event__); \
+	}
+
+/**
+ * \def UT_ASSERT_REL_NEAR
+ * @brief Assert true if floating point expr1 and expr2 differ by at most rel times the
+ * larger of them. */
+#define UT_ASSERT_REL_NEAR(expr1, expr2, rel) UT_ASSERT_REL_NEAR_MSG(expr1, expr2, rel, "")
+
 /** 
  * \def UT_ASSERT_NEAR_MSG
  * @param expr1 The left side of the expression.
@@ -414,13 +494,17 @@
  * additional information you would like printed in the error if it
  * fails. */
 #define UT_ASSERT_NEAR_MSG(expr1, expr2, epsilon, _msg) 	\
-	__event__.pass = UT_EVALUATE_EXPR((std::abs((expr1)-(expr2))<(epsilon)) , false); \
+	{ \
+	std::string __values__; \
+	__event__.pass = UT_EVALUATE_EXPR(unittest::checkNear((expr1), (expr2), (epsilon), __values__), false); \
  	__event__.expr = #expr1 " near " #expr2 " by " #epsilon;	    \
  	__event__.msg =  _msg;					    \
- 	__event__.filename = __FILE__ "::" __TEST_NAME__;			    \
+ 	if (!__values__.empty()) __event__.msg += (__event__.msg.empty() ? "" : "\n") + __values__; \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
  	__event__.line_num = __LINE__;			    \
  												\
- 	listener->OnEvent(__event__);
+ 	listener->OnEvent(__event__); \
+	}
 
 /** 
  * \def UT_ASSERT_NEAR
@@ -445,7 +529,7 @@
 	__event__.pass = UT_EVALUATE_EXPR((expr1), true); \
  	__event__.expr = #expr1;					    \
  	__event__.msg =  _msg;					    \
- 	__event__.filename = __FILE__ "::" __TEST_NAME__;			    \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
  	__event__.line_num = __LINE__;			    \
  												\
  	listener->OnEvent(__event__);
@@ -471,7 +555,7 @@
 	__event__.pass = UT_EVALUATE_EXPR_NORESULT((expr1), true); \
  	__event__.expr = #expr1;					    \
  	__event__.msg =  _msg;					    \
- 	__event__.filename = __FILE__ "::" __TEST_NAME__;			    \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
  	__event__.line_num = __LINE__;			    \
  												\
  	listener->OnEvent(__event__);
@@ -486,6 +570,203 @@
  * Will cause a fail event to occur if an exception is expected and none occurs. */
 #define UT_ASSERT_NORESULT_EXCEPTION(expr1) UT_ASSERT_NORESULT_EXCEPTION_MSG(expr1, "")
 
+/**
+ * \def UT_ASSERT_MATCHES_GOLDEN_MSG
+ * @param buffer The output to check, such as a std::string or std::vector<char>.
+ * @param path   The golden file holding the expected output.
+ * @param _msg   The message to include in the test event.
+ *
+ * @brief Assert true if buffer holds exactly the contents of the golden file.  On a
+ * mismatch a diff of the lines that differ is added to the message.  Running the tests
+ * with --update-golden rewrites mismatched or missing golden files instead of failing. */
+#define UT_ASSERT_MATCHES_GOLDEN_MSG(buffer, path, _msg) 	\
+	{ \
+	std::string __golden_diff__; \
+	__event__.pass = UT_EVALUATE_EXPR(unittest::matchGolden((buffer), (path), __golden_diff__), false); \
+ 	__event__.expr = #buffer " matches " #path;	    \
+ 	__event__.msg =  _msg;					    \
+ 	if (!__golden_diff__.empty()) __event__.msg += (__event__.msg.empty() ? "" : "\n") + __golden_diff__; \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
+ 	__event__.line_num = __LINE__;			    \
+ 												\
+ 	listener->OnEvent(__event__); \
+	}
+
+/**
+ * \def UT_ASSERT_MATCHES_GOLDEN
+ * @param buffer The output to check, such as a std::string or std::vector<char>.
+ * @param path   The golden file holding the expected output.
+ *
+ * @brief Assert true if buffer holds exactly the contents of the golden file. */
+#define UT_ASSERT_MATCHES_GOLDEN(buffer, path) UT_ASSERT_MATCHES_GOLDEN_MSG(buffer, path, "")
+
+/**
+ * \def UT_ASSERT_ARRAY_EQUALS_MSG
+ * @param a  The first array.
+ * @param b  The second array, of the same element type.
+ * @param n  The number of elements to compare.
+ * @param _msg The message to include in the test event.
+ *
+ * @brief Assert true if the first n elements of a and b are equal.  The whole array makes
+ * a single event.  On failure the message lists the first mismatched elements and, for
+ * numbers, the largest and mean error. */
+#define UT_ASSERT_ARRAY_EQUALS_MSG(a, b, n, _msg) 	\
+	{ \
+	std::string __array_report__; \
+	__event__.pass = UT_EVALUATE_EXPR(unittest::compareArrays((a), (b), (n), __array_report__), false); \
+ 	__event__.expr = #a " == " #b " for " #n " elements";	    \
+ 	__event__.msg =  _msg;					    \
+ 	if (!__array_report__.empty()) __event__.msg += (__event__.msg.empty() ? "" : "\n") + __array_report__; \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
+ 	__event__.line_num = __LINE__;			    \
+ 												\
+ 	listener->OnEvent(__event__); \
+	}
+
+/**
+ * \def UT_ASSERT_ARRAY_EQUALS
+ * @brief Assert true if the first n elements of a and b are equal. */
+#define UT_ASSERT_ARRAY_EQUALS(a, b, n) UT_ASSERT_ARRAY_EQUALS_MSG(a, b, n, "")
+
+/**
+ * \def UT_ASSERT_ARRAY_NEAR_MSG
+ * @param a  The first array.
+ * @param b  The second array, of the same element type.
+ * @param n  The number of elements to compare.
+ * @param epsilon How near each pair of elements must be in order to pass.
+ * @param _msg The message to include in the test event.
+ *
+ * @brief Assert true if each of the first n elements of a is within epsilon of the same
+ * element of b.  NaN is near only to NaN, and an infinity only to itself. */
+#define UT_ASSERT_ARRAY_NEAR_MSG(a, b, n, epsilon, _msg) 	\
+	{ \
+	std::string __array_report__; \
+	__event__.pass = UT_EVALUATE_EXPR(unittest::nearArrays((a), (b), (n), (epsilon), __array_report__), false); \
+ 	__event__.expr = #a " near " #b " by " #epsilon " for " #n " elements";	    \
+ 	__event__.msg =  _msg;					    \
+ 	if (!__array_report__.empty()) __event__.msg += (__event__.msg.empty() ? "" : "\n") + __array_report__; \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
+ 	__event__.line_num = __LINE__;			    \
+ 												\
+ 	listener->OnEvent(__event__); \
+	}
+
+/**
+ * \def UT_ASSERT_ARRAY_NEAR
+ * @brief Assert true if each of the first n elements of a is within epsilon of the same
+ * element of b. */
+#define UT_ASSERT_ARRAY_NEAR(a, b, n, epsilon) UT_ASSERT_ARRAY_NEAR_MSG(a, b, n, epsilon, "")
+
+/**
+ * \def UT_ASSERT_ARRAY_ULP_NEAR_MSG
+ * @brief Assert true if each of the first n elements of floating point array a is at most
+ * ulps units in the last place from the same element of b, as UT_ASSERT_ULP_NEAR. */
+#define UT_ASSERT_ARRAY_ULP_NEAR_MSG(a, b, n, ulps, _msg) 	\
+	{ \
+	std::string __array_report__; \
+	__event__.pass = UT_EVALUATE_EXPR(unittest::ulpNearArrays((a), (b), (n), (ulps), __array_report__), false); \
+ 	__event__.expr = #a " near " #b " by " #ulps " ulps for " #n " elements";	    \
+ 	__event__.msg =  _msg;					    \
+ 	if (!__array_report__.empty()) __event__.msg += (__event__.msg.empty() ? "" : "\n") + __array_report__; \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
+ 	__event__.line_num = __LINE__;			    \
+ 												\
+ 	listener->OnEvent(__event__); \
+	}
+
+/**
+ * \def UT_ASSERT_ARRAY_ULP_NEAR
+ * @brief Assert true if each of the first n elements of a is at most ulps units in the
+ * last place from the same element of b. */
+#define UT_ASSERT_ARRAY_ULP_NEAR(a, b, n, ulps) UT_ASSERT_ARRAY_ULP_NEAR_MSG(a, b, n, ulps, "")
+
+/**
+ * \def UT_ASSERT_ARRAY_REL_NEAR_MSG
+ * @brief Assert true if each of the first n elements of floating point array a is within
+ * a relative error of rel of the same element of b, as UT_ASSERT_REL_NEAR. */
+#define UT_ASSERT_ARRAY_REL_NEAR_MSG(a, b, n, rel, _msg) 	\
+	{ \
+	std::string __array_report__; \
+	__event__.pass = UT_EVALUATE_EXPR(unittest::relNearArrays((a), (b), (n), (rel), __array_report__), false); \
+ 	__event__.expr = #a " near " #b " within " #rel " for " #n " elements";	    \
+ 	__event__.msg =  _msg;					    \
+ 	if (!__array_report__.empty()) __event__.msg += (__event__.msg.empty() ? "" : "\n") + __array_report__; \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
+ 	__event__.line_num = __LINE__;			    \
+ 												\
+ 	listener->OnEvent(__event__); \
+	}
+
+/**
+ * \def UT_ASSERT_ARRAY_REL_NEAR
+ * @brief Assert true if each of the first n elements of a is within a relative error of
+ * rel of the same element of b. */
+#define UT_ASSERT_ARRAY_REL_NEAR(a, b, n, rel) UT_ASSERT_ARRAY_REL_NEAR_MSG(a, b, n, rel, "")
+
+/**
+ * \def UT_ASSERT_MAX_ALLOCS_MSG
+ * @param n    The most allocations the block may make.
+ * @param _msg The message to include in the test event.
+ *
+ * @brief Assert true if the block that follows makes at most n allocations with
+ * operator new on the test's thread.  The block must not break out early:
+ * \code
+ * UT_ASSERT_MAX_ALLOCS_MSG(1, "one buffer only") { parser.parse(input); }
+ * \endcode
+ * Tracking is linked into the test binary whenever the generator sees this
+ * assertion, or is given --track-allocations. */
+#define UT_ASSERT_MAX_ALLOCS_MSG(n, _msg) \
+	for(unittest::AllocationCheck __alloc_check__(n); __alloc_check__.running(); \
+	    __alloc_check__.finish(__event__, listener, __FILE__, __TEST_NAME__, __LINE__, "at most " #n " allocations", _msg))
+
+/**
+ * \def UT_ASSERT_MAX_ALLOCS
+ * @brief Assert true if the block that follows makes at most n allocations. */
+#define UT_ASSERT_MAX_ALLOCS(n) UT_ASSERT_MAX_ALLOCS_MSG(n, "")
+
+/**
+ * \def UT_ASSERT_NO_ALLOC_MSG
+ * @brief Assert true if the block that follows makes no allocations at all. */
+#define UT_ASSERT_NO_ALLOC_MSG(_msg) UT_ASSERT_MAX_ALLOCS_MSG(0, _msg)
+
+/**
+ * \def UT_ASSERT_NO_ALLOC
+ * @brief Assert true if the block that follows makes no allocations at all:
+ * \code
+ * UT_ASSERT_NO_ALLOC { ring.push(item); }
+ * \endcode */
+#define UT_ASSERT_NO_ALLOC UT_ASSERT_MAX_ALLOCS_MSG(0, "")
+
+/**
+ * \def UT_ASSERT_INSTRUCTIONS_LESS_MSG
+ * @param the_expr The expression to measure.  Its result is ignored.
+ * @param n        The number of user space instructions it must take fewer of.
+ * @param _msg     The message to include in the test event.
+ *
+ * @brief Assert true if evaluating the_expr retires fewer than n instructions, as counted by
+ * the processor's performance counters.  Unlike time, the count is the same from run to
+ * run.  Where the counters can not be opened the assertion passes, and says so in its
+ * message. */
+#define UT_ASSERT_INSTRUCTIONS_LESS_MSG(the_expr, n, _msg) 	\
+	{ \
+	std::string __perf_report__; \
+	unittest::PerfMeasure __perf_measure__; \
+	__event__.pass = UT_EVALUATE_EXPR((__perf_measure__.start(), (void)(the_expr), __perf_measure__.stop()), false) && \
+	                 unittest::checkInstructionsLess(__perf_measure__, (n), __perf_report__); \
+ 	__event__.expr = #the_expr " in fewer than " #n " instructions";	    \
+ 	__event__.msg =  _msg;					    \
+ 	if (!__perf_report__.empty()) __event__.msg += (__event__.msg.empty() ? "" : "\n") + __perf_report__; \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
+ 	__event__.line_num = __LINE__;			    \
+ 												\
+ 	listener->OnEvent(__event__); \
+	}
+
+/**
+ * \def UT_ASSERT_INSTRUCTIONS_LESS
+ * @brief Assert true if evaluating the_expr retires fewer than n instructions. */
+#define UT_ASSERT_INSTRUCTIONS_LESS(the_expr, n) UT_ASSERT_INSTRUCTIONS_LESS_MSG(the_expr, n, "")
+
 /**
  * \def UT_ASSERT_BUG_MSG
   * @param _msg  The message to include in the test event.
@@ -496,7 +777,7 @@
 	__event__.pass = false; \
  	__event__.expr = "--BUG--";					    \
  	__event__.msg =  _msg;					    \
- 	__event__.filename = __FILE__ "::" __TEST_NAME__;			    \
+ 	__event__.filename = __FILE__ "::"; __event__.filename += __TEST_NAME__;			    \
  	__event__.line_num = __LINE__;			    \
  												\
  	listener->OnEvent(__event__);
@@ -511,6 +792,11 @@
  *  @brief unittest.py script directives
  * @{
  *
+ *  The fixture and test directives are also real macros, so a test file
+ * that includes unittest/unittest.h may be compiled as it is, without
+ * unittest.py.  Each fixture is then put in a table by the linker and run
+ * from there.  Only UT_FIXTURE, UT_FRESH_FIXTURE, the setups and teardowns
+ * and UT_TEST may be used that way; the rest need unittest.py.
  */
 
 /**
@@ -521,12 +807,23 @@
  * The fixture will automatically be registered with the test suite. Any
  * text that is not part of a fixture will be copied straight into the 
  * resulting C++ fixture class. */
-#define UT_FIXTURE(name)
+#define UT_FIXTURE(name) \
+	class test_##name; \
+	UT_REGISTER_FIXTURE(name) \
+	class test_##name : public unittest::RegisteredFixture<test_##name> \
+	{ \
+		typedef test_##name __ut_fixture__; \
+	public: \
+		enum { __ut_first__ = __COUNTER__ + 1 }; \
+		test_##name():unittest::RegisteredFixture<test_##name>(#name) {}
 
 /** 
  * \def UT_FIXTURE_END 
  * Defines the end of a fixture. */
-#define UT_FIXTURE_END
+#define UT_FIXTURE_END \
+	public: \
+		enum { __ut_count__ = __COUNTER__ - __ut_first__ }; \
+	};
 
 /** 
  * \def UT_SETUP_FIXTURE 
@@ -535,13 +832,13 @@
  * before any tests are run.  There may be only one setup per
  * fixture. This declaration may only
  * appear between UT_FIXTURE and UT_FIXTURE_END. */
-#define UT_SETUP_FIXTURE
+#define UT_SETUP_FIXTURE public: virtual void setup() {
 
  
 /** 
  * \def UT_SETUP_FIXTURE_END 
  * Defines the end of the fixture setup routine. */
-#define UT_SETUP_FIXTURE_END
+#define UT_SETUP_FIXTURE_END }
  
 
 /**
@@ -550,15 +847,62 @@
  * after all tests are run.  There may be only one teardown per
  * fixture. This declaration may only
  * appear between UT_FIXTURE and UT_FIXTURE_END. */
-#define UT_TEARDOWN_FIXTURE
+#define UT_TEARDOWN_FIXTURE public: virtual void teardown() {
 
 
 /**
  * \def UT_TEARDOWN_FIXTURE_END	 
  * Defines the end of the fixture teardown routine. */
-#define UT_TEARDOWN_FIXTURE_END
+#define UT_TEARDOWN_FIXTURE_END }
 
 
+/** 
+ * \def UT_SETUP_TEST 
+ * Defines the start of a test setup.  This will be run before
+ * every test.  This declaration may only appear between UT_FIXTURE
+ * and UT_FIXTURE_END. */
+#define UT_SETUP_TEST public: virtual void setupTest() {
+
+/** 
+ * \def UT_SETUP_TEST_END 
+ * Defines the end of the test setup routine. */
+#define UT_SETUP_TEST_END }
+
+/** 
+ * \def UT_TEARDOWN_TEST 
+ * Defines the start of a test teardown.  This will be run after
+ * every test.  This declaration may only appear between UT_FIXTURE
+ * and UT_FIXTURE_END. */
+#define UT_TEARDOWN_TEST public: virtual void teardownTest() {
+
+/** 
+ * \def UT_TEARDOWN_TEST_END 
+ * Defines the end of the test teardown routine. */
+#define UT_TEARDOWN_TEST_END }
+
+/** 
+ * \def UT_FRESH_FIXTURE 
+ * Runs every test of the fixture on a new instance of the fixture,
+ * with its own fixture setup and teardown, so tests cannot see each
+ * other's changes.  This declaration may only appear between
+ * UT_FIXTURE and UT_FIXTURE_END. */
+#define UT_FRESH_FIXTURE public: enum { __ut_fresh__ = 1 };
+
+/** 
+ * \def UT_GLOBAL
+ * @param name The name of the global. 
+ *
+ * Defines the start of state shared by all fixtures.  It may have a
+ * UT_SETUP_FIXTURE and UT_TEARDOWN_FIXTURE, which run once before
+ * the first fixture and once after the last.  Fixtures later in the
+ * same file see it as a const object called name. */
+#define UT_GLOBAL(name)
+
+/** 
+ * \def UT_GLOBAL_END 
+ * Defines the end of a global. */
+#define UT_GLOBAL_END
+
 /** 
  * \def UT_TEST
  * @param name The name of the test. 
@@ -566,12 +910,68 @@
  * Defines the start of a test.  This declaration may only
  * appear between UT_FIXTURE and UT_FIXTURE_END. Tests are
  * automatically registered with the fixture. */
-#define UT_TEST(name)
+#define UT_TEST(name) \
+	static unittest::TestInfo<__ut_fixture__> __ut_test__(unittest::TestIndex<__COUNTER__ - __ut_first__>) \
+	{ \
+		unittest::TestInfo<__ut_fixture__> info = { #name, &__ut_fixture__::test_##name, __FILE__, __LINE__ }; \
+		return info; \
+	} \
+	void test_##name() \
+	{ \
+		const char *const __ut_test_name__ = testName(__current_test__); \
+		unittest::Event __event__; \
+		(void)__ut_test_name__;
 
 /** 
  * \def UT_TEST_END 
  * Defines the end of a test. */
-#define UT_TEST_END
+#define UT_TEST_END }
+
+/** 
+ * \def UT_TEST_P
+ * @param name The name of the test. 
+ * @param source The rows, such as <tt>unittest::CsvRows("vectors.csv")</tt>.
+ *
+ * Defines the start of a test that is run once for every row of a
+ * source, which the body sees as row.  Sources are
+ * unittest::table() of a UT_TABLE, unittest::CsvRows and
+ * unittest::BinaryRows.  Each row is reported as a test of its own.
+ * If <tt>parallel</tt> is given as a third argument the rows are run
+ * on several threads.  Ends with UT_TEST_END. */
+#define UT_TEST_P(name, source)
+
+/** 
+ * \def UT_TABLE
+ * @param type The type of a row. 
+ * @param name The name of the table. 
+ *
+ * Defines the start of a table of rows for UT_TEST_P.  Each line
+ * is an initializer for one row, such as <tt>{ 2, 4 },</tt>.  This
+ * declaration may only appear outside fixtures. */
+#define UT_TABLE(type, name)
+
+/** 
+ * \def UT_TABLE_END 
+ * Defines the end of a table. */
+#define UT_TABLE_END
+
+/** 
+ * \def UT_PROPERTY
+ * @param name The name of the property. 
+ * @param inputs Inputs such as <tt>value = unittest::Ints(0, 100)</tt>, at most four.
+ *
+ * Defines the start of a property.  The body is run for many random
+ * values of the inputs, and should check them with UT_PROPERTY_CHECK.
+ * It is run on several threads, so it may not use the fixture.  A
+ * failing case is shrunk to a simpler one, which is reported with the
+ * seed that repeats it.  This declaration may only appear between
+ * UT_FIXTURE and UT_FIXTURE_END. */
+#define UT_PROPERTY(name, inputs)
+
+/** 
+ * \def UT_PROPERTY_END 
+ * Defines the end of a property. */
+#define UT_PROPERTY_END
 
 /** 
  * \def UT_INCLUDE
@@ -0,0 +1,279 @@
+#ifndef __TEST_BENCHMARK_H__
+#define __TEST_BENCHMARK_H__
+
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include "config.h"
+#include "listener.h"
+#include "options.h"
+#include "threads.h"
+#include "perf_counters.h"
+
+#if defined(__has_include)
+#if __has_include(<valgrind/callgrind.h>)
+#include <valgrind/callgrind.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#define UT_HAVE_CALLGRIND
+#endif
+#endif
+
+/**
+ * \def UT_BENCHMARK
+ * @param name The name of the benchmark, such as "AFixedPoint::Set".
+ *
+ * @brief Runs the block that follows many times and reports what one run of it
+ * costs, as the metric "name/instructions" or, if it is timed, "name/ns":
+ * \code
+ * UT_BENCHMARK("AFixedPoint::Set") { fp.Set(x); }
+ * \endcode */
+#define UT_BENCHMARK(name) \
+	for(unittest::Benchmark __benchmark__(name, listener, __TEST_NAME__); __benchmark__.running(); __benchmark__.next())
+
+namespace unittest
+{
+	/** How benchmarks are measured. */
+	enum BenchmarkMode
+	{
+		/** Retired user space instructions, from the hardware counters. */
+		benchmark_instructions,
+
+		/** Instructions counted by callgrind, which the test binary runs under. */
+		benchmark_callgrind,
+
+		/** Elapsed time. */
+		benchmark_time
+	};
+
+	/** @brief Returns how benchmarks are measured.
+	 *
+	 *  Instructions are counted if the hardware counters can be opened, or
+	 * by callgrind if the test binary runs under it; otherwise benchmarks are
+	 * timed, with a warning.  --benchmark=time times them anyway. */
+	inline BenchmarkMode benchmarkMode()
+	{
+		static int mode = -1;
+		if (mode >= 0) return BenchmarkMode(mode);
+
+#ifdef UT_HAVE_CALLGRIND
+		if (RUNNING_ON_VALGRIND) return BenchmarkMode(mode = benchmark_callgrind);
+#endif
+
+		if (getOptions().get("benchmark") == "time") return BenchmarkMode(mode = benchmark_time);
+		if (perfGroup().available()) return BenchmarkMode(mode = benchmark_instructions);
+
+		std::cerr << "warning: hardware counters are not available, so benchmarks are timed" << std::endl;
+		return BenchmarkMode(mode = benchmark_time);
+	}
+
+	/** @brief Runs a UT_BENCHMARK block and reports what it costs.
+	 *
+	 *  The block runs once for warming up, then --benchmark-repetitions
+	 * times (5 by default) --benchmark-iterations times in a row (1000 by
+	 * default).  The cost of one run is taken from the cheapest repetition,
+	 * since anything else that happens, such as an interrupt, can only add to
+	 * it.  Counting instructions this way gives the same result from run to
+	 * run to well within 0.1%.  Each benchmark reports the metrics
+	 * "name/instructions" or "name/ns", "name/iterations", and
+	 * "name/spread", how far the dearest repetition was above the cheapest.
+	 *
+	 *  The loop around the block costs a few instructions an iteration of
+	 * its own.  It is measured once on each thread, on an empty block, taken
+	 * off every result and reported as "name/overhead".
+	 *
+	 *  Under callgrind the repetitions are left out, as its counts do not
+	 * vary, and the count of each benchmark is dumped under the test and
+	 * benchmark name for callgrind_annotate to show.  The dump is the only
+	 * measurement: it is reported as "name/callgrind-dump", the part n of
+	 * callgrind.out.<pid>.n, and its total, read back from that file, as
+	 * "name/instructions".  If --callgrind-out-file puts the dump elsewhere
+	 * only the part is reported, and the count is in the dump alone. */
+	class Benchmark
+	{
+		Listener &listener;
+		std::string test, name;
+		BenchmarkMode mode;
+		PerfMeasure measure;
+
+		/** The block runs iterations times in each of repetitions, after the
+		 * first. */
+		uint64_t iterations, left;
+		int repetitions, repetition;
+
+		/** The cheapest and dearest repetitions so far. */
+		double least, most;
+
+		uint64_t started;
+
+		/** What the loop costs an iteration, taken off the cost of the block. */
+		double overhead;
+
+		/** The part of the callgrind output this benchmark was dumped to. */
+		int dump;
+
+		Benchmark(const Benchmark &);
+		Benchmark& operator=(const Benchmark &);
+
+		void start()
+		{
+			left = repetition == 0 ? 1 : iterations;
+
+			switch(mode)
+			{
+			case benchmark_instructions:
+				measure.start();
+				break;
+
+			case benchmark_callgrind:
+#ifdef UT_HAVE_CALLGRIND
+				if (repetition == 1) CALLGRIND_ZERO_STATS;
+#endif
+				break;
+
+			case benchmark_time:
+				started = monotonicClock();
+				break;
+			}
+		}
+
+		/** Ends a repetition, and starts the next one or reports. */
+		void lap()
+		{
+			double cost = 0;
+
+			switch(mode)
+			{
+			case benchmark_instructions:
+				measure.stop();
+				cost = double(measure.count(perf_instructions));
+				break;
+
+			case benchmark_callgrind:
+#ifdef UT_HAVE_CALLGRIND
+				if (repetition == 1)
+				{
+					CALLGRIND_DUMP_STATS_AT((test + "/" + name).c_str());
+					dump = ++callgrindDumps();
+					cost = callgrindTotal(dump);
+				}
+#endif
+				break;
+
+			case benchmark_time:
+				cost = double(monotonicClock() - started);
+				break;
+			}
+
+			if (repetition > 0)
+			{
+				cost /= iterations;
+				if (repetition == 1 || cost < least) least = cost;
+				if (repetition == 1 || cost > most) most = cost;
+			}
+
+			if (++repetition <= repetitions) start();
+			else report();
+		}
+
+		void report()
+		{
+			double cost = std::max(0.0, least - overhead);
+
+			if (mode == benchmark_instructions) listener.OnMetric(test, name + "/instructions", cost);
+			if (mode == benchmark_time) listener.OnMetric(test, name + "/ns", cost);
+
+			if (mode == benchmark_callgrind)
+			{
+				if (least >= 0) listener.OnMetric(test, name + "/instructions", least);
+				listener.OnMetric(test, name + "/callgrind-dump", dump);
+			}
+
+			listener.OnMetric(test, name + "/iterations", double(iterations));
+
+			if (mode != benchmark_callgrind)
+			{
+				listener.OnMetric(test, name + "/spread", least > 0 ? (most - least) / least : 0);
+				listener.OnMetric(test, name + "/overhead", overhead);
+			}
+		}
+
+#ifdef UT_HAVE_CALLGRIND
+		/** The number of dumps made so far, each a part of the callgrind output. */
+		static int& callgrindDumps()
+		{
+			static int dumps = 0;
+			return dumps;
+		}
+
+		/** Reads the total of part of callgrind's output, from the file it
+		 * writes by default, or returns -1 if there is no such file. */
+		static double callgrindTotal(int part)
+		{
+			std::ostringstream path;
+			path << "callgrind.out." << getpid() << "." << part;
+
+			std::ifstream in(path.str().c_str());
+			std::string line;
+			double total = -1;
+
+			while(std::getline(in, line))
+				if (line.compare(0, 8, "summary:") == 0 || line.compare(0, 7, "totals:") == 0)
+					total = strtod(line.c_str() + line.find(':') + 1, NULL);
+
+			return total;
+		}
+#endif
+
+		/** What the loop costs an iteration on this thread, or -1 until it
+		 * is measured. */
+		static double& loopOverhead()
+		{
+			static __thread double cost = -1;
+			return cost;
+		}
+
+		/** Runs an empty block as a benchmark runs one, and returns what an
+		 * iteration of it costs.  The barrier keeps the loop from being folded
+		 * away, as the call in a real block would. */
+		static double calibrate()
+		{
+			Listener quiet;
+			Benchmark empty("", &quiet, "");
+
+			for(; empty.running(); empty.next()) __asm__ __volatile__("" ::: "memory");
+
+			return empty.least;
+		}
+
+	public:
+		Benchmark(const char *_name, Listener *_listener, const char *_test):
+			listener(*_listener), test(_test), name(_name), mode(benchmarkMode()),
+			left(0), repetition(0), least(0), most(0), started(0), overhead(0), dump(0)
+		{
+			iterations = std::max(1L, getOptions().getInt("benchmark-iterations", 1000));
+			repetitions = mode == benchmark_callgrind ? 1 : int(std::max(1L, getOptions().getInt("benchmark-repetitions", 5)));
+
+			// Calibrated with nothing taken off; callgrind counts are left as they are.
+			if (mode != benchmark_callgrind && loopOverhead() < 0)
+			{
+				loopOverhead() = 0;
+				loopOverhead() = calibrate();
+			}
+
+			if (mode != benchmark_callgrind) overhead = loopOverhead();
+
+			start();
+		}
+
+		/** Returns true until every repetition has run. */
+		bool running() const { return repetition <= repetitions; }
+
+		/** Called after each run of the block. */
+		void next() { if (--left == 0) lap(); }
+	};
+}
+
+#endif
@@ -0,0 +1,301 @@
+#ifndef __BINARY_OUTPUTTER_H__
+#define __BINARY_OUTPUTTER_H__
+
+#include <string>
+#include <cstring>
+#include <iostream>
+#include "listener.h"
+
+namespace unittest
+{
+	/** The magic bytes at the start of a binary event log. */
+	static const char binary_log_magic[] = "UTLOG001";
+
+	/** The size of the magic bytes, without the terminator. */
+	static const size_t binary_log_magic_size = sizeof(binary_log_magic) - 1;
+
+	/** Tags for the records in a binary event stream. */
+	enum BinaryRecord
+	{
+		BIN_SUITE_START = 1,
+		BIN_FIXTURE_START,
+		BIN_EVENT,
+		BIN_FIXTURE_DONE,
+		BIN_SUITE_DONE,
+		BIN_METRIC,
+		BIN_TEST_START,
+		BIN_TEST_DONE
+	};
+
+	/** Appends listener callbacks to a buffer as binary records.  Each record
+	 * is a one byte tag followed by its fields.  Integers are little endian and
+	 * strings are prefixed with their 32 bit length. */
+	class BinaryEncoder
+	{
+		/** The encoded records. */
+		std::string buf;
+
+	public:
+
+		void putU8(uint8_t v) { buf.push_back(static_cast<char>(v)); }
+
+		void putU32(uint32_t v)
+		{
+			for(int i=0; i<4; ++i) buf.push_back(static_cast<char>((v >> (i*8)) & 0xff));
+		}
+
+		void putString(const std::string &v)
+		{
+			putU32(static_cast<uint32_t>(v.size()));
+			buf.append(v);
+		}
+
+		/** Doubles are written as the 64 bits of their IEEE form. */
+		void putDouble(double v)
+		{
+			uint64_t bits;
+			std::memcpy(&bits, &v, sizeof(bits));
+
+			putU32(static_cast<uint32_t>(bits));
+			putU32(static_cast<uint32_t>(bits >> 32));
+		}
+
+		void suiteStart()   { putU8(BIN_SUITE_START); }
+		void fixtureDone()  { putU8(BIN_FIXTURE_DONE); }
+		void suiteDone()    { putU8(BIN_SUITE_DONE); }
+
+		void fixtureStart(const std::string &name)
+		{
+			putU8(BIN_FIXTURE_START);
+			putString(name);
+		}
+
+		void event(const Event &e)
+		{
+			putU8(BIN_EVENT);
+			putU8(e.pass ? 1 : 0);
+			putU32(e.line_num);
+			putU32(e.total_tests);
+			putU32(e.current_test);
+			putString(e.filename);
+			putString(e.expr);
+			putString(e.msg);
+		}
+
+		void testStart(const std::string &name)
+		{
+			putU8(BIN_TEST_START);
+			putString(name);
+		}
+
+		void testDone(const std::string &name)
+		{
+			putU8(BIN_TEST_DONE);
+			putString(name);
+		}
+
+		void metric(const std::string &test, const std::string &name, double value)
+		{
+			putU8(BIN_METRIC);
+			putString(test);
+			putString(name);
+			putDouble(value);
+		}
+
+		/** Returns the encoded records. */
+		const std::string& data() const { return buf; }
+
+		/** Discards the encoded records. */
+		void clear() { buf.clear(); }
+	};
+
+	/** Reads records written by a BinaryEncoder and replays them into a listener. */
+	class BinaryDecoder
+	{
+		/** The next unread byte. */
+		const char *pos;
+
+		/** One past the last byte. */
+		const char *end;
+
+	public:
+		BinaryDecoder(const char *data, size_t size):pos(data), end(data+size) {}
+
+		/** Returns the number of unread bytes. */
+		size_t remaining() const { return end - pos; }
+
+		bool getU8(uint8_t &v)
+		{
+			if (pos >= end) return false;
+			v = static_cast<uint8_t>(*pos++);
+			return true;
+		}
+
+		bool getU32(uint32_t &v)
+		{
+			if (end - pos < 4) return false;
+
+			v = 0;
+			for(int i=0; i<4; ++i) v |= static_cast<uint32_t>(static_cast<uint8_t>(*pos++)) << (i*8);
+			return true;
+		}
+
+		bool getString(std::string &v)
+		{
+			uint32_t size;
+			if (!getU32(size) || static_cast<size_t>(end - pos) < size) return false;
+
+			v.assign(pos, size);
+			pos += size;
+			return true;
+		}
+
+		bool getDouble(double &v)
+		{
+			uint32_t low, high;
+			if (!getU32(low) || !getU32(high)) return false;
+
+			uint64_t bits = (static_cast<uint64_t>(high) << 32) | low;
+			std::memcpy(&v, &bits, sizeof(v));
+			return true;
+		}
+
+		/** Decodes the next record into e or name; a metric is decoded into
+		 * name, its test, and metric and value.  Returns the record tag, or 0
+		 * at the end of the data or on a truncated record.  A truncated record is
+		 * left unread. */
+		int next(Event &e, std::string &name, std::string &metric, double &value)
+		{
+			const char *start = pos;
+			uint8_t tag, pass;
+			bool ok = getU8(tag);
+
+			if (ok) switch(tag)
+			{
+			case BIN_SUITE_START:
+			case BIN_FIXTURE_DONE:
+			case BIN_SUITE_DONE:
+				break;
+
+			case BIN_FIXTURE_START:
+			case BIN_TEST_START:
+			case BIN_TEST_DONE:
+				ok = getString(name);
+				break;
+
+			case BIN_EVENT:
+				ok = getU8(pass) && getU32(e.line_num) && getU32(e.total_tests) && getU32(e.current_test)
+				  && getString(e.filename) && getString(e.expr) && getString(e.msg);
+				e.pass = (pass != 0);
+				break;
+
+			case BIN_METRIC:
+				ok = getString(name) && getString(metric) && getDouble(value);
+				break;
+
+			default:
+				ok = false;
+			}
+
+			if (!ok)
+			{
+				pos = start;
+				return 0;
+			}
+
+			return tag;
+		}
+
+		/** Decodes the next record and hands it to the listener.  Returns false at
+		 * the end of the data or on a truncated record. */
+		bool replay(Listener &l)
+		{
+			Event e;
+			std::string name, metric;
+			double value;
+
+			switch(next(e, name, metric, value))
+			{
+			case BIN_SUITE_START:   l.OnSuiteStart(); break;
+			case BIN_FIXTURE_START: l.OnFixtureStart(name); break;
+			case BIN_EVENT:         l.OnEvent(e); break;
+			case BIN_FIXTURE_DONE:  l.OnFixtureDone(); break;
+			case BIN_SUITE_DONE:    l.OnSuiteDone(); break;
+			case BIN_METRIC:        l.OnMetric(name, metric, value); break;
+			case BIN_TEST_START:    l.OnTestStart(name); break;
+			case BIN_TEST_DONE:     l.OnTestDone(name); break;
+			default:                return false;
+			}
+
+			return true;
+		}
+	};
+
+	/** @brief Writes events to a compact binary log.
+	 *
+	 *  The log starts with binary_log_magic followed by BinaryEncoder records.
+	 * Records are buffered and written once per fixture. */
+	class BinaryOutputter : public Listener
+	{
+		/** The stream the log is written to. */
+		std::ostream &out;
+
+		/** Records not yet written. */
+		BinaryEncoder enc;
+
+		/** Writes the buffered records. */
+		void flush()
+		{
+			out.write(enc.data().data(), enc.data().size());
+			out.flush();
+			enc.clear();
+		}
+
+	public:
+		/** Constructs an outputter that writes to the given stream. */
+		BinaryOutputter(std::ostream &_out):out(_out) {}
+
+		/** Handles event catches. */
+		virtual void OnEvent(Event &e)
+		{
+			Listener::OnEvent(e);
+
+			enc.event(e);
+		}
+
+		/** Called when the suite is about to start. */
+		virtual void OnSuiteStart()
+		{
+			out.write(binary_log_magic, binary_log_magic_size);
+			enc.suiteStart();
+		}
+
+		/** When a fixture is starting, this is called. */
+		virtual void OnFixtureStart(const std::string &name)
+		{
+			enc.fixtureStart(name);
+		}
+
+		/** Records a metric, such as a benchmark result. */
+		virtual void OnMetric(const std::string &test, const std::string &name, double value)
+		{
+			enc.metric(test, name, value);
+		}
+
+		/** When a fixture is done with all it's tests, this is called. */
+		virtual void OnFixtureDone()
+		{
+			enc.fixtureDone();
+			flush();
+		}
+
+		/** When a suite is done with all it's tests, this is called. */
+		virtual void OnSuiteDone()
+		{
+			enc.suiteDone();
+			flush();
+		}
+	};
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <vector>
 #include <iostream>
 #include "listener.h"
+#include "options.h"
 
 namespace unittest
 {
@@ -16,7 +17,12 @@ namespace unittest
 		/** The list of events processed. */
 		event_list events;
 		
+		/** The stream the output is written to. */
+		std::ostream &out;
+		
 	public:
+		/** Constructs an outputter that writes to the given stream. */
+		CompilerOutputter(std::ostream &_out = std::cout):out(_out) {}
 	
 		/** Handles event catches. */		
 		virtual void OnEvent(Event &e)
@@ -25,8 +31,8 @@ namespace unittest
 			
 			events.push_back(e);
 			
-			if (e.pass) std::cout << ".";
-			else		std::cout << "f";						
+			if (e.pass) out << ".";
+			else		out << "f";						
 		}
 		
 		/** When a fixture is done with all it's tests, this is called. */
@@ -34,33 +40,53 @@ namespace unittest
 		{
 			Listener::OnFixtureDone();	
 			
-			std::cout << std::endl;
+			out << std::endl;
 		}
 		
 		/** When a suite is done with all it's tests, this is called. */
 		virtual void OnSuiteDone()
 		{
 			Listener::OnSuiteDone();				
+			Summary s = getSummary();
 			
-			std::cout << std::endl << std::endl;
+			out << std::endl << std::endl;
 			
 			for(event_list::iterator pos=events.begin(); pos!=events.end(); ++pos)
 			{
-				if (!(pos->pass))
+				if (!(pos->pass) && pos->expr != "--FLAKY--")
 				{
-					std::cout << pos->filename.substr(0, pos->filename.find(':')) << ":" << pos->line_num << ":1: " 
+					out << pos->filename.substr(0, pos->filename.find(':')) << ":" << pos->line_num << ":1: " 
 						      << pos->expr << " failed";
 					
-					if (pos->msg.size()>0) std::cout << " : " << pos->msg; 
+					if (pos->msg.size()>0) out << " : " << pos->msg; 
 					
-					std::cout << std::endl;
+					out << std::endl;
 				}					 
 			}
 			
-			std::cout << std::endl 
+			// Flaky tests, from repeated runs, are listed on their own.
+			bool flaky = false;
+			
+			for(event_list::iterator pos=events.begin(); pos!=events.end(); ++pos)
+			{
+				if (pos->pass || pos->expr != "--FLAKY--") continue;
+				
+				if (!flaky) out << std::endl << "Flaky tests:" << std::endl;
+				flaky = true;
+				
+				out << pos->filename.substr(0, pos->filename.find(':')) << ":" << pos->line_num << ":1: "
+				    << pos->filename.substr(pos->filename.find("::") + 2) << " is flaky : " << pos->msg << std::endl;
+			}
+			
+			out << std::endl 
 				 << s.failures << " failures" << std::endl
 				 << s.passes   << " passes" << std::endl
-				 << s.event_count << " total events" << std::endl << std::endl;			
+				 << s.event_count << " total events" << std::endl;
+			
+			// The seed of a shuffled or repeated run, so it can be run again.
+			if (getOptions().has("seed")) out << "seed " << getOptions().get("seed") << std::endl;
+			
+			out << std::endl;			
 		}
 		
 	};
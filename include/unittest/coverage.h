@@ -0,0 +1,572 @@
+#ifndef __TEST_COVERAGE_H__
+#define __TEST_COVERAGE_H__
+
+#ifndef _WIN32
+
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <link.h>
+#include <unistd.h>
+#include "config.h"
+#include "instruments.h"
+#include "options.h"
+#include "suite.h"
+
+/* Code that records coverage must not be instrumented itself.  Older
+ * compilers have no way to say so, and the file that defines
+ * UT_TRACE_COVERAGE has to be built without -fsanitize-coverage. */
+#if defined(__clang__)
+#define UT_NO_COVERAGE __attribute__((no_sanitize("coverage")))
+#elif __GNUC__ >= 12
+#define UT_NO_COVERAGE __attribute__((no_sanitize_coverage))
+#else
+#define UT_NO_COVERAGE
+#endif
+
+namespace unittest
+{
+	/** @brief The code hit since the table was last emptied.
+	 *
+	 *  The __sanitizer_cov_trace_pc() that UT_TRACE_COVERAGE puts in the
+	 * test binary adds the address of every basic block it is called from.
+	 * Each address is kept once, in an open addressed hash table, so code
+	 * that runs over and over costs one compare.  It is plain data, so it
+	 * needs no construction.
+	 *
+	 *  An address that cannot be placed is dropped, and dropped is set, so
+	 * the code it stands for is not missed without anyone knowing. */
+	struct CoverageTable
+	{
+		enum { size = 1 << 18 };
+
+		/** True while hits are recorded. */
+		volatile bool recording;
+
+		/** Set when an address is dropped. */
+		volatile bool dropped;
+
+		/** The addresses hit, and which slots hold them. */
+		uintptr_t slots[size];
+		uint32_t filled[size];
+		volatile uint32_t used;
+
+		/** Adds an address.  It is dropped if it can not be placed in a few probes. */
+		UT_NO_COVERAGE __attribute__((always_inline)) void hit(uintptr_t pc)
+		{
+			uint32_t h = uint32_t((uint64_t(pc) * 0x9E3779B97F4A7C15ULL) >> 46) & (size - 1);
+
+			for(int probe=0; probe<64; ++probe, h = (h + 1) & (size - 1))
+			{
+				uintptr_t seen = slots[h];
+				if (seen == pc) return;
+				if (seen != 0) continue;
+
+				if (__sync_bool_compare_and_swap(&slots[h], uintptr_t(0), pc))
+				{
+					uint32_t n = __sync_fetch_and_add(&used, 1);
+					if (n < size) filled[n] = h;
+					else dropped = true;
+					return;
+				}
+
+				if (slots[h] == pc) return;
+			}
+
+			dropped = true;
+		}
+
+		/** Returns true if an address was dropped since it was last asked,
+		 * and clears it. */
+		bool takeDropped()
+		{
+			bool was = dropped;
+			dropped = false;
+			return was;
+		}
+
+		/** Adds the addresses hit to pcs, and empties the table. */
+		void take(std::vector<uintptr_t> &pcs)
+		{
+			uint32_t n = used < uint32_t(size) ? used : uint32_t(size);
+
+			for(uint32_t i=0; i<n; ++i)
+			{
+				pcs.push_back(slots[filled[i]]);
+				slots[filled[i]] = 0;
+			}
+
+			used = 0;
+		}
+	};
+
+	UT_NO_COVERAGE __attribute__((always_inline)) inline CoverageTable& coverageTable()
+	{
+		static CoverageTable table;
+		return table;
+	}
+
+	/** The depth of pause() on this thread.  Hits on a thread that is
+	 * paused are not recorded; other threads go on recording. */
+	UT_NO_COVERAGE __attribute__((always_inline)) inline int& coveragePaused()
+	{
+		static __thread int depth = 0;
+		return depth;
+	}
+
+	/** Returns true once the coverage callback is linked in. */
+	inline bool& coverageTraced()
+	{
+		static bool traced = false;
+		return traced;
+	}
+
+	/** Sorts addresses and removes the repeats. */
+	inline void uniqueAddresses(std::vector<uintptr_t> &pcs)
+	{
+		std::sort(pcs.begin(), pcs.end());
+		pcs.erase(std::unique(pcs.begin(), pcs.end()), pcs.end());
+	}
+
+	/** Finds the source files of code addresses with addr2line, which needs
+	 * the binary built with -g.  Each address gets every file it was
+	 * inlined from, so code in headers is found too.  Some versions of
+	 * addr2line misread the files of DWARF 5, so unittest.py builds with
+	 * -gdwarf-4. */
+	inline void sourceFiles(const std::vector<uintptr_t> &pcs, std::map<uintptr_t, std::vector<std::string> > &files)
+	{
+		// The addresses to look up in each object, and the address each stands for.
+		typedef std::map<std::string, std::vector<std::pair<uintptr_t, uintptr_t> > > object_map;
+		object_map objects;
+
+		for(size_t i=0; i<pcs.size(); ++i)
+		{
+			Dl_info info;
+			if (!dladdr(reinterpret_cast<void *>(pcs[i]), &info) || info.dli_fname == NULL) continue;
+
+			// Objects linked to load anywhere are looked up by offset.  The
+			// call was made just before the address it returns to.
+			const ElfW(Ehdr) *header = static_cast<const ElfW(Ehdr) *>(info.dli_fbase);
+			uintptr_t addr = pcs[i] - 1;
+			if (header->e_type == ET_DYN) addr -= reinterpret_cast<uintptr_t>(info.dli_fbase);
+
+			std::string object = info.dli_fname;
+			if (object.empty() || access(object.c_str(), R_OK) != 0) object = "/proc/self/exe";
+
+			objects[object].push_back(std::make_pair(addr, pcs[i]));
+		}
+
+		for(object_map::iterator pos=objects.begin(); pos!=objects.end(); ++pos)
+		{
+			const char *tmp = std::getenv("TMPDIR");
+			std::string list = std::string(tmp ? tmp : "/tmp") + "/unittest_impact_XXXXXX";
+			int fd = mkstemp(&list[0]);
+			if (fd < 0) continue;
+
+			std::ostringstream addresses;
+			for(size_t i=0; i<pos->second.size(); ++i) addresses << std::hex << "0x" << pos->second[i].first << "\n";
+
+			std::string text = addresses.str();
+			bool written = write(fd, text.data(), text.size()) == ssize_t(text.size());
+			close(fd);
+
+			FILE *out = written ? popen(("addr2line -a -i -e '" + pos->first + "' < " + list).c_str(), "r") : NULL;
+
+			if (out != NULL)
+			{
+				char line[4096];
+				long index = -1;
+
+				// Each address is echoed, then followed by a file:line for it and
+				// for each function it was inlined into.
+				while (std::fgets(line, sizeof(line), out) != NULL)
+				{
+					std::string s(line);
+					s.erase(s.find_last_not_of("\r\n") + 1);
+
+					if (s.compare(0, 2, "0x") == 0)
+					{
+						++index;
+						continue;
+					}
+
+					size_t colon = s.rfind(':');
+					if (colon != std::string::npos) s.erase(colon);
+					if (index < 0 || size_t(index) >= pos->second.size() || s.empty() || s == "??") continue;
+
+					std::vector<std::string> &f = files[pos->second[index].second];
+					if (std::find(f.begin(), f.end(), s) == f.end()) f.push_back(s);
+				}
+
+				pclose(out);
+			}
+
+			unlink(list.c_str());
+		}
+	}
+
+	/** @brief Records the code every test runs, for test impact analysis.
+	 *
+	 *  Code run between two tests, such as the setup and teardown of a
+	 * fixture, counts for every test of the fixtures before and after it,
+	 * and code run before the first test, such as the setup of globals,
+	 * counts for every test.  write() turns the addresses into source
+	 * files and writes the impact index, which lists the tests, then each
+	 * file, a tab, and the numbers of the tests that ran code from it.  A
+	 * test some of whose code the table dropped is also listed as
+	 * incomplete, and is selected whatever changed. */
+	class CoverageInstrument : public Instrument
+	{
+		typedef std::map<std::string, std::vector<uintptr_t> > hit_map;
+
+		/** The code each test ran, and the code run between the tests of each fixture. */
+		hit_map tests, fixtures;
+
+		/** The code run before the first test. */
+		std::vector<uintptr_t> suite;
+
+		/** The code run since the last test, and the fixture of the last test. */
+		std::vector<uintptr_t> between;
+		std::string last_fixture;
+
+		/** The tests and fixtures that ran code the table dropped, and
+		 * whether code run before the first test was dropped. */
+		std::set<std::string> incomplete;
+		bool suite_incomplete;
+
+		/** Marks the code since the last test as incomplete, if the table
+		 * dropped any of it. */
+		void checkBetween()
+		{
+			if (!coverageTable().takeDropped()) return;
+
+			if (last_fixture.empty()) suite_incomplete = true;
+			else incomplete.insert(last_fixture);
+		}
+
+		/** Returns the fixture of a test, "Fixture::test". */
+		static std::string fixtureOf(const std::string &test) { return test.substr(0, test.find("::")); }
+
+		/** Writes a list of numbers, with runs written as "first-last". */
+		static void writeIds(std::ostream &out, const std::vector<unsigned int> &ids)
+		{
+			for(size_t i=0; i<ids.size(); )
+			{
+				size_t end = i;
+				while (end + 1 < ids.size() && ids[end + 1] == ids[end] + 1) ++end;
+
+				out << (i ? " " : "") << ids[i];
+				if (end > i) out << "-" << ids[end];
+				i = end + 1;
+			}
+		}
+
+	public:
+		CoverageInstrument():suite_incomplete(false) {}
+
+		virtual void startTest()
+		{
+			checkBetween();
+
+			std::vector<uintptr_t> &since = last_fixture.empty() ? suite : fixtures[last_fixture];
+
+			between.clear();
+			coverageTable().take(between);
+			since.insert(since.end(), between.begin(), between.end());
+		}
+
+		virtual void stopTest(Listener &, const std::string &test, const char *, uint32_t)
+		{
+			coverageTable().take(tests[test]);
+			if (coverageTable().takeDropped()) incomplete.insert(test);
+
+			std::vector<uintptr_t> &f = fixtures[fixtureOf(test)];
+			f.insert(f.end(), between.begin(), between.end());
+
+			between.clear();
+			last_fixture = fixtureOf(test);
+		}
+
+		/** The work of the outputters is not the test's.  Only the thread
+		 * that reports is paused, so the other threads of parallel rows go
+		 * on recording. */
+		virtual void pause() { ++coveragePaused(); }
+		virtual void resume() { --coveragePaused(); }
+
+		/** Writes the impact index.  Returns false if it could not. */
+		bool write(const std::string &path)
+		{
+			coverageTable().recording = false;
+			checkBetween();
+
+			std::vector<uintptr_t> rest;
+			coverageTable().take(rest);
+			std::vector<uintptr_t> &since = last_fixture.empty() ? suite : fixtures[last_fixture];
+			since.insert(since.end(), rest.begin(), rest.end());
+
+			std::vector<uintptr_t> all(suite);
+			for(hit_map::iterator pos=tests.begin(); pos!=tests.end(); ++pos) all.insert(all.end(), pos->second.begin(), pos->second.end());
+			for(hit_map::iterator pos=fixtures.begin(); pos!=fixtures.end(); ++pos) all.insert(all.end(), pos->second.begin(), pos->second.end());
+			uniqueAddresses(all);
+
+			std::map<uintptr_t, std::vector<std::string> > sources;
+			sourceFiles(all, sources);
+
+			// The tests that ran code from each file.
+			std::map<std::string, std::vector<unsigned int> > files;
+			unsigned int id = 0;
+
+			std::ofstream out(path.c_str());
+			out << "unittest impact 1\n";
+
+			for(hit_map::iterator pos=tests.begin(); pos!=tests.end(); ++pos, ++id)
+			{
+				std::vector<uintptr_t> pcs(pos->second);
+				const std::vector<uintptr_t> &f = fixtures[fixtureOf(pos->first)];
+				pcs.insert(pcs.end(), f.begin(), f.end());
+				pcs.insert(pcs.end(), suite.begin(), suite.end());
+				uniqueAddresses(pcs);
+
+				std::vector<std::string> seen;
+				for(size_t i=0; i<pcs.size(); ++i)
+				{
+					const std::vector<std::string> &s = sources[pcs[i]];
+					seen.insert(seen.end(), s.begin(), s.end());
+				}
+
+				std::sort(seen.begin(), seen.end());
+				seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+				for(size_t i=0; i<seen.size(); ++i) files[seen[i]].push_back(id);
+
+				out << "test " << pos->first << "\n";
+
+				// The index cannot say what such a test depends on, so it always runs.
+				if (suite_incomplete || incomplete.count(pos->first) || incomplete.count(fixtureOf(pos->first)))
+					out << "incomplete " << pos->first << "\n";
+			}
+
+			for(std::map<std::string, std::vector<unsigned int> >::iterator pos=files.begin(); pos!=files.end(); ++pos)
+			{
+				out << "file " << pos->first << "\t";
+				writeIds(out, pos->second);
+				out << "\n";
+			}
+
+			out.flush();
+			return bool(out);
+		}
+	};
+
+	inline CoverageInstrument& getCoverageInstrument()
+	{
+		static CoverageInstrument instrument;
+		return instrument;
+	}
+
+	/** Returns true if a file named in the impact index, as the compiler saw
+	 * it, is a file given as changed, which may be relative to anywhere
+	 * above it. */
+	inline bool samePath(const std::string &indexed, std::string changed)
+	{
+		while (changed.compare(0, 2, "./") == 0) changed.erase(0, 2);
+		if (changed.empty() || changed.size() > indexed.size()) return false;
+
+		size_t start = indexed.size() - changed.size();
+		return indexed.compare(start, changed.size(), changed) == 0 && (start == 0 || indexed[start-1] == '/');
+	}
+
+	/** Selects the tests that ran code from a changed file, by the impact
+	 * index, of those already selected.  Tests the index does not know,
+	 * such as new ones, and tests it marks incomplete are selected too.
+	 * changed is a comma separated list of files, or "@file" to read them
+	 * from a file, one to a line.  If a changed file is not in the index
+	 * at all, every test stays selected.  Returns false if no test is
+	 * affected. */
+	inline bool selectImpacted(Suite &suite, const std::string &index, const std::string &changed)
+	{
+		std::vector<std::string> changed_files;
+
+		if (changed.compare(0, 1, "@") == 0)
+		{
+			std::ifstream in(changed.substr(1).c_str());
+			std::string line;
+
+			while (std::getline(in, line))
+			{
+				line.erase(line.find_last_not_of(" \t\r") + 1);
+				if (!line.empty()) changed_files.push_back(line);
+			}
+		}
+		else
+		{
+			for(size_t start = 0; start < changed.size(); )
+			{
+				size_t end = changed.find(',', start);
+				if (end == std::string::npos) end = changed.size();
+
+				if (end > start) changed_files.push_back(changed.substr(start, end - start));
+				start = end + 1;
+			}
+		}
+
+		std::ifstream in(index.c_str());
+		if (!in)
+		{
+			std::cerr << "unittest: could not read the impact index '" << index << "', running every test" << std::endl;
+			return true;
+		}
+
+		std::vector<std::string> indexed;
+		std::vector<bool> affected, found(changed_files.size(), false);
+		std::set<std::string> incomplete;
+		std::string line;
+
+		while (std::getline(in, line))
+		{
+			if (line.compare(0, 11, "incomplete ") == 0)
+			{
+				incomplete.insert(line.substr(11));
+				continue;
+			}
+
+			if (line.compare(0, 5, "test ") == 0)
+			{
+				indexed.push_back(line.substr(5));
+				affected.push_back(false);
+				continue;
+			}
+
+			size_t ids = line.rfind('\t');
+			if (line.compare(0, 5, "file ") != 0 || ids == std::string::npos) continue;
+
+			std::string file = line.substr(5, ids - 5);
+			bool hit = false;
+
+			for(size_t i=0; i<changed_files.size(); ++i)
+			{
+				if (!samePath(file, changed_files[i])) continue;
+
+				found[i] = true;
+				hit = true;
+			}
+
+			if (!hit) continue;
+
+			std::istringstream list(line.substr(ids + 1));
+			std::string range;
+
+			while (list >> range)
+			{
+				unsigned long first = std::strtoul(range.c_str(), NULL, 10), last = first;
+				size_t dash = range.find('-');
+				if (dash != std::string::npos) last = std::strtoul(range.c_str() + dash + 1, NULL, 10);
+
+				for(unsigned long i=first; i<=last && i<affected.size(); ++i) affected[i] = true;
+			}
+		}
+
+		// A file the index has never seen may be run by any test.
+		for(size_t i=0; i<changed_files.size(); ++i)
+		{
+			if (found[i]) continue;
+
+			std::cerr << "unittest: '" << changed_files[i] << "' is not in the impact index, running every test" << std::endl;
+			return true;
+		}
+
+		std::map<std::string, bool> known;
+		for(size_t i=0; i<indexed.size(); ++i) known[indexed[i]] = affected[i] || incomplete.count(indexed[i]) != 0;
+
+		std::string selection;
+
+		for(size_t i=0; i<suite.fixtureCount(); ++i)
+		{
+			for(unsigned int j=0; j<suite.testCount(i); ++j)
+			{
+				std::string name = suite.testName(i, j);
+				std::map<std::string, bool>::iterator pos = known.find(name);
+
+				if (!suite.isSelected(name) || (pos != known.end() && !pos->second)) continue;
+
+				if (!selection.empty()) selection += ",";
+				selection += name;
+			}
+		}
+
+		if (selection.empty()) return false;
+
+		suite.select(selection);
+		return true;
+	}
+
+	/** Starts test impact analysis if --impact=index is given: with
+	 * --changed-files, only the tests affected by the changes are
+	 * selected, and otherwise the code each test runs is recorded, for
+	 * finishImpact() to write to the index.  Returns false if no test is
+	 * affected by the changes. */
+	inline bool startImpact(Suite &suite)
+	{
+		Options &options = getOptions();
+		if (!options.has("impact")) return true;
+
+		if (options.has("changed-files"))
+		{
+			if (selectImpacted(suite, options.get("impact"), options.get("changed-files"))) return true;
+
+			std::cerr << "unittest: no test is affected by the changed files" << std::endl;
+			return false;
+		}
+
+		if (!coverageTraced())
+		{
+			std::cerr << "unittest: --impact needs a test binary built with unittest.py --impact" << std::endl;
+			return true;
+		}
+
+		registerInstrument(&getCoverageInstrument());
+		coverageTable().recording = true;
+		return true;
+	}
+
+	/** Writes the impact index, if startImpact() recorded the tests. */
+	inline void finishImpact()
+	{
+		Options &options = getOptions();
+		if (!options.has("impact") || options.has("changed-files") || !coverageTraced()) return;
+
+		if (!getCoverageInstrument().write(options.get("impact")))
+			std::cerr << "unittest: could not write the impact index '" << options.get("impact") << "'" << std::endl;
+	}
+}
+
+#ifdef UT_TRACE_COVERAGE
+
+namespace unittest
+{
+	/** Marks the coverage callback as linked in when the test binary starts. */
+	static struct CoverageTracing
+	{
+		CoverageTracing() { coverageTraced() = true; }
+	} coverage_tracing;
+}
+
+/** Called by code built with -fsanitize-coverage=trace-pc at every basic block. */
+extern "C" UT_NO_COVERAGE void __sanitizer_cov_trace_pc()
+{
+	unittest::CoverageTable &table = unittest::coverageTable();
+	if (table.recording && unittest::coveragePaused() == 0) table.hit(reinterpret_cast<uintptr_t>(__builtin_return_address(0)));
+}
+
+#endif
+
+#endif
+
+#endif
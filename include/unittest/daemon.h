@@ -0,0 +1,492 @@
+#ifndef __TEST_DAEMON_H__
+#define __TEST_DAEMON_H__
+
+#ifndef _WIN32
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "listener.h"
+#include "multi_listener.h"
+#include "binary_outputter.h"
+#include "suite.h"
+
+namespace unittest
+{
+	/** The function a test module exports to register its globals and
+	 * fixtures with a suite of the daemon:
+	 * <tt>extern "C" void unittest_register_module(unittest::Suite &suite)</tt>. */
+	static const char module_entry[] = "unittest_register_module";
+
+	/** Registers the globals and fixtures of a test module. */
+	typedef void (*module_register)(Suite &suite);
+
+	/** Writes all of data to a socket.  Returns false if the other end has
+	 * gone away. */
+	inline bool sendAll(int fd, const char *data, size_t size)
+	{
+		while (size > 0)
+		{
+			ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+
+			if (sent < 0 && errno == EINTR) continue;
+			if (sent <= 0) return false;
+
+			data += sent;
+			size -= sent;
+		}
+
+		return true;
+	}
+
+	/** @brief Streams events to a socket, in the form of a binary event log.
+	 *
+	 *  Records are sent after every test, so a client sees each result as
+	 * soon as it is known.  If the client goes away the tests carry on, and
+	 * their events are dropped. */
+	class SocketListener : public Listener
+	{
+		int fd;
+		bool open;
+		BinaryEncoder enc;
+
+		void flush()
+		{
+			if (open) open = sendAll(fd, enc.data().data(), enc.data().size());
+			enc.clear();
+		}
+
+	public:
+		SocketListener(int _fd):fd(_fd), open(true) {}
+
+		virtual void OnEvent(Event &e)
+		{
+			Listener::OnEvent(e);
+			enc.event(e);
+		}
+
+		virtual void OnSuiteStart()
+		{
+			if (open) open = sendAll(fd, binary_log_magic, binary_log_magic_size);
+			enc.suiteStart();
+		}
+
+		virtual void OnFixtureStart(const std::string &name)
+		{
+			enc.fixtureStart(name);
+		}
+
+		virtual void OnMetric(const std::string &test, const std::string &name, double value)
+		{
+			enc.metric(test, name, value);
+		}
+
+		virtual void OnTestStart(const std::string &name)
+		{
+			enc.testStart(name);
+		}
+
+		virtual void OnTestDone(const std::string &name)
+		{
+			enc.testDone(name);
+			flush();
+		}
+
+		virtual void OnFixtureDone()
+		{
+			enc.fixtureDone();
+			flush();
+		}
+
+		virtual void OnSuiteDone()
+		{
+			enc.suiteDone();
+			flush();
+		}
+	};
+
+	/** @brief Keeps the tests loaded between runs, and runs them when asked
+	 * over a Unix socket.
+	 *
+	 *  Each test module is a shared object built from .test files with
+	 * unittest.py --module.  Its globals are set up when it is loaded and
+	 * stay set up until it changes, so an expensive setup is paid once
+	 * rather than on every run.  Before each command, and every half second
+	 * while idle, a module whose file has a new modification time is loaded
+	 * again: its globals are torn down, and the new build is loaded and set
+	 * up in its place.  A module that fails to load keeps its last build,
+	 * and every run reports the failure.
+	 *
+	 *  A client sends one line to the socket and reads the reply until the
+	 * socket is closed:
+	 *
+	 *  - <tt>run [tests]</tt> runs the tests, given as for --tests, or all of
+	 *    them, and replies with a binary event log of the run, sent as it
+	 *    goes.
+	 *  - <tt>list [tests]</tt> replies with the names of the tests, one to a line.
+	 *  - <tt>quit</tt> stops the daemon.
+	 *
+	 *  The daemon has to be linked with -rdynamic, so that the modules share
+	 * its options and its allocation counting. */
+	class Daemon
+	{
+		/** A loaded test module. */
+		struct Module
+		{
+			std::string path;
+
+			/** The modification time of the build that is loaded, or of the
+			 * last one that failed to load, in nanoseconds. */
+			uint64_t mtime;
+
+			/** The suite of the build that is loaded, or NULL. */
+			Suite *suite;
+			void *handle;
+
+			/** Why the last build failed to load, or empty. */
+			std::string error;
+		};
+
+		std::string socket_path;
+		std::vector<Module> modules;
+
+		/** The suites report here; the listener of each run is added to it
+		 * for the length of the run. */
+		MultiListener out;
+
+		Daemon(const Daemon &);
+		Daemon& operator=(const Daemon &);
+
+		/** Returns the modification time of a file in nanoseconds, or 0. */
+		static uint64_t modified(const std::string &path)
+		{
+			struct stat info;
+			if (stat(path.c_str(), &info) != 0) return 0;
+
+			return uint64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+		}
+
+		/** Opens a copy of the module.  The loader will not load a path it
+		 * already has open again, even once it is closed, if the module
+		 * defines unique symbols, as the statics of inline functions are; a
+		 * new copy is always a new object. */
+		static void *openCopy(const std::string &path, std::string &error)
+		{
+			const char *tmp = std::getenv("TMPDIR");
+			std::string copy = std::string(tmp ? tmp : "/tmp") + "/unittest_module_XXXXXX";
+
+			int to = mkstemp(&copy[0]);
+			int from = open(path.c_str(), O_RDONLY);
+
+			if (to < 0 || from < 0)
+			{
+				error = (from < 0 ? "could not open '" : "could not copy '") + path + "'";
+				if (to >= 0) { close(to); unlink(copy.c_str()); }
+				if (from >= 0) close(from);
+				return NULL;
+			}
+
+			char buf[65536];
+			ssize_t size;
+			bool ok = true;
+
+			while (ok && (size = read(from, buf, sizeof(buf))) > 0)
+				ok = write(to, buf, size) == size;
+
+			close(from);
+			close(to);
+
+			void *handle = ok ? dlopen(copy.c_str(), RTLD_NOW | RTLD_LOCAL) : NULL;
+			if (handle == NULL) error = ok ? "could not load '" + path + "': " + dlerror() : "could not copy '" + path + "'";
+
+			// It stays mapped once loaded.
+			unlink(copy.c_str());
+			return handle;
+		}
+
+		/** Loads a module if its file has changed since it was last loaded. */
+		void load(Module &m)
+		{
+			uint64_t mtime = modified(m.path);
+			if (mtime == m.mtime && (m.suite != NULL || !m.error.empty())) return;
+
+			m.mtime = mtime;
+			m.error.clear();
+
+			void *handle = openCopy(m.path, m.error);
+			module_register reg = NULL;
+
+			if (handle != NULL)
+			{
+				reg = reinterpret_cast<module_register>(dlsym(handle, module_entry));
+
+				if (reg == NULL)
+				{
+					m.error = "'" + m.path + "' has no " + module_entry;
+					dlclose(handle);
+				}
+			}
+
+			if (reg == NULL)
+			{
+				std::cerr << "unittest: " << m.error << std::endl;
+				return;
+			}
+
+			unload(m);
+
+			m.handle = handle;
+			m.suite = new Suite(out);
+			reg(*m.suite);
+			m.suite->setupGlobals();
+
+			std::cerr << "unittest: loaded " << m.path << std::endl;
+		}
+
+		/** Tears down a module's globals and unloads it. */
+		void unload(Module &m)
+		{
+			if (m.suite == NULL) return;
+
+			m.suite->teardownGlobals();
+			delete m.suite;
+			dlclose(m.handle);
+
+			m.suite = NULL;
+			m.handle = NULL;
+		}
+
+		/** Loads every module that has changed. */
+		void reload()
+		{
+			for(size_t i=0; i<modules.size(); ++i) load(modules[i]);
+		}
+
+		/** Runs the tests of every module, reporting to the listener. */
+		void run(const std::string &tests, Listener &l)
+		{
+			out.addListener(&l);
+			out.OnSuiteStart();
+
+			for(size_t i=0; i<modules.size(); ++i)
+			{
+				Module &m = modules[i];
+
+				if (!m.error.empty())
+				{
+					Event e;
+					e.filename = m.path;
+					e.expr = "--LOAD--";
+					e.msg = m.error;
+
+					out.OnFixtureStart(m.path);
+					out.OnEvent(e);
+					out.OnFixtureDone();
+				}
+
+				if (m.suite == NULL) continue;
+
+				m.suite->select(tests);
+				m.suite->runFixtures();
+			}
+
+			out.OnSuiteDone();
+			out.removeListener(&l);
+		}
+
+		/** Reads a command from a client and answers it.  Returns false if
+		 * it was told to stop. */
+		bool handle(int fd)
+		{
+			std::string line;
+			char c;
+
+			while (recv(fd, &c, 1, 0) == 1 && c != '\n') line += c;
+
+			size_t split_pos = line.find(' ');
+			std::string command = line.substr(0, split_pos);
+			std::string tests = split_pos == std::string::npos ? "" : line.substr(split_pos+1);
+
+			reload();
+
+			if (command == "run")
+			{
+				SocketListener l(fd);
+				run(tests, l);
+			}
+			else if (command == "list")
+			{
+				std::ostringstream names;
+
+				for(size_t i=0; i<modules.size(); ++i)
+				{
+					if (modules[i].suite == NULL) continue;
+
+					modules[i].suite->select(tests);
+					modules[i].suite->list(names);
+				}
+
+				sendAll(fd, names.str().data(), names.str().size());
+			}
+			else if (command == "quit") return false;
+			else
+			{
+				std::string msg = "unittest: unknown command '" + command + "'\n";
+				sendAll(fd, msg.data(), msg.size());
+			}
+
+			return true;
+		}
+
+	public:
+		/** Serves the modules at the given paths on a socket at socket_path. */
+		Daemon(const std::string &_socket_path, const std::vector<std::string> &paths):socket_path(_socket_path)
+		{
+			for(size_t i=0; i<paths.size(); ++i)
+			{
+				Module m = { paths[i], 0, NULL, NULL, "" };
+				modules.push_back(m);
+			}
+		}
+
+		/** Unloads every module. */
+		~Daemon()
+		{
+			for(size_t i=modules.size(); i>0; --i) unload(modules[i-1]);
+		}
+
+		/** Loads the modules and answers commands until told to quit.  Returns
+		 * the exit status for the daemon. */
+		int serve()
+		{
+			struct sockaddr_un addr;
+			std::memset(&addr, 0, sizeof(addr));
+			addr.sun_family = AF_UNIX;
+
+			if (socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path))
+			{
+				std::cerr << "unittest: bad socket path '" << socket_path << "'" << std::endl;
+				return 1;
+			}
+
+			std::strcpy(addr.sun_path, socket_path.c_str());
+
+			int server = socket(AF_UNIX, SOCK_STREAM, 0);
+			unlink(socket_path.c_str());
+
+			if (server < 0 || bind(server, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 || listen(server, 8) != 0)
+			{
+				std::cerr << "unittest: could not listen on '" << socket_path << "': " << std::strerror(errno) << std::endl;
+				if (server >= 0) close(server);
+				return 1;
+			}
+
+			reload();
+
+			for(bool serving = true; serving; )
+			{
+				fd_set ready;
+				FD_ZERO(&ready);
+				FD_SET(server, &ready);
+
+				struct timeval wait = { 0, 500000 };
+				int n = select(server+1, &ready, NULL, NULL, &wait);
+
+				if (n == 0)
+				{
+					reload();
+					continue;
+				}
+
+				if (n < 0) continue;
+
+				int client = accept(server, NULL, NULL);
+				if (client < 0) continue;
+
+				serving = handle(client);
+				close(client);
+			}
+
+			close(server);
+			unlink(socket_path.c_str());
+			return 0;
+		}
+	};
+
+	/** Sends a command to a daemon, and hands the reply to the listener if it
+	 * is an event log, or writes it to text if it is not.  Returns the exit
+	 * status for the client. */
+	inline int runRemote(const std::string &socket_path, const std::string &command, Listener &l, std::ostream &text)
+	{
+		struct sockaddr_un addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+		if (fd < 0 || connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0)
+		{
+			std::cerr << "unittest: could not connect to '" << socket_path << "': " << std::strerror(errno) << std::endl;
+			if (fd >= 0) close(fd);
+			return 1;
+		}
+
+		std::string line = command + "\n";
+		sendAll(fd, line.data(), line.size());
+
+		std::string buf;
+		bool log = false, header = true;
+		char chunk[65536];
+		ssize_t size;
+
+		while ((size = recv(fd, chunk, sizeof(chunk), 0)) > 0 || (size < 0 && errno == EINTR))
+		{
+			if (size < 0) continue;
+			buf.append(chunk, size);
+
+			if (header)
+			{
+				if (buf.size() < binary_log_magic_size && std::string(binary_log_magic).compare(0, buf.size(), buf) == 0) continue;
+
+				header = false;
+				log = buf.compare(0, binary_log_magic_size, binary_log_magic) == 0;
+				if (log) buf.erase(0, binary_log_magic_size);
+			}
+
+			if (!log)
+			{
+				text << buf;
+				buf.clear();
+				continue;
+			}
+
+			BinaryDecoder dec(buf.data(), buf.size());
+			while (dec.replay(l));
+			buf.erase(0, buf.size() - dec.remaining());
+		}
+
+		close(fd);
+
+		if (!log) text << buf << std::flush;
+		return buf.empty() || !log ? 0 : 1;
+	}
+}
+
+#endif
+
+#endif
@@ -0,0 +1,884 @@
+#ifndef __TEST_DISTRIBUTED_H__
+#define __TEST_DISTRIBUTED_H__
+
+#ifndef _WIN32
+
+#include <list>
+#include <map>
+#include <set>
+#include <deque>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "listener.h"
+#include "multi_listener.h"
+#include "binary_outputter.h"
+#include "daemon.h"
+#include "options.h"
+#include "repeat.h"
+#include "threads.h"
+#include "suite.h"
+
+namespace unittest
+{
+	/** Tags for the frames a coordinator and its workers send each other.
+	 * A frame is a one byte tag and a string, its 32 bit length first, as a
+	 * BinaryEncoder writes them. */
+	enum WorkFrame
+	{
+		/** From a worker: the names of its fixtures, one to a line. */
+		WORK_HELLO = 1,
+
+		/** To a worker: the tests to run, as for --tests. */
+		WORK_SELECT,
+
+		/** To a worker: a fixture to run once it has run those before it,
+		 * and the seed its tests are shuffled from, separated by a space. */
+		WORK_RUN,
+
+		/** To a worker: give a fixture back if it has not started it. */
+		WORK_STEAL,
+
+		/** From a worker: a fixture it gave back without running it. */
+		WORK_RETURNED,
+
+		/** From a worker: binary event records of the fixture it is running. */
+		WORK_EVENTS,
+
+		/** From a worker: a fixture that has run. */
+		WORK_FINISHED,
+
+		/** To a worker: there is nothing more to run. */
+		WORK_STOP,
+
+		/** To a worker: the seed the coordinator's suite is shuffled from,
+		 * sent after WORK_SELECT if it is shuffled. */
+		WORK_SHUFFLE
+	};
+
+	/** The number of fixtures a worker is given at once: the one it runs,
+	 * and the next, so it never waits for the coordinator between them. */
+	static const size_t work_ahead = 2;
+
+	/** How long a coordinator that is done waits for its local workers to
+	 * connect and to exit, in nanoseconds, before it gives up on them. */
+	static const uint64_t worker_grace = 5000000000u;
+
+	/** Sends a frame.  Returns false if the other end has gone away. */
+	inline bool sendFrame(int fd, uint8_t type, const std::string &payload)
+	{
+		BinaryEncoder enc;
+		enc.putU8(type);
+		enc.putString(payload);
+
+		return sendAll(fd, enc.data().data(), enc.data().size());
+	}
+
+	/** Decodes the frame at pos in buf, and moves pos past it.  Returns false
+	 * if the frame is not all there yet. */
+	inline bool nextFrame(const std::string &buf, size_t &pos, uint8_t &type, std::string &payload)
+	{
+		BinaryDecoder dec(buf.data() + pos, buf.size() - pos);
+		if (!dec.getU8(type) || !dec.getString(payload)) return false;
+
+		pos = buf.size() - dec.remaining();
+		return true;
+	}
+
+	/** Adds what has arrived on a socket to buf.  Returns false once the
+	 * other end has closed it, or on an error. */
+	inline bool receive(int fd, std::string &buf)
+	{
+		char chunk[65536];
+		ssize_t size;
+
+		do size = recv(fd, chunk, sizeof(chunk), 0);
+		while (size < 0 && errno == EINTR);
+
+		if (size <= 0) return false;
+
+		buf.append(chunk, size);
+		return true;
+	}
+
+	/** Sets the options every socket between a coordinator and a worker
+	 * gets: frames are sent at once, and the socket is not passed on to
+	 * programs the process starts. */
+	inline void setupSocket(int fd)
+	{
+		int on = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+	}
+
+	/** Resolves an address given as "host:port", or as "port" alone.  With
+	 * no host, a socket listening on it listens on every interface, and one
+	 * connecting to it connects to this host.  Returns NULL if the address
+	 * cannot be resolved; free the result with freeaddrinfo(). */
+	inline struct addrinfo *resolveAddress(const std::string &address, bool listening)
+	{
+		size_t split_pos = address.rfind(':');
+		std::string host = split_pos == std::string::npos ? "" : address.substr(0, split_pos);
+		std::string port = split_pos == std::string::npos ? address : address.substr(split_pos+1);
+
+		if (host.size() >= 2 && host[0] == '[') host = host.substr(1, host.size()-2);
+
+		struct addrinfo hints, *info = NULL;
+		std::memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		if (listening) hints.ai_flags = AI_PASSIVE;
+
+		const char *node = host.empty() ? (listening ? NULL : "localhost") : host.c_str();
+		if (getaddrinfo(node, port.empty() ? "0" : port.c_str(), &hints, &info) != 0) return NULL;
+
+		return info;
+	}
+
+	/** Connects to a coordinator.  Returns the socket, or -1. */
+	inline int connectTo(const std::string &address)
+	{
+		struct addrinfo *info = resolveAddress(address, false);
+		int fd = -1;
+
+		for(struct addrinfo *a = info; a != NULL && fd < 0; a = a->ai_next)
+		{
+			fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+			if (fd < 0) continue;
+
+			if (connect(fd, a->ai_addr, a->ai_addrlen) != 0)
+			{
+				close(fd);
+				fd = -1;
+			}
+		}
+
+		if (info != NULL) freeaddrinfo(info);
+		if (fd >= 0) setupSocket(fd);
+
+		return fd;
+	}
+
+	/** @brief Runs the fixtures a coordinator hands it, and streams their
+	 * events back.
+	 *
+	 *  The globals are set up once, when the worker starts, and kept for
+	 * every fixture it runs.  A thread reads the coordinator's frames while
+	 * the tests run, so fixtures are queued, and given back when the
+	 * coordinator steals them for an idle worker, without waiting for the
+	 * running fixture to finish.  Events are sent at the start of every
+	 * fixture and the end of every test, so the coordinator knows how far a
+	 * worker got if it dies. */
+	class Worker : public Listener, private Thread
+	{
+		Suite &suite;
+
+		/** The listener of the suite, which the worker is added to. */
+		MultiListener &out;
+
+		std::string address;
+		int fd;
+
+		/** Protects queue and stopping. */
+		Mutex lock;
+
+		/** Signalled when a fixture is queued or the coordinator is done. */
+		Condition ready;
+
+		/** A fixture to run, and the seed its tests are shuffled from. */
+		struct Run
+		{
+			std::string name;
+			uint64_t test_seed;
+		};
+
+		/** The fixtures to run, in order. */
+		std::deque<Run> queue;
+
+		/** Set once the coordinator has nothing more to run, or has gone. */
+		bool stopping;
+
+		/** Protects enc and the socket, as tests of parallel rows report
+		 * from several threads, and the reader gives fixtures back. */
+		Mutex send_lock;
+
+		/** The records not yet sent. */
+		BinaryEncoder enc;
+
+		Worker(const Worker &);
+		Worker& operator=(const Worker &);
+
+		/** Sends the records not yet sent. */
+		void flush()
+		{
+			ScopedLock l(send_lock);
+
+			sendFrame(fd, WORK_EVENTS, enc.data());
+			enc.clear();
+		}
+
+		/** Handles a frame from the coordinator. */
+		void handle(uint8_t type, const std::string &payload)
+		{
+			ScopedLock l(lock);
+
+			if (type == WORK_SELECT) suite.select(payload);
+			else if (type == WORK_SHUFFLE) suite.setShuffle(std::strtoull(payload.c_str(), NULL, 10));
+			else if (type == WORK_RUN)
+			{
+				size_t split_pos = payload.find(' ');
+
+				Run r;
+				r.name = payload.substr(0, split_pos);
+				r.test_seed = split_pos == std::string::npos ? 0 : std::strtoull(payload.c_str() + split_pos + 1, NULL, 10);
+
+				queue.push_back(r);
+				ready.signal();
+			}
+			else if (type == WORK_STEAL)
+			{
+				for(std::deque<Run>::iterator pos=queue.begin(); pos!=queue.end(); ++pos)
+				{
+					if (pos->name != payload) continue;
+
+					queue.erase(pos);
+
+					ScopedLock s(send_lock);
+					sendFrame(fd, WORK_RETURNED, payload);
+					break;
+				}
+			}
+			else if (type == WORK_STOP)
+			{
+				stopping = true;
+				ready.signal();
+			}
+		}
+
+		/** Reads frames from the coordinator until it is done. */
+		virtual void run()
+		{
+			std::string buf;
+
+			while (receive(fd, buf))
+			{
+				size_t pos = 0;
+				uint8_t type;
+				std::string payload;
+
+				while (nextFrame(buf, pos, type, payload)) handle(type, payload);
+				buf.erase(0, pos);
+			}
+
+			ScopedLock l(lock);
+			stopping = true;
+			ready.signal();
+		}
+
+	public:
+		/** Makes a worker for the coordinator at _address, to run the
+		 * fixtures of _suite, whose listener is _out. */
+		Worker(Suite &_suite, MultiListener &_out, const std::string &_address)
+			:suite(_suite), out(_out), address(_address), fd(-1), stopping(false) {}
+
+		virtual void OnEvent(Event &e)
+		{
+			Listener::OnEvent(e);
+
+			ScopedLock l(send_lock);
+			enc.event(e);
+		}
+
+		virtual void OnFixtureStart(const std::string &name)
+		{
+			{
+				ScopedLock l(send_lock);
+				enc.fixtureStart(name);
+			}
+
+			flush();
+		}
+
+		virtual void OnMetric(const std::string &test, const std::string &name, double value)
+		{
+			ScopedLock l(send_lock);
+			enc.metric(test, name, value);
+		}
+
+		virtual void OnTestStart(const std::string &name)
+		{
+			ScopedLock l(send_lock);
+			enc.testStart(name);
+		}
+
+		virtual void OnTestDone(const std::string &name)
+		{
+			{
+				ScopedLock l(send_lock);
+				enc.testDone(name);
+			}
+
+			flush();
+		}
+
+		virtual void OnFixtureDone()
+		{
+			{
+				ScopedLock l(send_lock);
+				enc.fixtureDone();
+			}
+
+			flush();
+		}
+
+		/** Connects to the coordinator, waiting up to ten seconds for it to
+		 * start, and runs what it hands out until it has nothing more.
+		 * Returns the exit status for the worker. */
+		int serve()
+		{
+			for(int tries = 0; (fd = connectTo(address)) < 0 && tries < 20; ++tries) usleep(500000);
+
+			if (fd < 0)
+			{
+				std::cerr << "unittest: could not connect to the coordinator at '" << address << "'" << std::endl;
+				return 1;
+			}
+
+			std::map<std::string, size_t> index;
+			std::string names;
+
+			for(size_t i=0; i<suite.fixtureCount(); ++i)
+			{
+				index[suite.fixtureName(i)] = i;
+				names += suite.fixtureName(i) + "\n";
+			}
+
+			sendFrame(fd, WORK_HELLO, names);
+
+			if (!start())
+			{
+				std::cerr << "unittest: could not start the worker's thread" << std::endl;
+				close(fd);
+				return 1;
+			}
+
+			out.addListener(this);
+			suite.setupGlobals();
+
+			for(;;)
+			{
+				Run r;
+
+				{
+					ScopedLock l(lock);
+					while (queue.empty() && !stopping) ready.wait(lock);
+
+					if (queue.empty()) break;
+
+					r = queue.front();
+					queue.pop_front();
+				}
+
+				std::map<std::string, size_t>::iterator pos = index.find(r.name);
+				if (pos != index.end()) suite.runFixture(pos->second, r.test_seed);
+
+				ScopedLock l(send_lock);
+				sendFrame(fd, WORK_FINISHED, r.name);
+			}
+
+			suite.teardownGlobals();
+			out.removeListener(this);
+
+			shutdown(fd, SHUT_RDWR);
+			join();
+			close(fd);
+			return 0;
+		}
+	};
+
+	/** @brief Hands the fixtures of a suite out to worker processes, and
+	 * reports their events to the suite's listener.
+	 *
+	 *  Workers connect over TCP, from this host or others.  Each is given
+	 * work_ahead fixtures and then one more every time it finishes one, so
+	 * a worker with quick fixtures takes more of them.  Once every fixture
+	 * is handed out, an idle worker steals a fixture that a busy worker has
+	 * queued but not started, so the run ends as soon after the longest
+	 * fixture as it can.
+	 *
+	 *  The events of a fixture are reported all together when it is done,
+	 * so the outputters see one fixture at a time.  A worker that dies
+	 * while it runs a fixture fails it, with the events it had sent; the
+	 * fixtures it had not started are handed to other workers. */
+	class Coordinator
+	{
+		/** A connected worker. */
+		struct Peer
+		{
+			int fd;
+
+			/** Bytes received but not yet decoded. */
+			std::string in;
+
+			/** The records of the fixture it is running. */
+			std::string records;
+
+			/** The fixtures it has been given, the one it is running first. */
+			std::deque<size_t> assigned;
+
+			/** True once it has said which fixtures it has. */
+			bool ready;
+		};
+
+		typedef std::list<Peer> peer_list;
+
+		Suite &suite;
+		Listener &out;
+
+		/** The name of every fixture of the suite. */
+		std::vector<std::string> names;
+
+		/** The names again, as a worker says them. */
+		std::string hello;
+
+		/** The fixtures not yet handed out, in the order the suite would run them. */
+		std::deque<size_t> pending;
+
+		/** The seed the tests of each fixture are shuffled from. */
+		std::vector<uint64_t> test_seeds;
+
+		/** The fixtures a worker has been asked to give back. */
+		std::set<size_t> stealing;
+
+		/** The number of fixtures not yet done. */
+		size_t remaining;
+
+		peer_list peers;
+
+		/** The local workers that have not exited. */
+		std::vector<pid_t> children;
+
+		/** The number of local workers started, and of workers, local or
+		 * not, that have said which fixtures they have. */
+		size_t spawned, greeted;
+
+		Coordinator(const Coordinator &);
+		Coordinator& operator=(const Coordinator &);
+
+		/** Returns the index of a fixture in a worker's list, or assigned.size(). */
+		size_t find(const Peer &p, const std::string &name)
+		{
+			size_t i = 0;
+			while (i < p.assigned.size() && names[p.assigned[i]] != name) ++i;
+			return i;
+		}
+
+		/** Reports the events of a finished fixture. */
+		void report(const std::string &records)
+		{
+			BinaryDecoder dec(records.data(), records.size());
+			while (dec.replay(out)) {}
+		}
+
+		/** Reports fixture i as failed, after the events sent for it. */
+		void fail(size_t i, const std::string &records, const std::string &msg)
+		{
+			if (records.empty()) out.OnFixtureStart(names[i]);
+			else report(records);
+
+			Event e;
+			e.filename = names[i];
+			e.expr = "--WORKER--";
+			e.msg = msg;
+
+			out.OnEvent(e);
+			out.OnFixtureDone();
+
+			--remaining;
+		}
+
+		/** Gives every worker with room for more a fixture, and has idle
+		 * workers steal fixtures once none are left to hand out. */
+		void balance()
+		{
+			size_t idle = 0;
+
+			for(peer_list::iterator p=peers.begin(); p!=peers.end(); ++p)
+			{
+				if (!p->ready) continue;
+
+				while (p->assigned.size() < work_ahead && !pending.empty())
+				{
+					p->assigned.push_back(pending.front());
+					pending.pop_front();
+
+					std::ostringstream run;
+					run << names[p->assigned.back()] << " " << test_seeds[p->assigned.back()];
+					sendFrame(p->fd, WORK_RUN, run.str());
+				}
+
+				if (p->assigned.empty()) ++idle;
+			}
+
+			while (stealing.size() < idle)
+			{
+				peer_list::iterator victim = peers.end();
+
+				for(peer_list::iterator p=peers.begin(); p!=peers.end(); ++p)
+				{
+					if (p->assigned.size() < 2 || stealing.count(p->assigned.back())) continue;
+					if (victim == peers.end() || p->assigned.size() > victim->assigned.size()) victim = p;
+				}
+
+				if (victim == peers.end()) break;
+
+				stealing.insert(victim->assigned.back());
+				sendFrame(victim->fd, WORK_STEAL, names[victim->assigned.back()]);
+			}
+		}
+
+		/** Handles a frame from a worker.  Returns false if the worker is
+		 * not one of this suite's. */
+		bool handle(Peer &p, uint8_t type, const std::string &payload)
+		{
+			if (type == WORK_HELLO)
+			{
+				if (payload != hello)
+				{
+					std::cerr << "unittest: a worker with other fixtures than the coordinator's was turned away" << std::endl;
+					return false;
+				}
+
+				p.ready = true;
+				++greeted;
+				sendFrame(p.fd, WORK_SELECT, suite.selected());
+
+				if (suite.isShuffled())
+				{
+					std::ostringstream seed;
+					seed << suite.shuffleSeed();
+					sendFrame(p.fd, WORK_SHUFFLE, seed.str());
+				}
+			}
+			else if (type == WORK_EVENTS) p.records += payload;
+			else if (type == WORK_FINISHED || type == WORK_RETURNED)
+			{
+				size_t i = find(p, payload);
+				if (i == p.assigned.size()) return true;
+
+				size_t fixture = p.assigned[i];
+				p.assigned.erase(p.assigned.begin() + i);
+				stealing.erase(fixture);
+
+				if (type == WORK_RETURNED) pending.push_front(fixture);
+				else
+				{
+					report(p.records);
+					p.records.clear();
+					--remaining;
+				}
+			}
+
+			return true;
+		}
+
+		/** Fails the fixture a worker that has gone was running, and hands
+		 * out the rest of its fixtures again. */
+		void lose(peer_list::iterator p)
+		{
+			if (!p->assigned.empty() && !p->records.empty())
+			{
+				fail(p->assigned.front(), p->records, "the worker running the fixture stopped");
+				p->assigned.pop_front();
+			}
+
+			for(size_t i=p->assigned.size(); i>0; --i)
+			{
+				stealing.erase(p->assigned[i-1]);
+				pending.push_front(p->assigned[i-1]);
+			}
+
+			close(p->fd);
+			peers.erase(p);
+		}
+
+		/** Starts a worker process running this program, to connect to address. */
+		void spawn(const std::string &address)
+		{
+			std::vector<std::string> line = getOptions().commandLine();
+			line.push_back("--worker=" + address);
+
+			std::vector<char *> argv;
+			for(size_t i=0; i<line.size(); ++i) argv.push_back(&line[i][0]);
+			argv.push_back(NULL);
+
+			pid_t pid = fork();
+
+			if (pid == 0)
+			{
+				execv("/proc/self/exe", &argv[0]);
+				execvp(argv[0], &argv[0]);
+				_exit(127);
+			}
+
+			if (pid > 0)
+			{
+				children.push_back(pid);
+				++spawned;
+			}
+		}
+
+		/** Tells every worker that has said hello that there is nothing
+		 * more to run, and closes its connection. */
+		void stop()
+		{
+			for(peer_list::iterator p=peers.begin(); p!=peers.end(); )
+			{
+				peer_list::iterator current = p++;
+				if (!current->ready) continue;
+
+				sendFrame(current->fd, WORK_STOP, "");
+				close(current->fd);
+				peers.erase(current);
+			}
+		}
+
+		/** Waits for the local workers to exit, and kills those that have
+		 * not within worker_grace. */
+		void waitChildren()
+		{
+			for(uint64_t start = monotonicClock(); !children.empty(); usleep(20000))
+			{
+				reap();
+				if (monotonicClock() - start < worker_grace) continue;
+
+				for(size_t i=0; i<children.size(); ++i)
+				{
+					kill(children[i], SIGKILL);
+					waitpid(children[i], NULL, 0);
+				}
+
+				children.clear();
+			}
+		}
+
+		/** Forgets local workers that have exited. */
+		void reap()
+		{
+			for(size_t i=children.size(); i>0; --i)
+				if (waitpid(children[i-1], NULL, WNOHANG) != 0) children.erase(children.begin() + (i-1));
+		}
+
+		/** Listens on address.  Returns the socket, or -1. */
+		static int listenOn(const std::string &address)
+		{
+			struct addrinfo *info = resolveAddress(address, true);
+			int fd = -1;
+
+			for(struct addrinfo *a = info; a != NULL && fd < 0; a = a->ai_next)
+			{
+				fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+				if (fd < 0) continue;
+
+				int on = 1;
+				setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+				if (bind(fd, a->ai_addr, a->ai_addrlen) != 0 || listen(fd, 64) != 0)
+				{
+					close(fd);
+					fd = -1;
+				}
+			}
+
+			if (info != NULL) freeaddrinfo(info);
+			if (fd >= 0) fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+			return fd;
+		}
+
+	public:
+		/** Makes a coordinator for the fixtures of _suite, which reports to _out. */
+		Coordinator(Suite &_suite, Listener &_out):suite(_suite), out(_out), remaining(0), spawned(0), greeted(0)
+		{
+			for(size_t i=0; i<suite.fixtureCount(); ++i)
+			{
+				names.push_back(suite.fixtureName(i));
+				hello += names.back() + "\n";
+			}
+		}
+
+		/** Closes the connections to the workers. */
+		~Coordinator()
+		{
+			for(peer_list::iterator p=peers.begin(); p!=peers.end(); ++p) close(p->fd);
+		}
+
+		/** Runs the fixtures the suite would run on workers: local_workers
+		 * started here, and any that connect to address.  With no address,
+		 * only the local workers run them, over the loopback interface.
+		 * Returns the exit status for the coordinator. */
+		int run(const std::string &address, long local_workers)
+		{
+			Options &options = getOptions();
+
+			// Both need every test to run in this process.
+			if (repeating(options) || (options.has("impact") && !options.has("changed-files")))
+			{
+				std::cerr << "unittest: --repeat, --until-fail, --duration and recording --impact cannot run on workers" << std::endl;
+				return 1;
+			}
+
+			// Handed out in the order, and shuffled from the seeds, the suite
+			// would run them in itself.
+			std::vector<size_t> order;
+			std::vector<uint64_t> seeds;
+			suite.runOrder(order, seeds);
+
+			test_seeds.resize(names.size());
+			for(size_t i=0; i<order.size(); ++i)
+			{
+				test_seeds[order[i]] = seeds[i];
+				if (suite.willRun(order[i])) pending.push_back(order[i]);
+			}
+
+			remaining = pending.size();
+
+			int server = listenOn(address.empty() ? "127.0.0.1:0" : address);
+
+			if (server < 0)
+			{
+				std::cerr << "unittest: could not listen on '" << address << "': " << std::strerror(errno) << std::endl;
+				return 1;
+			}
+
+			struct sockaddr_storage bound;
+			socklen_t bound_size = sizeof(bound);
+			getsockname(server, reinterpret_cast<struct sockaddr *>(&bound), &bound_size);
+
+			char host[NI_MAXHOST], port[NI_MAXSERV];
+			getnameinfo(reinterpret_cast<struct sockaddr *>(&bound), bound_size, host, sizeof(host), port, sizeof(port), NI_NUMERICHOST | NI_NUMERICSERV);
+
+			// Local workers reach a socket listening on every interface through the loopback one.
+			std::string local = host;
+			if (local == "0.0.0.0" || local == "::") local = "localhost";
+			else if (local.find(':') != std::string::npos) local = "[" + local + "]";
+
+			for(long i=0; i<local_workers && remaining > 0; ++i) spawn(local + ":" + port);
+
+			if (!address.empty()) std::cerr << "unittest: waiting for workers on port " << port << std::endl;
+
+			out.OnSuiteStart();
+
+			for(uint64_t done = 0; ; )
+			{
+				// Once every fixture is done, local workers still on their
+				// way are let in to be stopped, so none is left waiting.
+				if (remaining == 0)
+				{
+					stop();
+					reap();
+
+					if (done == 0) done = monotonicClock();
+					if (children.empty() || greeted >= spawned || monotonicClock() - done > worker_grace) break;
+				}
+
+				fd_set readable;
+				FD_ZERO(&readable);
+				FD_SET(server, &readable);
+
+				int last = server;
+
+				for(peer_list::iterator p=peers.begin(); p!=peers.end(); ++p)
+				{
+					FD_SET(p->fd, &readable);
+					if (p->fd > last) last = p->fd;
+				}
+
+				struct timeval wait = { 0, 500000 };
+				int n = select(last+1, &readable, NULL, NULL, &wait);
+
+				if (n < 0) continue;
+
+				if (n == 0)
+				{
+					reap();
+
+					// With no address, no other worker can come.
+					if (address.empty() && peers.empty() && children.empty())
+					{
+						while (!pending.empty())
+						{
+							fail(pending.front(), "", "no worker was left to run the fixture");
+							pending.pop_front();
+						}
+					}
+
+					continue;
+				}
+
+				if (FD_ISSET(server, &readable))
+				{
+					int fd = accept(server, NULL, NULL);
+
+					if (fd >= 0)
+					{
+						setupSocket(fd);
+
+						Peer p;
+						p.fd = fd;
+						p.ready = false;
+						peers.push_back(p);
+					}
+				}
+
+				for(peer_list::iterator p=peers.begin(); p!=peers.end(); )
+				{
+					peer_list::iterator current = p++;
+					if (!FD_ISSET(current->fd, &readable)) continue;
+
+					bool open = receive(current->fd, current->in);
+					size_t pos = 0;
+					uint8_t type;
+					std::string payload;
+
+					while (open && nextFrame(current->in, pos, type, payload)) open = handle(*current, type, payload);
+					current->in.erase(0, pos);
+
+					if (!open) lose(current);
+				}
+
+				balance();
+			}
+
+			// A worker still in the listen queue sees its connection reset.
+			close(server);
+
+			for(peer_list::iterator p=peers.begin(); p!=peers.end(); ++p) close(p->fd);
+			peers.clear();
+
+			out.OnSuiteDone();
+
+			waitChildren();
+			return 0;
+		}
+	};
+}
+
+#endif
+
+#endif
@@ -2,10 +2,37 @@
 #define __TEST_FIXTURE_H__
 
 #include <string>
+#include <vector>
+#include "config.h"
 #include "listener.h"
 
 namespace unittest
 {
+	class Fixture;
+	
+	/** @brief A fixture in the table of fixtures.
+	 *
+	 *  Entries are plain data, built by the compiler and gathered by the
+	 * linker, so nothing is made at startup.  The fixture itself is only made
+	 * when it is about to run; until then the entry names it and its tests. */
+	struct FixtureEntry
+	{
+		/** The name of the fixture. */
+		const char *name;
+		
+		/** Makes an instance of the fixture. */
+		Fixture *(*create)();
+		
+		/** Returns the number of tests. */
+		unsigned int (*count)();
+		
+		/** Returns the name of a test, without the fixture. */
+		const char *(*test)(unsigned int index);
+		
+		/** The next entry, where there is no linker section to put it in. */
+		FixtureEntry *next;
+	};
+	
 	/** A fixture is the parent class used by classes generated by the script.
 	 * It contains the basic information needed by the suite to setup and run tests. */
 	class Fixture
@@ -16,11 +43,17 @@ namespace unittest
 		
 		/** The name of the fixture. */
 		std::string name;
+		
+		/** If true, every test runs on a new instance of the fixture. */
+		bool fresh;
+		
+		/** The order the tests run in, or empty for the order they were written in. */
+		std::vector<unsigned int> order;
 								
 	public:
-		Fixture(const std::string &_name):name(_name) {}
-		Fixture(const char *_name):name(_name) {}
-		~Fixture() {}
+		Fixture(const std::string &_name):name(_name), fresh(false) {}
+		Fixture(const char *_name):name(_name), fresh(false) {}
+		virtual ~Fixture() {}
 		
 		virtual const std::string& Name() { return name; }
 		
@@ -30,8 +63,70 @@ namespace unittest
 		/** Teardown for the fixture.  By default does nothing. */
 		virtual void teardown() {}
 		
-		/** Executes all the tests. Filled in by the parser. */
-		virtual void runTests() {}				
+		/** Setup run before each test. By default does nothing. */
+		virtual void setupTest() {}
+		
+		/** Teardown run after each test.  By default does nothing. */
+		virtual void teardownTest() {}
+		
+		/** Makes every test run on a new instance of the fixture, with its own
+		 * setup() and teardown(), instead of all tests sharing this one. */
+		void setFresh(bool _fresh) { fresh = _fresh; }
+		
+		/** Returns true if every test runs on a new instance. */
+		bool isFresh() const { return fresh; }
+		
+		/** Returns the number of tests.  Filled in by the parser. */
+		virtual unsigned int testCount() const { return 0; }
+		
+		/** Returns the name of a test, as "Fixture::test".  Filled in by the parser. */
+		virtual const char *testName(unsigned int /*index*/) const { return ""; }
+		
+		/** Runs one test, with the per test setup and teardown around it.  Filled in by
+		 * the parser. */
+		virtual void runTest(unsigned int /*index*/) {}
+		
+		/** Returns a new instance of the fixture, to run tests on by itself.  Filled in
+		 * by the parser. */
+		virtual Fixture *create() const { return NULL; }
+		
+		/** Runs only the given tests, in the given order, rather than all of them in
+		 * the order they were written in. */
+		void setOrder(const std::vector<unsigned int> &tests) { order = tests; }
+		
+		/** Returns the number of tests to run. */
+		unsigned int runCount() const { return order.empty() ? testCount() : unsigned(order.size()); }
+		
+		/** Returns the test to run i-th. */
+		unsigned int testAt(unsigned int i) const { return order.empty() ? i : order[i]; }
+		
+		/** Executes all the tests, from the test table. */
+		virtual void runTests()
+		{
+			if (isFresh())
+			{
+				for(unsigned int i=0; i<runCount(); ++i)
+				{
+					Fixture *instance = create();
+					
+					instance->setListener(listener);
+					instance->setup();
+					instance->runTest(testAt(i));
+					instance->teardown();
+					
+					delete instance;
+				}
+				
+				return;
+			}
+			
+			setup();
+			
+			for(unsigned int i=0; i<runCount(); ++i)
+				runTest(testAt(i));
+			
+			teardown();
+		}
 		
 		/** Sets the listener for this fixture. */
 		virtual void setListener(Listener *_l) { listener = _l; }		
@@ -0,0 +1,225 @@
+#ifndef __TEST_FLOATING_H__
+#define __TEST_FLOATING_H__
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <algorithm>
+#include "config.h"
+
+namespace unittest
+{
+	/** The distance returned when there is none, because a value is NaN. */
+	static const uint64_t ulp_infinite = ~uint64_t(0);
+
+	/** Maps the bits of a float onto an unsigned scale that orders like
+	 * the values do, with -0 and +0 at the same place. */
+	inline uint64_t ulpOrdered(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		return (bits & 0x80000000u) ? uint64_t(0x80000000u) - (bits & 0x7fffffffu) : uint64_t(0x80000000u) + bits;
+	}
+
+	inline uint64_t ulpOrdered(double value)
+	{
+		uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		const uint64_t sign = uint64_t(1) << 63;
+		return (bits & sign) ? sign - (bits & ~sign) : sign + bits;
+	}
+
+	/** @brief Returns how many representable values lie between a and b.
+	 *
+	 *  Neighbouring values are 1 apart, and -0 and +0 are 0 apart.  If either
+	 * value is NaN the distance is ulp_infinite. */
+	template<class T>
+	uint64_t ulpDistance(T a, T b)
+	{
+		if (a != a || b != b) return ulp_infinite;
+
+		uint64_t x = ulpOrdered(a), y = ulpOrdered(b);
+		return x > y ? x - y : y - x;
+	}
+
+	/** Splits a finite, non-negative value into its binade, counting the
+	 * denormals as binade 0, and its place in the binade in ulps. */
+	template<class T>
+	void ulpPlace(T x, long &binade, T &offset)
+	{
+		typedef std::numeric_limits<T> limits;
+
+		if (x < limits::min())
+		{
+			binade = 0;
+			offset = x / limits::denorm_min();
+			return;
+		}
+
+		int exponent;
+		T mantissa = std::frexp(x, &exponent);
+
+		binade = exponent - limits::min_exponent + 1;
+		offset = std::ldexp(mantissa, limits::digits) - std::ldexp(T(1), limits::digits - 1);
+	}
+
+	/** @brief The distance between two long doubles.
+	 *
+	 *  The layout of a long double differs between platforms, so rather than
+	 * reading its bits the distance is worked out from frexp(), which gives
+	 * the same answer wherever long double is an IEEE-like format.  Distances
+	 * too large for 64 bits are ulp_infinite. */
+	inline uint64_t ulpDistance(long double a, long double b)
+	{
+		typedef std::numeric_limits<long double> limits;
+
+		if (a != a || b != b) return ulp_infinite;
+		if (a == b) return 0;
+
+		// On opposite sides of zero, go through it.
+		if ((a < 0) != (b < 0))
+		{
+			uint64_t x = ulpDistance(std::fabs(a), 0.0L), y = ulpDistance(std::fabs(b), 0.0L);
+			return x > ulp_infinite - y ? ulp_infinite : x + y;
+		}
+
+		long double x = std::fabs(a), y = std::fabs(b);
+		if (x > y) std::swap(x, y);
+
+		// An infinity is one step beyond the largest value.
+		long double extra = 0;
+		if (y > limits::max())
+		{
+			y = limits::max();
+			extra = 1;
+		}
+
+		long x_binade, y_binade;
+		long double x_offset, y_offset;
+
+		ulpPlace(x, x_binade, x_offset);
+		ulpPlace(y, y_binade, y_offset);
+
+		long double distance = (y_binade - x_binade) * std::ldexp(1.0L, limits::digits - 1) + (y_offset - x_offset) + extra;
+		if (distance >= std::ldexp(1.0L, 64)) return ulp_infinite;
+
+		return uint64_t(distance);
+	}
+
+	/** Returns true if value is an infinity. */
+	template<class T>
+	bool isInfinite(T value) { return std::fabs(value) > std::numeric_limits<T>::max(); }
+
+	/** @brief Returns true if a and b are at most ulps representable values apart.
+	 *
+	 *  NaN matches only NaN, an infinity only itself, and -0 matches 0.
+	 * Denormals are counted like any other value, so the smallest denormal
+	 * is one ulp from 0. */
+	template<class T>
+	bool ulpNear(T a, T b, uint64_t ulps)
+	{
+		if (a != a || b != b) return a != a && b != b;
+		if (a == b) return true;
+		if (isInfinite(a) || isInfinite(b)) return false;
+
+		return ulpDistance(a, b) <= ulps;
+	}
+
+	/** @brief Returns true if a and b differ by at most rel times the larger of them.
+	 *
+	 *  Values closer together than the smallest normal number always match,
+	 * because denormals have too few digits for a relative error to mean
+	 * anything.  NaN matches only NaN and an infinity only itself. */
+	template<class T>
+	bool relNear(T a, T b, T rel)
+	{
+		if (a != a || b != b) return a != a && b != b;
+		if (a == b) return true;
+		if (isInfinite(a) || isInfinite(b)) return false;
+
+		T error = std::fabs(a - b);
+		return error <= std::numeric_limits<T>::min() || error <= rel * std::max(std::fabs(a), std::fabs(b));
+	}
+
+	/** Returns the error of a relative to the larger of a and b. */
+	template<class T>
+	T relError(T a, T b)
+	{
+		if (a == b) return 0;
+		return std::fabs(a - b) / std::max(std::fabs(a), std::fabs(b));
+	}
+
+	/** @brief The floating point type two operands are compared in.
+	 *
+	 *  The wider of the two floating point types, so comparing a float with
+	 * an integer literal stays in float.  Two integers compare as double. */
+	template<class T> struct FloatRank { enum { rank = 0 }; };
+	template<> struct FloatRank<float> { enum { rank = 1 }; };
+	template<> struct FloatRank<double> { enum { rank = 2 }; };
+	template<> struct FloatRank<long double> { enum { rank = 3 }; };
+
+	template<int Rank> struct FloatOfRank { typedef double type; };
+	template<> struct FloatOfRank<1> { typedef float type; };
+	template<> struct FloatOfRank<3> { typedef long double type; };
+
+	template<class A, class B>
+	struct FloatCommon
+	{
+		typedef typename FloatOfRank<(int(FloatRank<A>::rank) > int(FloatRank<B>::rank) ?
+		                              int(FloatRank<A>::rank) : int(FloatRank<B>::rank))>::type type;
+	};
+
+	/** Starts the message for two values that do not match, explaining why
+	 * if it is not their distance. */
+	template<class T>
+	bool floatingMismatch(std::ostringstream &out, T a, T b)
+	{
+		out << std::setprecision(std::numeric_limits<T>::digits10 + 2) << a << " vs " << b << ": ";
+
+		if (a != a || b != b) out << "NaN matches only NaN";
+		else if (isInfinite(a) || isInfinite(b)) out << "an infinity matches only itself";
+		else return false;
+
+		return true;
+	}
+
+	/** Checks UT_ASSERT_ULP_NEAR, each operand having been evaluated once. */
+	template<class A, class B>
+	bool checkUlpNear(const A &a, const B &b, uint64_t ulps, std::string &report)
+	{
+		typedef typename FloatCommon<A, B>::type T;
+		T x = a, y = b;
+
+		if (ulpNear(x, y, ulps)) return true;
+
+		std::ostringstream out;
+		if (!floatingMismatch(out, x, y)) out << ulpDistance(x, y) << " ulps apart, more than " << ulps;
+
+		report = out.str();
+		return false;
+	}
+
+	/** Checks UT_ASSERT_REL_NEAR, each operand having been evaluated once. */
+	template<class A, class B, class R>
+	bool checkRelNear(const A &a, const B &b, const R &rel, std::string &report)
+	{
+		typedef typename FloatCommon<A, B>::type T;
+		T x = a, y = b;
+
+		if (relNear(x, y, T(rel))) return true;
+
+		std::ostringstream out;
+		if (!floatingMismatch(out, x, y))
+			out << std::setprecision(3) << "relative error " << relError(x, y) << ", more than " << T(rel);
+
+		report = out.str();
+		return false;
+	}
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef __TEST_GLOBAL_H__
+#define __TEST_GLOBAL_H__
+
+#include <string>
+
+namespace unittest
+{
+	/** @brief State shared by every fixture, such as a loaded data set.
+	 *
+	 *  The suite sets up every global before the first fixture runs and tears
+	 * them down after the last one, so each is built once per process.  The
+	 * generator hands fixtures a const reference to it, because fixtures may
+	 * use it at the same time when tests run in parallel. */
+	class Global
+	{
+	protected:
+		/** The name of the global. */
+		std::string name;
+
+	public:
+		Global(const std::string &_name):name(_name) {}
+		Global(const char *_name):name(_name) {}
+		virtual ~Global() {}
+
+		virtual const std::string& Name() { return name; }
+
+		/** Builds the shared state.  By default does nothing. */
+		virtual void setup() {}
+
+		/** Releases the shared state.  By default does nothing. */
+		virtual void teardown() {}
+	};
+}
+
+#endif
@@ -0,0 +1,291 @@
+#ifndef __TEST_GOLDEN_H__
+#define __TEST_GOLDEN_H__
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "config.h"
+#include "options.h"
+#include "mapped_file.h"
+
+namespace unittest
+{
+	/** The size of the blocks compared when looking for the first and last difference. */
+	static const size_t golden_chunk = 65536;
+
+	/** The most line edits the diff of a golden mismatch looks for. */
+	static const int golden_max_edits = 500;
+
+	/** The most lines of diff put in a failure message. */
+	static const size_t golden_max_diff_lines = 40;
+
+	/** The lines of context shown around each change. */
+	static const size_t golden_context = 2;
+
+	/** One line of a golden comparison.  The hash makes most comparisons of
+	 * unequal lines a single integer compare. */
+	struct GoldenLine
+	{
+		const char *text;
+		size_t length;
+		uint32_t hash;
+
+		bool operator==(const GoldenLine &other) const
+		{
+			return hash == other.hash && length == other.length && std::memcmp(text, other.text, length) == 0;
+		}
+	};
+
+	/** One step of an edit script: ' ' keeps a line, '-' drops an expected
+	 * line and '+' adds an actual one. */
+	struct GoldenEdit
+	{
+		char op;
+		size_t expected, actual;
+	};
+
+	/** Splits text into lines, hashing each with FNV-1a. */
+	inline void goldenLines(const char *text, size_t size, std::vector<GoldenLine> &lines)
+	{
+		const char *pos = text, *end = text + size;
+
+		while (pos != end)
+		{
+			const char *stop = static_cast<const char *>(std::memchr(pos, '\n', end-pos));
+			stop = stop ? stop+1 : end;
+
+			GoldenLine line;
+			line.text = pos;
+			line.length = stop - pos;
+			line.hash = 2166136261u;
+
+			for(const char *c=pos; c!=stop; ++c) line.hash = (line.hash ^ (unsigned char)(*c)) * 16777619u;
+
+			lines.push_back(line);
+			pos = stop;
+		}
+	}
+
+	/** @brief Finds the shortest edit script between two lists of lines.
+	 *
+	 *  This is Myers' O((N+M)D) algorithm.  It gives up, returning false,
+	 * if more than max_edits lines must change, which bounds both the time
+	 * and the memory used by the trace. */
+	inline bool goldenDiff(const std::vector<GoldenLine> &a, const std::vector<GoldenLine> &b,
+	                       int max_edits, std::vector<GoldenEdit> &script)
+	{
+		int n = a.size(), m = b.size();
+		int max = std::min(n + m, max_edits);
+		int offset = max + 1;
+
+		std::vector<int> v(2*max + 3, 0);
+		std::vector<std::vector<int> > trace;
+
+		for(int d=0; d<=max; ++d)
+		{
+			trace.push_back(v);
+
+			for(int k=-d; k<=d; k+=2)
+			{
+				int x;
+
+				if (k == -d || (k != d && v[offset+k-1] < v[offset+k+1])) x = v[offset+k+1];
+				else x = v[offset+k-1] + 1;
+
+				int y = x - k;
+
+				while (x < n && y < m && a[x] == b[y])
+				{
+					++x;
+					++y;
+				}
+
+				v[offset+k] = x;
+
+				if (x < n || y < m) continue;
+
+				// Walk back through the trace to recover the edits.
+				for(int back=d; back>=0; --back)
+				{
+					const std::vector<int> &pv = trace[back];
+					int pk = x - y;
+					int prev_k = (pk == -back || (pk != back && pv[offset+pk-1] < pv[offset+pk+1])) ? pk+1 : pk-1;
+					int prev_x = pv[offset+prev_k], prev_y = prev_x - prev_k;
+
+					while (x > prev_x && y > prev_y)
+					{
+						GoldenEdit e = { ' ', size_t(x-1), size_t(y-1) };
+						script.push_back(e);
+						--x;
+						--y;
+					}
+
+					if (back > 0)
+					{
+						GoldenEdit e = { x == prev_x ? '+' : '-', size_t(prev_x), size_t(prev_y) };
+						script.push_back(e);
+					}
+
+					x = prev_x;
+					y = prev_y;
+				}
+
+				std::reverse(script.begin(), script.end());
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/** Writes one line of a diff, shortened if it is long. */
+	inline void goldenDiffLine(std::ostringstream &out, char op, const GoldenLine &line)
+	{
+		size_t length = line.length;
+		if (length && line.text[length-1] == '\n') --length;
+
+		out << '\n' << op << std::string(line.text, std::min(length, size_t(120)));
+		if (length > 120) out << "...";
+	}
+
+	/** @brief Compares a buffer with a golden file.
+	 *
+	 *  The golden file is mapped, and compared a block at a time from each
+	 * end to find the region that differs.  Only that region is diffed, line
+	 * by line, and the diff is put in message.  With --update-golden a
+	 * mismatched or missing golden file is rewritten with the buffer and the
+	 * comparison passes. */
+	inline bool matchGolden(const char *actual, size_t actual_size, const std::string &path, std::string &message)
+	{
+		std::ostringstream out;
+
+		{
+			MappedFile golden(path);
+
+			if (golden.error().empty())
+			{
+				const char *expected = golden.data();
+				size_t expected_size = golden.size(), common = std::min(expected_size, actual_size);
+
+				// Common prefix, a block at a time and then a byte at a time.
+				size_t prefix = 0;
+				while (prefix + golden_chunk <= common && std::memcmp(expected+prefix, actual+prefix, golden_chunk) == 0)
+					prefix += golden_chunk;
+				while (prefix < common && expected[prefix] == actual[prefix]) ++prefix;
+
+				if (prefix == expected_size && prefix == actual_size) return true;
+
+				if (!getOptions().has("update-golden"))
+				{
+					// Common suffix, not overlapping the prefix.
+					size_t suffix = 0, limit = common - prefix;
+					while (suffix + golden_chunk <= limit &&
+					       std::memcmp(expected+expected_size-suffix-golden_chunk, actual+actual_size-suffix-golden_chunk, golden_chunk) == 0)
+						suffix += golden_chunk;
+					while (suffix < limit && expected[expected_size-suffix-1] == actual[actual_size-suffix-1]) ++suffix;
+
+					// Widen the region to whole lines.
+					size_t start = prefix;
+					while (start > 0 && expected[start-1] != '\n') --start;
+
+					size_t tail = suffix;
+					while (tail > 0 && expected[expected_size-tail-1] != '\n') --tail;
+
+					size_t first_line = std::count(expected, expected+start, '\n') + 1;
+
+					std::vector<GoldenLine> a, b;
+					std::vector<GoldenEdit> script;
+
+					goldenLines(expected+start, expected_size-tail-start, a);
+					goldenLines(actual+start, actual_size-tail-start, b);
+
+					out << "'" << path << "' differs from line " << first_line
+					    << " (expected " << expected_size << " bytes, got " << actual_size << ")";
+
+					if (!goldenDiff(a, b, golden_max_edits, script))
+					{
+						out << "; more than " << golden_max_edits << " lines differ";
+						if (!a.empty()) goldenDiffLine(out, '-', a[0]);
+						if (!b.empty()) goldenDiffLine(out, '+', b[0]);
+					}
+					else
+					{
+						size_t shown = 0;
+						bool skipped = true;
+
+						for(size_t i=0; i<script.size() && shown<golden_max_diff_lines; ++i)
+						{
+							// Keep unchanged lines only near a change.
+							bool near = script[i].op != ' ';
+							for(size_t j=(i > golden_context ? i-golden_context : 0); !near && j<=i+golden_context && j<script.size(); ++j)
+								near = script[j].op != ' ';
+
+							if (!near)
+							{
+								skipped = true;
+								continue;
+							}
+
+							if (skipped)
+							{
+								out << "\n@@ expected line " << first_line + script[i].expected
+								    << ", actual line " << first_line + script[i].actual << " @@";
+								skipped = false;
+							}
+
+							if (script[i].op == '+') goldenDiffLine(out, '+', b[script[i].actual]);
+							else goldenDiffLine(out, script[i].op, a[script[i].expected]);
+
+							++shown;
+						}
+
+						if (shown == golden_max_diff_lines) out << "\n...";
+					}
+
+					message = out.str();
+					return false;
+				}
+			}
+			else if (!getOptions().has("update-golden"))
+			{
+				message = golden.error() + "; run with --update-golden to create it";
+				return false;
+			}
+		}
+
+		// Write a new file beside the old one, then swap it in, so a failed
+		// write never leaves half a golden file.
+		std::string tmp_path = path + ".tmp";
+		std::ofstream file(tmp_path.c_str(), std::ios::out | std::ios::binary);
+
+		file.write(actual, actual_size);
+		file.close();
+
+#ifdef _WIN32
+		std::remove(path.c_str());
+#endif
+
+		if (!file || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+		{
+			message = "could not update '" + path + "'";
+			return false;
+		}
+
+		message = "updated '" + path + "'";
+		return true;
+	}
+
+	/** Compares any contiguous buffer with size() and operator[], such as
+	 * std::string or std::vector<char>, with a golden file. */
+	template<class Buffer>
+	bool matchGolden(const Buffer &actual, const std::string &path, std::string &message)
+	{
+		return matchGolden(actual.size() ? reinterpret_cast<const char *>(&actual[0]) : "", actual.size() * sizeof(actual[0]), path, message);
+	}
+}
+
+#endif
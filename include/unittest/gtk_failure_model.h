@@ -0,0 +1,212 @@
+#ifndef __GTK_FAILURE_MODEL_H__
+#define __GTK_FAILURE_MODEL_H__
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include "config.h"
+
+#include <gtk/gtk.h>
+
+namespace unittest
+{
+	/** One failed event, as shown in the Gtk+ failure list. */
+	struct FailureRow
+	{
+		std::string filename;
+		uint32_t line_num;
+		std::string expr;
+		std::string msg;
+	};
+
+	/** The type for failure row lists. */
+	typedef std::vector<FailureRow> failure_rows;
+
+	/** @brief A GtkTreeModel that shows a vector of failures directly.
+	 *
+	 *  Unlike a GtkListStore nothing is copied into the model; the view asks
+	 * for the few rows it is showing and they are formatted then.  Rows may
+	 * only be appended, and failure_model_appended() must be called after
+	 * appending so views learn about them. */
+	struct FailureModel
+	{
+		GObject parent;
+
+		/** The rows shown, owned by the outputter. */
+		failure_rows *rows;
+
+		/** Identifies iterators that belong to this model. */
+		gint stamp;
+	};
+
+	struct FailureModelClass
+	{
+		GObjectClass parent_class;
+	};
+
+	/** The columns of the failure model. */
+	enum FailureColumn { FAILURE_FILE, FAILURE_TEST, FAILURE_LINE, FAILURE_EXPR, FAILURE_MSG, FAILURE_COLUMNS };
+
+	static GtkTreeModelFlags failure_model_get_flags(GtkTreeModel * /*model*/)
+	{
+		return GtkTreeModelFlags(GTK_TREE_MODEL_LIST_ONLY | GTK_TREE_MODEL_ITERS_PERSIST);
+	}
+
+	static gint failure_model_get_n_columns(GtkTreeModel * /*model*/)
+	{
+		return FAILURE_COLUMNS;
+	}
+
+	static GType failure_model_get_column_type(GtkTreeModel * /*model*/, gint index)
+	{
+		return index == FAILURE_LINE ? G_TYPE_UINT : G_TYPE_STRING;
+	}
+
+	/** Points an iterator at a row.  Returns false if there is no such row. */
+	static gboolean failure_model_set_iter(FailureModel *m, GtkTreeIter *iter, size_t index)
+	{
+		if (index >= m->rows->size()) return FALSE;
+
+		iter->stamp = m->stamp;
+		iter->user_data = GSIZE_TO_POINTER(index);
+		iter->user_data2 = NULL;
+		iter->user_data3 = NULL;
+		return TRUE;
+	}
+
+	static gboolean failure_model_get_iter(GtkTreeModel *model, GtkTreeIter *iter, GtkTreePath *path)
+	{
+		if (gtk_tree_path_get_depth(path) != 1) return FALSE;
+
+		return failure_model_set_iter(reinterpret_cast<FailureModel *>(model), iter,
+		                              gtk_tree_path_get_indices(path)[0]);
+	}
+
+	static GtkTreePath *failure_model_get_path(GtkTreeModel * /*model*/, GtkTreeIter *iter)
+	{
+		GtkTreePath *path = gtk_tree_path_new();
+		gtk_tree_path_append_index(path, GPOINTER_TO_SIZE(iter->user_data));
+		return path;
+	}
+
+	static void failure_model_get_value(GtkTreeModel *model, GtkTreeIter *iter, gint column, GValue *value)
+	{
+		const FailureRow &row = (*reinterpret_cast<FailureModel *>(model)->rows)[GPOINTER_TO_SIZE(iter->user_data)];
+		size_t split_pos = row.filename.find(':');
+
+		g_value_init(value, failure_model_get_column_type(model, column));
+
+		switch(column)
+		{
+		case FAILURE_FILE: g_value_set_string(value, row.filename.substr(0, split_pos).c_str()); break;
+		case FAILURE_TEST:
+			if (split_pos != std::string::npos) g_value_set_string(value, row.filename.substr(split_pos+2).c_str());
+			break;
+		case FAILURE_LINE: g_value_set_uint(value, row.line_num); break;
+		case FAILURE_EXPR: g_value_set_string(value, row.expr.c_str()); break;
+		case FAILURE_MSG:  g_value_set_string(value, row.msg.c_str()); break;
+		}
+	}
+
+	static gboolean failure_model_iter_next(GtkTreeModel *model, GtkTreeIter *iter)
+	{
+		return failure_model_set_iter(reinterpret_cast<FailureModel *>(model), iter,
+		                              GPOINTER_TO_SIZE(iter->user_data)+1);
+	}
+
+	static gboolean failure_model_iter_nth_child(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent, gint n)
+	{
+		if (parent != NULL || n < 0) return FALSE;
+
+		return failure_model_set_iter(reinterpret_cast<FailureModel *>(model), iter, n);
+	}
+
+	static gboolean failure_model_iter_children(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent)
+	{
+		return failure_model_iter_nth_child(model, iter, parent, 0);
+	}
+
+	static gboolean failure_model_iter_has_child(GtkTreeModel * /*model*/, GtkTreeIter * /*iter*/)
+	{
+		return FALSE;
+	}
+
+	static gint failure_model_iter_n_children(GtkTreeModel *model, GtkTreeIter *iter)
+	{
+		if (iter != NULL) return 0;
+
+		return reinterpret_cast<FailureModel *>(model)->rows->size();
+	}
+
+	static gboolean failure_model_iter_parent(GtkTreeModel * /*model*/, GtkTreeIter * /*iter*/, GtkTreeIter * /*child*/)
+	{
+		return FALSE;
+	}
+
+	static void failure_model_tree_model_init(GtkTreeModelIface *iface)
+	{
+		iface->get_flags       = failure_model_get_flags;
+		iface->get_n_columns   = failure_model_get_n_columns;
+		iface->get_column_type = failure_model_get_column_type;
+		iface->get_iter        = failure_model_get_iter;
+		iface->get_path        = failure_model_get_path;
+		iface->get_value       = failure_model_get_value;
+		iface->iter_next       = failure_model_iter_next;
+		iface->iter_children   = failure_model_iter_children;
+		iface->iter_has_child  = failure_model_iter_has_child;
+		iface->iter_n_children = failure_model_iter_n_children;
+		iface->iter_nth_child  = failure_model_iter_nth_child;
+		iface->iter_parent     = failure_model_iter_parent;
+	}
+
+	/** Registers the model type with GObject on first use. */
+	static GType failure_model_get_type()
+	{
+		static GType type = 0;
+
+		if (type == 0)
+		{
+			GTypeInfo info;
+			GInterfaceInfo tree_model_info;
+
+			memset(&info, 0, sizeof(info));
+			info.class_size = sizeof(FailureModelClass);
+			info.instance_size = sizeof(FailureModel);
+
+			memset(&tree_model_info, 0, sizeof(tree_model_info));
+			tree_model_info.interface_init = reinterpret_cast<GInterfaceInitFunc>(failure_model_tree_model_init);
+
+			type = g_type_register_static(G_TYPE_OBJECT, "UnittestFailureModel", &info, GTypeFlags(0));
+			g_type_add_interface_static(type, GTK_TYPE_TREE_MODEL, &tree_model_info);
+		}
+
+		return type;
+	}
+
+	/** Creates a model that shows the given rows. */
+	static FailureModel *failure_model_new(failure_rows *rows)
+	{
+		FailureModel *m = static_cast<FailureModel *>(g_object_new(failure_model_get_type(), NULL));
+
+		m->rows = rows;
+		m->stamp = g_random_int();
+		return m;
+	}
+
+	/** Tells views about the rows appended since the model held first rows. */
+	static void failure_model_appended(FailureModel *m, size_t first)
+	{
+		for(size_t i=first; i<m->rows->size(); ++i)
+		{
+			GtkTreeIter iter;
+			GtkTreePath *path = gtk_tree_path_new();
+
+			gtk_tree_path_append_index(path, i);
+			failure_model_set_iter(m, &iter, i);
+			gtk_tree_model_row_inserted(GTK_TREE_MODEL(m), path, &iter);
+			gtk_tree_path_free(path);
+		}
+	}
+}
+
+#endif
@@ -5,6 +5,9 @@
 #include <iostream>
 #include <sstream>
 #include "listener.h"
+#include "threads.h"
+#include "ring_buffer.h"
+#include "gtk_failure_model.h"
 
 #include <gtk/gtk.h>
 
@@ -18,113 +21,163 @@ namespace unittest
 {
 
    static gint close_window_cb(GtkWidget* w, GdkEventAny *e, gpointer data);
+   static gboolean test_results_configure_cb(GtkWidget *w, GdkEventConfigure *event,
+                                             gpointer data);
    static gboolean test_results_expose_cb(GtkWidget *w, GdkEventExpose *event,
                                           gpointer data);
                                           
    static gboolean pass_fail_expose_cb(GtkWidget *w, GdkEventExpose *event,
                                           gpointer data);                                          
+                                          
+   static gboolean refresh_cb(gpointer data);
+   static gboolean drain_cb(gpointer data);
 
-	/** Outputs events in a way that makes it easier for an IDE to use them. */
-	class GtkOutputter : public Listener
+	/** @brief Shows the results in a Gtk+ window.
+	 *
+	 *  The window runs its own Gtk+ main loop on a separate thread.  The test
+	 * thread only copies each event into a lock-free queue, and the UI thread
+	 * drains the queue refresh_ms times a second, refresh_batch updates at a
+	 * time, so a flood of events cannot keep it from drawing.
+	 *
+	 *  Events are not kept one by one.  They are counted per test, and each
+	 * test is drawn as a tile coloured by its share of failures.  When there
+	 * are more tests than tiles fit in the window, neighbouring tests share a
+	 * tile.  The tiles are drawn into an offscreen pixmap and only the tiles
+	 * whose tests changed are redrawn, so an expose is a single copy.  Only
+	 * failures are kept in full, and the failure list reads them straight
+	 * from a FailureModel.  Gtk+ is only ever touched from the UI thread. */
+	class GtkOutputter : public Listener, private Thread
 	{
-		/** The type for event lists. */
-		typedef std::vector<Event> event_list;
+	   /** How often the window is refreshed, in milliseconds. */
+	   static const guint refresh_ms = 50;
+	   
+	   /** The most updates taken from the queue before the window is drawn. */
+	   static const size_t refresh_batch = 4096;
+	   
+	   /** The size of a tile, and the gap between tiles, in pixels. */
+	   static const int tile_size = 6;
+	   static const int tile_gap = 1;
+	   
+	   /** The kinds of updates sent to the UI thread. */
+	   enum UpdateType { FIXTURE_START, EVENT, FIXTURE_DONE, SUITE_DONE };
+	   
+	   /** One update for the UI thread.  Names are only sent for failures and
+	    * for the first event of each test; other passing events are just counts. */
+	   struct Update
+	   {
+	      UpdateType type;
+	      bool pass;
+	      uint32_t line_num, current_test, total_tests;
+	      std::string filename, expr, msg;
+	   };
+	   
+	   /** The results of one test. */
+	   struct Bucket
+	   {
+	      Bucket():passes(0), failures(0), listed(false), dirty(false) {}
+	      
+	      std::string fixture, test;
+	      uint32_t passes, failures;
+	      
+	      /** True once the test has a row in the test list, which is iter. */
+	      bool listed;
+	      GtkTreeIter iter;
+	      
+	      /** True while the bucket is waiting to be redrawn. */
+	      bool dirty;
+	   };
+	   
+		/** The type for bucket lists. */
+		typedef std::vector<Bucket> bucket_list;
+		
+		/** Every test seen so far, in the order they were run.  UI thread only. */
+		bucket_list buckets;
+		
+		/** Indices of buckets changed since the last refresh.  UI thread only. */
+		std::vector<size_t> dirty;
+		
+		/** The first bucket of the running fixture, and its name.  UI thread only. */
+		size_t fixture_base;
+		std::string fixture_name;
+		
+		/** Every failure.  The failure list shows these.  UI thread only. */
+		failure_rows failures;
+		
+		/** The heat map, kept between exposes.  NULL until the widget is sized. */
+		GdkPixmap *tiles;
+		
+		/** The heat map layout: tiles per row, number of tiles and tests per tile. */
+		int tile_cols;
+		size_t tile_count;
+		size_t tests_per_tile;
+		
+		/** Updates waiting for the UI thread. */
+		RingBuffer<Update> updates;
+		
+		/** Set by the UI thread when the window is closed. */
+		volatile bool closed;
 		
-		/** The list of events processed. */
-		event_list events;
+		/** The last test an update was sent for.  Test thread only. */
+		uint32_t sent_test;
+		bool sent_any;
 		
-		/** The number of passed events. */
+		/** The number of passed events.  UI thread only. */
 		int nPassed;
 		
-		/** The number of failed events. */
+		/** The number of failed events.  UI thread only. */
 		int nFailed;
 		
+		/** True while a backlog is being taken from the queue when idle.  UI thread only. */
+		bool draining;
+		
+		/** Sends an update to the UI thread.  Updates are dropped once the window is closed. */
+		void send(const Update &u)
+		{
+		   updates.pushWait(u, closed);
+		}
+		
 	public:
+	   GtkOutputter():fixture_base(0), tiles(NULL), tile_cols(1), tile_count(0), tests_per_tile(1),
+	                  updates(1 << 16), closed(false), sent_test(0), sent_any(false), nPassed(0), nFailed(0),
+	                  draining(false) {}
 	
 		/** Handles event catches. */		
 		virtual void OnEvent(Event &e)
 		{
-		   std::ostringstream tmp;
-		   
 			Listener::OnEvent(e);	
 			
-			events.push_back(e);
+			Update u;
+			u.type = EVENT;
+			u.pass = e.pass;
+			u.line_num = e.line_num;
+			u.current_test = e.current_test;
+			u.total_tests = e.total_tests;
 			
-			if (e.pass)
-			{			   
-			   ++nPassed;
-			   
-			   tmp << "<span foreground=\"#008800\" weight=\"bold\">" << nPassed
-			       << "</span>";
-			       
-			   gtk_label_set_markup(GTK_LABEL(passed), tmp.str().c_str());
-			   
-			   // Update the list
-   			GtkTreeIter iter;
-   			size_t split_pos = e.filename.find(':');
-   		   
-   		   gtk_list_store_append(passstore, &iter);
-   		   gtk_list_store_set(passstore, &iter,
-   		                      0, e.filename.substr(0, split_pos).c_str(),
-   		                      1, e.filename.substr(split_pos+2, e.filename.size()).c_str(),
-   		                      2, e.line_num,
-   		                      3, e.expr.c_str(),   		                      
-   		                      -1); 
-			   
-			}
-			else
+			// Only failures and new tests need their names.
+			if (!e.pass || !sent_any || e.current_test != sent_test)
 			{
-			   ++nFailed;
-			   
-			   tmp  << "<span foreground=\"#880000\" weight=\"bold\">" << nFailed
-			        << "</span>";
-			        
-			   gtk_label_set_markup(GTK_LABEL(failed), tmp.str().c_str());
-			   
-			   // Update the list
-   			GtkTreeIter iter;
-   			size_t split_pos = e.filename.find(':');
-   		   
-   		   gtk_list_store_append(infostore, &iter);
-   		   gtk_list_store_set(infostore, &iter,
-   		                      0, e.filename.substr(0, split_pos).c_str(),
-   		                      1, e.filename.substr(split_pos+2, e.filename.size()).c_str(),
-   		                      2, e.line_num,
-   		                      3, e.expr.c_str(),
-   		                      4, e.msg.c_str(),
-   		                      -1);   			
+			   u.filename = e.filename;
+			   u.expr = e.expr;
 			}
 			
+			// Only failures show their message.
+			if (!e.pass) u.msg = e.msg;
 			
-			// Invalidate the widget area so that it will get redrawn.			
-			gtk_widget_queue_draw_area(test_output, 0,0, 
-			                           test_output->allocation.width, 
-			                           test_output->allocation.height);	
-			                           
-			                           
-			// Update the progress bar
-			{
-   			float cur = e.current_test, total = e.total_tests;
-   			
-   		   gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(tests_done), cur/total);
-   		   gtk_progress_bar_pulse(GTK_PROGRESS_BAR(fixtures_done));
-			}	
-			                           
-			                           
-		   // Run a partial GTK+ event loop to handle events.
-		   while (gtk_events_pending()) { gtk_main_iteration(); }			
+			sent_test = e.current_test;
+			sent_any = true;
+			
+			send(u);
 		}
 		
 		/** When a fixture is starting, this is called. */
 		virtual void OnFixtureStart(const std::string &name)
 		{
-   		std::string title = std::string("Unit Test :: ") + name; 
-   		
-			// Set the name of the fixture being tested.
-			gtk_window_set_title(GTK_WINDOW(runtests), title.c_str());			
-			
-			// Update the progress bar.
-			gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(tests_done), 0.0);						
+		   sent_any = false;
+		   
+		   Update u;
+		   u.type = FIXTURE_START;
+		   u.filename = name;
+		   send(u);
 		}
 		
 		/** When a fixture is done with all it's tests, this is called. */
@@ -132,98 +185,214 @@ namespace unittest
 		{
 			Listener::OnFixtureDone();	
 			
-			// Update the progress bar
-			gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(tests_done), 1.0);			
+			Update u;
+			u.type = FIXTURE_DONE;
+			send(u);
 		}
 		
-		/** Called when the suite is about to start. */
+		/** Called when the suite is about to start.  Starts the UI thread. */
 		virtual void OnSuiteStart()
 		{
-		    CreateWindow();
-		    
-		    // Update the progress bar.
-			 gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(fixtures_done), 0.0);
-		    
-		    gtk_widget_show (runtests);
-		    
-		    nPassed=0;
-		    nFailed=0;
+		   if (!start())
+		   {
+		      std::cerr << "unittest: could not start the Gtk+ thread" << std::endl;
+		      closed = true;
+		   }
 		}
 		
-		/** When a suite is done with all it's tests, this is called. */
+		/** When a suite is done with all it's tests, this is called.  Waits
+		 * until the window is closed. */
 		virtual void OnSuiteDone()
 		{
 			Listener::OnSuiteDone();	
 			
-			std::string title = std::string("Unit Test :: Finished"); 
-   		
-			// Set the name of the fixture being tested.
-			gtk_window_set_title(GTK_WINDOW(runtests), title.c_str());						
+			Update u;
+			u.type = SUITE_DONE;
+			send(u);
 			
-			// Update the progress bar.
-			gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(fixtures_done), 1.0);
+			join();
 		}
 		
-	  // Draws the test results widget.
-	  void DrawResults()
+		/** Takes at most refresh_batch updates from the queue and refreshes
+		 * the window.  Returns true if more are waiting.  UI thread only. */
+		bool Refresh()
+		{
+		   Update u;
+		   size_t first_failure = failures.size(), taken = 0;
+		   bool changed = false;
+		   
+		   while (taken < refresh_batch && updates.pop(u))
+		   {
+		      ++taken;
+		      changed = true;
+		      
+		      switch(u.type)
+		      {
+		      case FIXTURE_START:
+		      {
+   		      std::string title = std::string("Unit Test :: ") + u.filename; 
+   		      
+   			   // Set the name of the fixture being tested.
+   			   gtk_window_set_title(GTK_WINDOW(runtests), title.c_str());			
+   			   
+   			   // Update the progress bar.
+   			   gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(tests_done), 0.0);
+   			   gtk_progress_bar_pulse(GTK_PROGRESS_BAR(fixtures_done));
+   			   
+   			   // The tests of this fixture follow those already seen.
+   			   fixture_base = buckets.size();
+   			   fixture_name = u.filename;
+   			   break;
+   			}
+   			
+		      case EVENT:
+		      {
+		         size_t index = fixture_base + u.current_test;
+		         if (index >= buckets.size()) buckets.resize(index+1);
+		         
+		         Bucket &bucket = buckets[index];
+		         
+		         if (bucket.test.empty() && !u.filename.empty())
+		         {
+		            size_t split_pos = u.filename.rfind("::");
+		            
+		            bucket.fixture = fixture_name;
+		            bucket.test = split_pos == std::string::npos ? u.filename : u.filename.substr(split_pos+2);
+		         }
+		         
+		         if (u.pass) 
+		         {
+		            ++nPassed;
+		            ++bucket.passes;
+		         }
+		         else
+		         {
+		            FailureRow row;
+		            row.filename = u.filename;
+		            row.line_num = u.line_num;
+		            row.expr = u.expr;
+		            row.msg = u.msg;
+		            
+		            ++nFailed;
+		            ++bucket.failures;
+		            failures.push_back(row);
+		         }
+		         
+		         if (!bucket.dirty)
+		         {
+		            bucket.dirty = true;
+		            dirty.push_back(index);
+		         }
+		         
+		         if (u.total_tests)
+		         {
+		            float cur = u.current_test, total = u.total_tests;
+		            gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(tests_done), cur/total);
+		         }
+		         break;
+		      }
+		         
+		      case FIXTURE_DONE:
+   			   gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(tests_done), 1.0);
+		         break;
+		         
+		      case SUITE_DONE:
+   			   // Set the name of the fixture being tested.
+   			   gtk_window_set_title(GTK_WINDOW(runtests), "Unit Test :: Finished");						
+   			   
+   			   // Update the progress bar.
+   			   gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(fixtures_done), 1.0);
+		         break;
+		      }
+		   }
+		   
+		   if (!changed) return false;
+		   
+		   // Tell the failure list about the new rows.  The view only asks for
+		   // the rows it shows.
+		   failure_model_appended(failure_model, first_failure);
+		   
+		   UpdateTests();
+		   
+		   std::ostringstream tmp;
+		   
+		   tmp << "<span foreground=\"#008800\" weight=\"bold\">" << nPassed << "</span>";
+		   gtk_label_set_markup(GTK_LABEL(passed), tmp.str().c_str());
+		   
+		   tmp.str("");
+		   tmp << "<span foreground=\"#880000\" weight=\"bold\">" << nFailed << "</span>";
+		   gtk_label_set_markup(GTK_LABEL(failed), tmp.str().c_str());
+		   
+			gtk_widget_queue_draw(pass_fail);
+			
+			return taken == refresh_batch;
+		}
+		
+		/** Called every refresh_ms.  A backlog of more than one batch is taken
+		 * a batch at a time whenever Gtk+ is idle, so the window is drawn and
+		 * handles input in between.  UI thread only. */
+		void Tick()
+		{
+		   if (Refresh() && !draining)
+		   {
+		      draining = true;
+		      g_idle_add(drain_cb, this);
+		   }
+		}
+		
+		/** Takes the next batch of a backlog.  Returns TRUE while more are
+		 * waiting, so Gtk+ calls it again.  UI thread only. */
+		gboolean Drain()
+		{
+		   if (Refresh()) return TRUE;
+		   
+		   draining = false;
+		   return FALSE;
+		}
+		
+		/** Called on the UI thread when the window is closed. */
+		void Closed()
+		{
+		   closed = true;
+		   gtk_main_quit();
+		}
+		
+	  /** Called when the test results widget is resized.  Lays the tiles out
+	   * again for the new size and redraws them all. */
+	  void ResizeResults()
 	  {
-	     int x=2, y=2;
-	     GdkColor pass_col, fail_col, black_col;
 	     GtkWidget* widget = test_output;
-	     GdkGC *gc = widget->style->fg_gc[GTK_WIDGET_STATE(widget)];
 	     
-	     GdkGCValues old_vals;
+	     if (tiles != NULL) g_object_unref(tiles);
 	     
-	     // Save context
-	     gdk_gc_get_values(gc, &old_vals);
+	     tiles = gdk_pixmap_new(widget->window, widget->allocation.width, widget->allocation.height, -1);
 	     
-	     gdk_color_parse("red", &fail_col);
-	     gdk_color_parse("green", &pass_col);
-	     gdk_color_parse("black", &black_col);
+	     tile_cols = (widget->allocation.width - 2) / (tile_size + tile_gap);
+	     if (tile_cols < 1) tile_cols = 1;
 	     
+	     int rows = (widget->allocation.height - 2) / (tile_size + tile_gap);
+	     if (rows < 1) rows = 1;
 	     
-	     for(event_list::iterator pos=events.begin(); pos!=events.end(); ++pos)
-			{
-			   // Set the approptiate color
-				if (!(pos->pass))
-				{
-				  gdk_gc_set_rgb_fg_color(gc, &fail_col);
-				}
-				else
-				{				                          
-				  gdk_gc_set_rgb_fg_color(gc, &pass_col);
-				}
-				
-				// Draw the filling
-				gdk_draw_rectangle(test_output->window, 
-				                     gc,
-				                     TRUE,
-				                     x, y,
-				                     5, 5);
-				 
-				// Draw a border                    
-				gdk_gc_set_rgb_fg_color(gc, &black_col); 
-				gdk_draw_rectangle(test_output->window, 
-				                     gc,
-				                     FALSE,
-				                     x, y,
-				                     5, 5);                    
-				                     
-				
-				// Adjust for next box                     
-				x+=7;
-				
-				if (x>=widget->allocation.width)
-				{
-				  x=2;
-				  y+=7;
-				}
-				
-			}
-			
-			// Restore context
-			gdk_gc_set_values(gc, &old_vals, GDK_GC_FOREGROUND);
+	     tile_count = tile_cols * rows;
+	     tests_per_tile = 0;
+	     
+	     DrawAllTiles();
+	  }
 	  
+	  // Draws the test results widget.
+	  void DrawResults(GdkEventExpose *event)
+	  {
+	     if (tiles == NULL) return;
+	     
+	     GtkWidget* widget = test_output;
+	     
+	     // Just copy the exposed part of the heat map.
+	     gdk_draw_drawable(widget->window, 
+	                       widget->style->fg_gc[GTK_WIDGET_STATE(widget)],
+	                       tiles,
+	                       event->area.x, event->area.y,
+	                       event->area.x, event->area.y,
+	                       event->area.width, event->area.height);
 	  }
 	  
 	  // Draws the pass/fail widget
@@ -275,6 +444,146 @@ namespace unittest
      }
 		
 	private:
+	  /** Redraws the tiles and test list rows of the changed tests. */
+	  void UpdateTests()
+	  {
+	     if (dirty.empty()) return;
+	     
+	     GtkWidget* widget = test_output;
+	     
+	     if (tiles != NULL)
+	     {
+	        // Once the tests no longer fit, more of them share each tile and
+	        // everything has to be drawn again.
+	        if (buckets.size() > tile_count * tests_per_tile) DrawAllTiles();
+	        else
+	        {
+	           size_t last_tile = tile_count;
+	           
+	           for(size_t i=0; i<dirty.size(); ++i)
+	           {
+	              size_t tile = dirty[i] / tests_per_tile;
+	              
+	              if (tile == last_tile) continue;
+	              
+	              DrawTile(tile);
+	              last_tile = tile;
+	           }
+	        }
+	        
+	        gtk_widget_queue_draw(widget);
+	     }
+	     
+	     for(size_t i=0; i<dirty.size(); ++i)
+	     {
+	        Bucket &bucket = buckets[dirty[i]];
+	        
+	        if (!bucket.listed)
+	        {
+	           gtk_list_store_append(teststore, &bucket.iter);
+	           gtk_list_store_set(teststore, &bucket.iter,
+	                              0, bucket.fixture.c_str(),
+	                              1, bucket.test.c_str(),
+	                              -1);
+	           bucket.listed = true;
+	        }
+	        
+	        gtk_list_store_set(teststore, &bucket.iter,
+	                           2, bucket.passes,
+	                           3, bucket.failures,
+	                           -1);
+	        
+	        bucket.dirty = false;
+	     }
+	     
+	     dirty.clear();
+	  }
+	  
+	  /** Works out how many tests share a tile and redraws the whole heat map. */
+	  void DrawAllTiles()
+	  {
+	     GtkWidget* widget = test_output;
+	     
+	     tests_per_tile = (buckets.size() + tile_count - 1) / tile_count;
+	     if (tests_per_tile < 1) tests_per_tile = 1;
+	     
+	     gdk_draw_rectangle(tiles, widget->style->bg_gc[GTK_WIDGET_STATE(widget)], TRUE,
+	                        0, 0, widget->allocation.width, widget->allocation.height);
+	     
+	     for(size_t tile=0; tile*tests_per_tile < buckets.size(); ++tile) DrawTile(tile);
+	  }
+	  
+	  /** Draws one tile of the heat map into the pixmap.  Green if all its
+	   * tests passed, otherwise red that gets darker as more of it failed. */
+	  void DrawTile(size_t tile)
+	  {
+	     GtkWidget* widget = test_output;
+	     GdkGC *gc = widget->style->fg_gc[GTK_WIDGET_STATE(widget)];
+	     GdkColor fill_col, black_col;
+	     uint32_t passes = 0, fails = 0;
+	     
+	     size_t end = (tile+1) * tests_per_tile;
+	     if (end > buckets.size()) end = buckets.size();
+	     
+	     for(size_t i=tile*tests_per_tile; i<end; ++i)
+	     {
+	        passes += buckets[i].passes;
+	        fails += buckets[i].failures;
+	     }
+	     
+	     if (fails)
+	     {
+	        double share = double(fails) / (passes + fails);
+	        
+	        fill_col.red = 0xffff;
+	        fill_col.green = fill_col.blue = guint16(0x9999 * (1.0 - share));
+	     }
+	     else if (passes)
+	     {
+	        fill_col.red = fill_col.blue = 0;
+	        fill_col.green = 0xcccc;
+	     }
+	     else fill_col.red = fill_col.green = fill_col.blue = 0xcccc;
+	     
+	     gdk_color_parse("black", &black_col);
+	     
+	     int x = 2 + (tile % tile_cols) * (tile_size + tile_gap);
+	     int y = 2 + (tile / tile_cols) * (tile_size + tile_gap);
+	     
+	     GdkGCValues old_vals;
+	     
+	     // Save context
+	     gdk_gc_get_values(gc, &old_vals);
+	     
+	     // Draw the filling
+	     gdk_gc_set_rgb_fg_color(gc, &fill_col);
+	     gdk_draw_rectangle(tiles, gc, TRUE, x, y, tile_size-1, tile_size-1);
+	     
+	     // Draw a border                    
+	     gdk_gc_set_rgb_fg_color(gc, &black_col); 
+	     gdk_draw_rectangle(tiles, gc, FALSE, x, y, tile_size-1, tile_size-1);
+	     
+	     // Restore context
+	     gdk_gc_set_values(gc, &old_vals, GDK_GC_FOREGROUND);
+	  }
+	  
+	  /** The UI thread.  Owns Gtk+ for the whole run. */
+	  virtual void run()
+	  {
+	     gtk_init(NULL, NULL);
+	     
+	     CreateWindow();
+	     
+	     // Update the progress bar.
+		  gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(fixtures_done), 0.0);
+		  
+		  gtk_widget_show (runtests);
+		  
+		  g_timeout_add(refresh_ms, refresh_cb, this);
+		  
+		  gtk_main();
+	  }
+	  
 	  void CreateWindow()
 	  {
         runtests = gtk_window_new (GTK_WINDOW_TOPLEVEL);
@@ -381,7 +690,7 @@ namespace unittest
         gtk_widget_show (passinfo);
         gtk_container_add (GTK_CONTAINER (scrolledwindow5), passinfo);
       
-        label8 = gtk_label_new (_("Passed"));
+        label8 = gtk_label_new (_("Tests"));
         gtk_widget_show (label8);
         gtk_notebook_set_tab_label (GTK_NOTEBOOK (notebook1), gtk_notebook_get_nth_page (GTK_NOTEBOOK (notebook1), 1), label8);
         
@@ -389,60 +698,64 @@ namespace unittest
         GtkCellRenderer   *cell_render; 
         
         /////// Fail List View //////
-        // Create a new store
-        infostore = gtk_list_store_new(5, G_TYPE_STRING, // filename 
-                                          G_TYPE_STRING, // testname
-                                          G_TYPE_UINT,   // line number
-                                          G_TYPE_STRING, // expression
-                                          G_TYPE_STRING); // message
+        // The failures are read straight from the failure vector
+        failure_model = failure_model_new(&failures);
                 
         // Create the columns
         cell_render = gtk_cell_renderer_text_new();
         gtk_tree_view_insert_column_with_attributes(GTK_TREE_VIEW(testinfo), 0,
                                     "Filename", cell_render,
-                                    "text", 0, NULL);
+                                    "text", FAILURE_FILE, NULL);
         
         cell_render = gtk_cell_renderer_text_new();
         gtk_tree_view_insert_column_with_attributes(GTK_TREE_VIEW(testinfo), 1,
                                     "Test", cell_render,
-                                    "text", 1, NULL);
+                                    "text", FAILURE_TEST, NULL);
         
         cell_render = gtk_cell_renderer_text_new();
         gtk_tree_view_insert_column_with_attributes(GTK_TREE_VIEW(testinfo), 2,
                                     "Line", cell_render,
-                                    "text", 2, NULL);
+                                    "text", FAILURE_LINE, NULL);
         
         cell_render = gtk_cell_renderer_text_new();                            
         gtk_tree_view_insert_column_with_attributes(GTK_TREE_VIEW(testinfo), 3,
                                     "Expression", cell_render,
-                                    "text", 3, NULL);
+                                    "text", FAILURE_EXPR, NULL);
         
         cell_render = gtk_cell_renderer_text_new();                            
         gtk_tree_view_insert_column_with_attributes(GTK_TREE_VIEW(testinfo), 4,
                                     "Message", cell_render,
-                                    "text", 4, NULL);  
+                                    "text", FAILURE_MSG, NULL);  
+        
+        // All rows are the same height, so the view does not have to
+        // measure every row.
+        for(int i=0; i<FAILURE_COLUMNS; ++i)
+           gtk_tree_view_column_set_sizing(gtk_tree_view_get_column(GTK_TREE_VIEW(testinfo), i),
+                                           GTK_TREE_VIEW_COLUMN_FIXED);
+        
+        gtk_tree_view_set_fixed_height_mode(GTK_TREE_VIEW(testinfo), TRUE);
                                     
         // Set the model                            
         gtk_tree_view_set_model(GTK_TREE_VIEW(testinfo), 
-                                GTK_TREE_MODEL(infostore));                                  
+                                GTK_TREE_MODEL(failure_model));                                  
         
                                          
         gtk_tree_view_set_headers_visible(GTK_TREE_VIEW(testinfo), TRUE);  
         
         
-        /////// Pass List View //////
+        /////// Test List View //////
         
-        // Create a new store
-        passstore = gtk_list_store_new(4, G_TYPE_STRING, // filename 
+        // Create a new store, one row per test
+        teststore = gtk_list_store_new(4, G_TYPE_STRING, // fixture 
                                           G_TYPE_STRING, // testname
-                                          G_TYPE_UINT,   // line number
-                                          G_TYPE_STRING); // expression
+                                          G_TYPE_UINT,   // passed
+                                          G_TYPE_UINT);  // failed
                                           
                                           
        // Create the columns
         cell_render = gtk_cell_renderer_text_new();
         gtk_tree_view_insert_column_with_attributes(GTK_TREE_VIEW(passinfo), 0,
-                                    "Filename", cell_render,
+                                    "Fixture", cell_render,
                                     "text", 0, NULL);
         
         cell_render = gtk_cell_renderer_text_new();
@@ -452,17 +765,17 @@ namespace unittest
         
         cell_render = gtk_cell_renderer_text_new();
         gtk_tree_view_insert_column_with_attributes(GTK_TREE_VIEW(passinfo), 2,
-                                    "Line", cell_render,
+                                    "Passed", cell_render,
                                     "text", 2, NULL);
         
         cell_render = gtk_cell_renderer_text_new();                            
         gtk_tree_view_insert_column_with_attributes(GTK_TREE_VIEW(passinfo), 3,
-                                    "Expression", cell_render,
+                                    "Failed", cell_render,
                                     "text", 3, NULL);
                                           
         // Set the model                            
         gtk_tree_view_set_model(GTK_TREE_VIEW(passinfo), 
-                                GTK_TREE_MODEL(passstore));                                  
+                                GTK_TREE_MODEL(teststore));                                  
         
                                          
         gtk_tree_view_set_headers_visible(GTK_TREE_VIEW(passinfo), TRUE);
@@ -472,12 +785,16 @@ namespace unittest
         gtk_signal_connect(GTK_OBJECT(runtests),
                      "delete_event",
                      GTK_SIGNAL_FUNC(close_window_cb),
-                     NULL);  
+                     this);  
                      
         // Redraw callback for the red/green/refactor window             
         gtk_signal_connect(GTK_OBJECT(test_output), "expose_event",
                            G_CALLBACK(test_results_expose_cb), this);
                            
+        // Rebuild the heat map when the window is resized
+        gtk_signal_connect(GTK_OBJECT(test_output), "configure_event",
+                           G_CALLBACK(test_results_configure_cb), this);
+                           
         // Redraw callback for the pass/fail window
         gtk_signal_connect(GTK_OBJECT(pass_fail), "expose_event",
                            G_CALLBACK(pass_fail_expose_cb), this);
@@ -510,31 +827,62 @@ namespace unittest
      GtkWidget *passinfo;
      GtkWidget *label8;
         
-     GtkListStore *infostore;
-     GtkListStore *passstore;
+     FailureModel *failure_model;
+     GtkListStore *teststore;
    	  	             
 	};
 	
 // Close the window.
-static gint close_window_cb(GtkWidget* w, GdkEventAny *e, gpointer data)
+static gint close_window_cb(GtkWidget* /*w*/, GdkEventAny * /*e*/, gpointer data)
 {
-   gtk_main_quit();
+   GtkOutputter *outputter = static_cast<GtkOutputter *>(data);
+   
+   outputter->Closed();
    return FALSE;  
 }
 
+// Pick up new results from the test thread.
+static gboolean refresh_cb(gpointer data)
+{
+  GtkOutputter *outputter = static_cast<GtkOutputter *>(data);
+  
+  outputter->Tick();
+  
+  return TRUE;
+}
+
+// Take the rest of a backlog, between redraws.
+static gboolean drain_cb(gpointer data)
+{
+  GtkOutputter *outputter = static_cast<GtkOutputter *>(data);
+  
+  return outputter->Drain();
+}
+
+// The test results were resized
+static gboolean test_results_configure_cb(GtkWidget * /*w*/, GdkEventConfigure * /*event*/,
+                                          gpointer data)
+{
+  GtkOutputter *outputter = static_cast<GtkOutputter *>(data);
+  
+  outputter->ResizeResults();
+
+  return TRUE; 
+}
+
 // Redraw the test results
-static gboolean test_results_expose_cb(GtkWidget *w, GdkEventExpose *event,
+static gboolean test_results_expose_cb(GtkWidget * /*w*/, GdkEventExpose *event,
                                        gpointer data)
 {
   GtkOutputter *outputter = static_cast<GtkOutputter *>(data);
   
-  outputter->DrawResults();
+  outputter->DrawResults(event);
 
   return TRUE; 
 }
 
 // Redraw the test results
-static gboolean pass_fail_expose_cb(GtkWidget *w, GdkEventExpose *event,
+static gboolean pass_fail_expose_cb(GtkWidget * /*w*/, GdkEventExpose * /*event*/,
                                        gpointer data)
 {
   GtkOutputter *outputter = static_cast<GtkOutputter *>(data);
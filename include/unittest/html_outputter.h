@@ -20,7 +20,12 @@ namespace unittest
 		/** The list of events processed. */
 		event_list events;
 		
+		/** The stream the output is written to. */
+		std::ostream &out;
+		
 	public:
+		/** Constructs an outputter that writes to the given stream. */
+		HtmlOutputter(std::ostream &_out = std::cout):out(_out) {}
 	
 		/** Handles event catches. */		
 		virtual void OnEvent(Event &e)
@@ -29,20 +34,20 @@ namespace unittest
 			
 			events.push_back(e);
 			
-			if (e.pass) std::cout << "<img src=\"img/pass.png\" />";
-			else		std::cout << "<img src=\"img/fail.png\" />";
+			if (e.pass) out << "<img src=\"img/pass.png\" />";
+			else		out << "<img src=\"img/fail.png\" />";
 			
-			if (events.size() % 20 == 0) std::cout << "<br>" << std::endl;						
+			if (events.size() % 20 == 0) out << "<br>" << std::endl;						
 		}
 		
 		/** Called when the fixture is about to start. */
 		virtual void OnSuiteStart()
 		{
-			std::cout << "<html><head><title>Unit Test Results</title>" << std::endl
+			out << "<html><head><title>Unit Test Results</title>" << std::endl
 			          << "<link href=\"results.css\" rel=\"stylesheet\" type=\"text/css\"></head><body>" << std::endl;	
 			          
-			std::cout << "<h1>Unit Test Suite Results</h1>" << std::endl;
-			std::cout << "<p class=\"intro\">The following contains the results of running the test suite. "
+			out << "<h1>Unit Test Suite Results</h1>" << std::endl;
+			out << "<p class=\"intro\">The following contains the results of running the test suite. "
 					  << "Each fixture has it's own section.  At the top of that section you will see a "
 					  << "horizontal rule, followed by the name of the fixture in large, bold type. "
 					  << "Below the fixture name will be a line or grid (for many tests) of images. "
@@ -54,7 +59,7 @@ namespace unittest
 		/** When a fixture is starting, this is called. */
 		virtual void OnFixtureStart(const std::string &name)
 		{
-			std::cout << "<br><hr><h2>" << name << "</h2>" << std::endl;	
+			out << "<br><hr><h2>" << name << "</h2>" << std::endl;	
 		}
 		
 		/** When a fixture is done with all it's tests, this is called. */
@@ -66,13 +71,13 @@ namespace unittest
 			{
 				if (!(pos->pass))
 				{
-					std::cout << "<table width=\"100%\">" << std::endl;
-					std::cout << "<tr><td width=\"25%\" class=\"fn_cell\">" << std::endl;
-					std::cout << pos->filename << "</td><td width=\"5%\" class=\"info_cell\">line " << pos->line_num << "</td>" << std::endl 
+					out << "<table width=\"100%\">" << std::endl;
+					out << "<tr><td width=\"25%\" class=\"fn_cell\">" << std::endl;
+					out << pos->filename << "</td><td width=\"5%\" class=\"info_cell\">line " << pos->line_num << "</td>" << std::endl 
 						      << "<td width=\"60%\" class=\"info_cell\">" << pos->expr << "</td></tr>" << std::endl
 						      << "<tr><td colspan=\"3\" valign=\"top\" class=\"msg_cell\">"  << pos->msg  << "</td></tr>" << std::endl;
 						      
-				    std::cout << "</table>" << std::endl;
+				    out << "</table>" << std::endl;
 				}					 
 			}
 			
@@ -83,15 +88,16 @@ namespace unittest
 		virtual void OnSuiteDone()
 		{
 			Listener::OnSuiteDone();				
+			Summary s = getSummary();
 			
-			std::cout << std::endl << std::endl;						
+			out << std::endl << std::endl;						
 			
-			std::cout << std::endl << "<br><hr><h2>Summary</h2><br>"
+			out << std::endl << "<br><hr><h2>Summary</h2><br>"
 				 << "failures="  << s.failures << "<br>" << std::endl
 				 << "passes="    << s.passes   << "<br>" << std::endl
 				 << "event_count=" << s.event_count << "<br>" << std::endl << std::endl;			
 				 
-		    std::cout << "</body></html>" << std::endl;
+		    out << "</body></html>" << std::endl;
 		}
 		
 	};
@@ -0,0 +1,164 @@
+#ifndef __TEST_INSTRUMENTS_H__
+#define __TEST_INSTRUMENTS_H__
+
+#include <vector>
+#include <string>
+#include "config.h"
+#include "listener.h"
+
+namespace unittest
+{
+	/** @brief Measures something about every test, such as its allocations.
+	 *
+	 *  startTest() and stopTest() are called on the thread that runs the
+	 * test, around its per test setup and teardown, so an instrument can
+	 * keep its state in thread local storage.  stopTest() reports what was
+	 * measured through Listener::OnMetric, and any failure at the source
+	 * file and line of the test. */
+	class Instrument
+	{
+	public:
+		virtual ~Instrument() {}
+
+		/** Called just before a test runs. */
+		virtual void startTest() {}
+
+		/** Called just after a test has run. */
+		virtual void stopTest(Listener & /*listener*/, const std::string & /*test*/, const char * /*source*/, uint32_t /*line*/) {}
+
+		/** Called around every call the test makes to its listener, so the
+		 * work of the outputters is not measured as the test's own. */
+		virtual void pause() {}
+		virtual void resume() {}
+	};
+
+	/** Returns the instruments every test is run with. */
+	inline std::vector<Instrument *>& getInstruments()
+	{
+		static std::vector<Instrument *> instruments;
+		return instruments;
+	}
+
+	/** Adds an instrument.  It is not owned, and must outlive the suite. */
+	inline void registerInstrument(Instrument *i)
+	{
+		getInstruments().push_back(i);
+	}
+
+	/** @brief One run of one test.
+	 *
+	 *  The generated fixtures make one around each test, to tell the
+	 * listener and the instruments when the test starts and stops.  While
+	 * the test runs it is the test's listener, and pauses the instruments
+	 * while it passes calls on. */
+	class TestRun : public Listener
+	{
+		Listener &listener;
+		std::string name;
+
+		/** Where the test is written. */
+		const char *source;
+		uint32_t line;
+
+		TestRun(const TestRun &);
+		TestRun& operator=(const TestRun &);
+
+		void pause()
+		{
+			std::vector<Instrument *> &instruments = getInstruments();
+			for(size_t i=instruments.size(); i>0; --i) instruments[i-1]->pause();
+		}
+
+		void resume()
+		{
+			std::vector<Instrument *> &instruments = getInstruments();
+			for(size_t i=0; i<instruments.size(); ++i) instruments[i]->resume();
+		}
+
+	public:
+		TestRun(Listener *_listener, const char *_name, const char *_source = "", uint32_t _line = 0):
+			listener(*_listener), name(_name), source(_source), line(_line)
+		{
+			listener.OnTestStart(name);
+
+			std::vector<Instrument *> &instruments = getInstruments();
+			for(size_t i=0; i<instruments.size(); ++i) instruments[i]->startTest();
+		}
+
+		~TestRun()
+		{
+			std::vector<Instrument *> &instruments = getInstruments();
+			for(size_t i=instruments.size(); i>0; --i) instruments[i-1]->stopTest(listener, name, source, line);
+
+			listener.OnTestDone(name);
+		}
+
+		virtual void OnEvent(Event &e)
+		{
+			pause();
+			listener.OnEvent(e);
+			resume();
+		}
+
+		virtual void OnMetric(const std::string &test, const std::string &metric, double value)
+		{
+			pause();
+			listener.OnMetric(test, metric, value);
+			resume();
+		}
+
+		/** Fails the test for an exception that escaped it. */
+		void escaped(const std::string &msg, unsigned int total_tests, unsigned int current_test)
+		{
+			Event e;
+			e.pass = false;
+			e.msg = msg;
+			e.filename = name;
+			e.expr = "the test";
+			e.total_tests = total_tests;
+			e.current_test = current_test;
+
+			OnEvent(e);
+		}
+	};
+
+	/** @brief Points a fixture's listener at the run of a test while it runs.
+	 *
+	 *  The listener is set back when the guard goes, so a test that throws
+	 * does not leave the fixture reporting to a run that is gone. */
+	class ListenerGuard
+	{
+		Listener *&listener;
+		Listener *outer;
+
+		ListenerGuard(const ListenerGuard &);
+		ListenerGuard& operator=(const ListenerGuard &);
+
+	public:
+		ListenerGuard(Listener *&_listener, Listener *inner):listener(_listener), outer(_listener)
+		{
+			listener = inner;
+		}
+
+		~ListenerGuard() { listener = outer; }
+	};
+}
+
+/**
+ * \def UT_TEST_TRY
+ * \def UT_TEST_CATCH
+ * Put around the setup, body and teardown of a test, so an exception
+ * that escapes them fails the test rather than the whole run.  With
+ * UT_DONT_CATCH they do nothing. */
+#ifdef UT_DONT_CATCH
+#define UT_TEST_TRY
+#define UT_TEST_CATCH(run)
+#else
+#include <exception>
+#define UT_TEST_TRY try
+#define UT_TEST_CATCH(run) \
+	catch(std::exception &e) { (run).escaped(std::string("Standard Exception: ") + e.what(), __total_tests__, __current_test__); } \
+	catch(...) { (run).escaped("Unknown exception.", __total_tests__, __current_test__); }
+#endif
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef __TEST_JOURNAL_H__
+#define __TEST_JOURNAL_H__
+
+#ifndef _WIN32
+
+#include <set>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "config.h"
+#include "listener.h"
+#include "multi_listener.h"
+#include "binary_outputter.h"
+#include "options.h"
+#include "threads.h"
+#include "suite.h"
+
+namespace unittest
+{
+	/** Reads the fixtures a journal holds, each from its BIN_FIXTURE_START to
+	 * its BIN_FIXTURE_DONE, into names.  Returns the length of the journal up
+	 * to the end of the last of them; anything after it is a fixture that was
+	 * still running when the journal stopped. */
+	inline size_t completedFixtures(const std::string &journal, std::set<std::string> &names)
+	{
+		BinaryDecoder dec(journal.data() + binary_log_magic_size, journal.size() - binary_log_magic_size);
+		size_t complete = binary_log_magic_size;
+
+		Event e;
+		std::string name, fixture, metric;
+		double value;
+
+		for(int tag; (tag = dec.next(e, name, metric, value)) != 0; )
+		{
+			if (tag == BIN_FIXTURE_START) fixture = name;
+			else if (tag == BIN_FIXTURE_DONE)
+			{
+				names.insert(fixture);
+				complete = journal.size() - dec.remaining();
+			}
+		}
+
+		return complete;
+	}
+
+	/** @brief Appends the result of each fixture to a file as it finishes.
+	 *
+	 *  The journal is a binary event log of the fixtures that have run.
+	 * Each is written and synced once it is done, so a run that is killed
+	 * loses at most the fixture it was in.  A run resumed from the journal
+	 * skips the fixtures in it and replays their events to the outputters
+	 * when the suite starts, as if they had just run.
+	 *
+	 *  Add it to the outputter after every other listener, so that they
+	 * have all started when it replays. */
+	class Journal : public Listener
+	{
+		/** The journal, open for appending, or -1. */
+		int fd;
+
+		/** The name of the journal, for errors. */
+		std::string path;
+
+		/** Protects enc, as tests of parallel rows report from several threads. */
+		Mutex lock;
+
+		/** The records of the running fixture. */
+		BinaryEncoder enc;
+
+		/** True between OnFixtureStart and OnFixtureDone. */
+		bool in_fixture;
+
+		/** The records of the fixtures run before, to replay. */
+		std::string replay;
+
+		/** The listener they are replayed to. */
+		Listener *target;
+
+		/** True while replaying, when the records come back through target. */
+		bool replaying;
+
+		/** Writes all of data, or returns false. */
+		bool append(const std::string &data)
+		{
+			for(size_t done = 0; done < data.size(); )
+			{
+				ssize_t n = write(fd, data.data() + done, data.size() - done);
+
+				if (n < 0 && errno == EINTR) continue;
+				if (n <= 0) return false;
+
+				done += n;
+			}
+
+			return true;
+		}
+
+		/** Opens the journal, cutting it to size bytes, and writes the magic
+		 * bytes if that leaves it empty. */
+		bool open(size_t size)
+		{
+			fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+			if (fd < 0) return false;
+
+			if (ftruncate(fd, size) != 0 || lseek(fd, 0, SEEK_END) < 0) return false;
+			if (size == 0 && !append(std::string(binary_log_magic, binary_log_magic_size))) return false;
+
+			return fsync(fd) == 0;
+		}
+
+		/** Stops journaling after an error, so the run goes on without it. */
+		void fail()
+		{
+			std::cerr << "unittest: could not write the journal '" << path << "', the run is no longer journaled" << std::endl;
+
+			close(fd);
+			fd = -1;
+		}
+
+	public:
+		Journal():fd(-1), in_fixture(false), target(NULL), replaying(false) {}
+
+		~Journal()
+		{
+			if (fd >= 0) close(fd);
+		}
+
+		/** Starts a new journal at _path. */
+		bool start(const std::string &_path)
+		{
+			path = _path;
+			return open(0);
+		}
+
+		/** Goes on with the journal at _path: the fixtures it holds are skipped
+		 * by the suite and replayed to l when it starts, and the rest are
+		 * added to it.  A journal that does not exist yet is started. */
+		bool resume(const std::string &_path, Suite &suite, Listener &l)
+		{
+			path = _path;
+			if (access(path.c_str(), F_OK) != 0) return open(0);
+
+			std::ifstream in(path.c_str(), std::ios::binary);
+			if (!in) return false;
+
+			std::ostringstream data;
+			data << in.rdbuf();
+			replay = data.str();
+
+			if (replay.empty()) return open(0);
+			if (replay.compare(0, binary_log_magic_size, binary_log_magic) != 0) return false;
+
+			std::set<std::string> names;
+			replay.resize(completedFixtures(replay, names));
+
+			for(std::set<std::string>::iterator pos = names.begin(); pos != names.end(); ++pos)
+				suite.skip(*pos);
+
+			target = &l;
+			return open(replay.size());
+		}
+
+		/** Replays the fixtures of the journal. */
+		virtual void OnSuiteStart()
+		{
+			if (target == NULL || replay.size() <= binary_log_magic_size) return;
+
+			BinaryDecoder dec(replay.data() + binary_log_magic_size, replay.size() - binary_log_magic_size);
+
+			replaying = true;
+			while (dec.replay(*target)) {}
+			replaying = false;
+
+			replay.clear();
+		}
+
+		/** Handles event catches. */
+		virtual void OnEvent(Event &e)
+		{
+			Listener::OnEvent(e);
+
+			ScopedLock l(lock);
+			if (in_fixture) enc.event(e);
+		}
+
+		/** When a fixture is starting, this is called. */
+		virtual void OnFixtureStart(const std::string &name)
+		{
+			if (replaying || fd < 0) return;
+
+			ScopedLock l(lock);
+			enc.clear();
+			enc.fixtureStart(name);
+			in_fixture = true;
+		}
+
+		/** Records a metric, such as a benchmark result. */
+		virtual void OnMetric(const std::string &test, const std::string &name, double value)
+		{
+			ScopedLock l(lock);
+			if (in_fixture) enc.metric(test, name, value);
+		}
+
+		/** Appends the fixture to the journal and syncs it. */
+		virtual void OnFixtureDone()
+		{
+			if (replaying || fd < 0) return;
+
+			ScopedLock l(lock);
+			enc.fixtureDone();
+			in_fixture = false;
+
+			if (!append(enc.data()) || fsync(fd) != 0) fail();
+			enc.clear();
+		}
+	};
+
+	/** Returns the journal of the run. */
+	inline Journal& getJournal()
+	{
+		static Journal journal;
+		return journal;
+	}
+
+	/** Journals the run to the file given by --journal=path, or resumes the
+	 * run journaled there with --resume=path.  Call it once the outputters
+	 * are added.  Returns false if the journal cannot be used. */
+	inline bool startJournal(Suite &suite, MultiListener &outputter)
+	{
+		Options &options = getOptions();
+		if (!options.has("journal") && !options.has("resume")) return true;
+
+		Journal &journal = getJournal();
+		std::string path = options.has("resume") ? options.get("resume") : options.get("journal");
+
+		if (!(options.has("resume") ? journal.resume(path, suite, outputter) : journal.start(path)))
+		{
+			std::cerr << "unittest: could not use the journal '" << path << "'" << std::endl;
+			return false;
+		}
+
+		outputter.addListener(&journal);
+		return true;
+	}
+}
+
+#endif
+
+#endif
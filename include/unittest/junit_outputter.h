@@ -0,0 +1,192 @@
+#ifndef __JUNIT_OUTPUTTER_H__
+#define __JUNIT_OUTPUTTER_H__
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include "listener.h"
+
+namespace unittest
+{
+	/** @brief Outputs events as JUnit style XML, for continuous integration servers.
+	 *
+	 *  Each fixture becomes a testsuite and each test a testcase.  A test fails
+	 * if any of its events failed; the failing events are listed in the failure
+	 * element, with the type "flaky" if repeated runs found that it only fails
+	 * some of the time.  Metrics, such as benchmark results, are properties of their
+	 * testcase. */
+	class JUnitOutputter : public Listener
+	{
+		/** The results of one test. */
+		struct TestCase
+		{
+			std::string name;
+			uint32_t failures;
+			bool flaky;
+			std::string details;
+			std::string properties;
+		};
+
+		/** The type for test lists. */
+		typedef std::vector<TestCase> test_list;
+
+		/** The stream the output is written to. */
+		std::ostream &out;
+
+		/** The name of the running fixture. */
+		std::string fixture;
+
+		/** The tests seen in the running fixture. */
+		test_list tests;
+
+		/** The finished testsuite elements. */
+		std::ostringstream suites;
+
+		/** The number of tests and failed tests over all fixtures. */
+		uint32_t test_count, failed_count;
+
+		/** Escapes text for use in XML attributes and elements. */
+		static std::string escape(const std::string &text)
+		{
+			std::string result;
+
+			for(std::string::const_iterator pos=text.begin(); pos!=text.end(); ++pos)
+			{
+				switch(*pos)
+				{
+				case '&':  result += "&amp;"; break;
+				case '<':  result += "&lt;"; break;
+				case '>':  result += "&gt;"; break;
+				case '"':  result += "&quot;"; break;
+				default:   result += *pos;
+				}
+			}
+
+			return result;
+		}
+
+		/** Returns the test name from an event filename, which looks like
+		 * "source::fixture::test". */
+		static std::string testName(const std::string &filename)
+		{
+			size_t split_pos = filename.rfind("::");
+
+			if (split_pos == std::string::npos) return filename;
+			return filename.substr(split_pos+2);
+		}
+
+		/** Returns the test with the given name, adding it if it is new. */
+		TestCase& testCase(const std::string &name)
+		{
+			if (tests.empty() || tests.back().name != name)
+			{
+				TestCase t;
+				t.name = name;
+				t.failures = 0;
+				t.flaky = false;
+				tests.push_back(t);
+			}
+
+			return tests.back();
+		}
+
+	public:
+		/** Constructs an outputter that writes to the given stream. */
+		JUnitOutputter(std::ostream &_out = std::cout):out(_out), test_count(0), failed_count(0) {}
+
+		/** Handles event catches. */
+		virtual void OnEvent(Event &e)
+		{
+			Listener::OnEvent(e);
+
+			TestCase &t = testCase(testName(e.filename));
+
+			if (!e.pass)
+			{
+				std::ostringstream tmp;
+
+				tmp << e.filename.substr(0, e.filename.find(':')) << ":" << e.line_num << ": "
+				    << e.expr << " failed";
+
+				if (e.msg.size()>0) tmp << " : " << e.msg;
+
+				tmp << std::endl;
+
+				++t.failures;
+				if (e.expr == "--FLAKY--") t.flaky = true;
+				t.details += tmp.str();
+			}
+		}
+
+		/** Adds a metric to the properties of its test. */
+		virtual void OnMetric(const std::string &test, const std::string &name, double value)
+		{
+			std::ostringstream tmp;
+			tmp.precision(12);
+			tmp << "        <property name=\"" << escape(name) << "\" value=\"" << value << "\" />" << std::endl;
+
+			testCase(testName(test)).properties += tmp.str();
+		}
+
+		/** When a fixture is starting, this is called. */
+		virtual void OnFixtureStart(const std::string &name)
+		{
+			fixture = name;
+			tests.clear();
+		}
+
+		/** When a fixture is done with all it's tests, this is called. */
+		virtual void OnFixtureDone()
+		{
+			uint32_t failed = 0;
+
+			for(test_list::iterator pos=tests.begin(); pos!=tests.end(); ++pos)
+				if (pos->failures) ++failed;
+
+			suites << "  <testsuite name=\"" << escape(fixture) << "\" tests=\"" << tests.size()
+			       << "\" failures=\"" << failed << "\">" << std::endl;
+
+			for(test_list::iterator pos=tests.begin(); pos!=tests.end(); ++pos)
+			{
+				suites << "    <testcase classname=\"" << escape(fixture) << "\" name=\"" << escape(pos->name) << "\"";
+
+				if (pos->failures || !pos->properties.empty())
+				{
+					suites << ">" << std::endl;
+
+					if (!pos->properties.empty())
+						suites << "      <properties>" << std::endl << pos->properties << "      </properties>" << std::endl;
+
+					if (pos->failures)
+						suites << "      <failure message=\"" << pos->failures << " failed assertion(s)\""
+						       << (pos->flaky ? " type=\"flaky\"" : "") << ">"
+						       << escape(pos->details) << "</failure>" << std::endl;
+
+					suites << "    </testcase>" << std::endl;
+				}
+				else suites << " />" << std::endl;
+			}
+
+			suites << "  </testsuite>" << std::endl;
+
+			test_count += tests.size();
+			failed_count += failed;
+			tests.clear();
+		}
+
+		/** When a suite is done with all it's tests, this is called. */
+		virtual void OnSuiteDone()
+		{
+			Listener::OnSuiteDone();
+
+			out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << std::endl
+			    << "<testsuites tests=\"" << test_count << "\" failures=\"" << failed_count << "\">" << std::endl
+			    << suites.str()
+			    << "</testsuites>" << std::endl;
+			out.flush();
+		}
+	};
+}
+
+#endif
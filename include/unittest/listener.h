@@ -2,6 +2,8 @@
 #define __TEST_LISTENER_H__
 
 #include "config.h"
+#include "summary.h"
+#include <map>
 #include <string>
 
 namespace unittest
@@ -9,6 +11,8 @@ namespace unittest
 	/** Contains information about test events. */
 	struct Event
 	{
+		Event():pass(false), line_num(0), total_tests(0), current_test(0) {}
+		
 		/** True if it passed, false if it failed. */
 		bool pass;
 		
@@ -31,38 +35,24 @@ namespace unittest
 		uint32_t current_test;		
 	};
 	
-	struct Summary
-	{
-		/** The number of failing events. */
-		uint32_t failures;
-		
-		/** The number of passing events. */
-		uint32_t passes;
-		
-		/** The total number of events. */
-		uint32_t event_count;		
-	};
-	
 	/** Listens for test events.  Test events are essentially pass/fail
 	 * with additional information about what passed and failed. */
 	class Listener
 	{
 	protected:
-		/** A simple summary of information. */
-		Summary s;
+		/** Counts the events, for the summary. */
+		SummaryCounters counters;
 		
 	public:
 		Listener() {}
-		~Listener() {}
+		virtual ~Listener() {}
 		
 		/** Events are received here.  You may do anything you like with the event. Subclasses
-		 * should call this to maintain summary information. */
+		 * should call this to maintain summary information.  It may be called from several
+		 * threads at once. */
 		virtual void OnEvent(Event &e)
 		{
-			if (e.pass) ++s.passes;
-			else		++s.failures;
-			
-			++s.event_count;
+			counters.add(e.pass, e.filename);
 		}
 		
 		/** Called when the suite is about to start. */
@@ -72,7 +62,27 @@ namespace unittest
 		}
 		
 		/** When a fixture is starting, this is called. */
-		virtual void OnFixtureStart(const std::string &name)
+		virtual void OnFixtureStart(const std::string & /*name*/)
+		{
+			
+		}
+		
+		/** Called on the test's own thread just before a test runs.  name
+		 * is "Fixture::test". */
+		virtual void OnTestStart(const std::string & /*name*/)
+		{
+			
+		}
+		
+		/** Reports something measured about a test, such as how many
+		 * allocations it made.  Called before OnTestDone. */
+		virtual void OnMetric(const std::string & /*test*/, const std::string & /*name*/, double /*value*/)
+		{
+			
+		}
+		
+		/** Called on the test's own thread just after a test has run. */
+		virtual void OnTestDone(const std::string & /*name*/)
 		{
 			
 		}
@@ -90,7 +100,14 @@ namespace unittest
 		}
 				
 		/** Returns the summary information for this listener. */
-		virtual Summary getSummary() { return s; }
+		virtual Summary getSummary() { return counters.total(); }
+		
+		/** Returns the summary of each test, by "Fixture::test".  Only call it once the
+		 * tests are done. */
+		std::map<std::string, Summary> getTestSummaries() { return counters.byTest(); }
+		
+		/** Returns the summary of each fixture.  Only call it once the tests are done. */
+		std::map<std::string, Summary> getFixtureSummaries() { return counters.byFixture(); }
 	};
 	
 };
@@ -0,0 +1,103 @@
+#ifndef __TEST_MAPPED_FILE_H__
+#define __TEST_MAPPED_FILE_H__
+
+#include <string>
+
+#ifdef _WIN32
+#include <vector>
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace unittest
+{
+	/** @brief A read only view of a whole file.
+	 *
+	 *  The file is mapped into memory, so only the pages that are used are
+	 * read.  On Windows the file is read into memory instead. */
+	class MappedFile
+	{
+		const char *bytes;
+		size_t length;
+		std::string problem;
+
+#ifdef _WIN32
+		std::vector<char> contents;
+#endif
+
+		MappedFile(const MappedFile &);
+		MappedFile& operator=(const MappedFile &);
+
+	public:
+		/** Maps the file.  If it can not be, error() says why. */
+		MappedFile(const std::string &path):bytes(NULL), length(0)
+		{
+#ifdef _WIN32
+			std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+			if (!in)
+			{
+				problem = "could not open '" + path + "'";
+				return;
+			}
+
+			contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+			length = contents.size();
+			if (length) bytes = &contents[0];
+#else
+			int fd = open(path.c_str(), O_RDONLY);
+			struct stat info;
+
+			if (fd < 0 || fstat(fd, &info) != 0)
+			{
+				problem = "could not open '" + path + "'";
+				if (fd >= 0) close(fd);
+				return;
+			}
+
+			length = info.st_size;
+
+			// An empty file can not be mapped, but there is nothing to read anyway.
+			if (length)
+			{
+				void *p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+				if (p == MAP_FAILED)
+				{
+					problem = "could not map '" + path + "'";
+					length = 0;
+				}
+				else
+				{
+					bytes = static_cast<const char *>(p);
+					madvise(p, length, MADV_SEQUENTIAL);
+				}
+			}
+
+			close(fd);
+#endif
+		}
+
+		~MappedFile()
+		{
+#ifndef _WIN32
+			if (bytes) munmap(const_cast<char *>(bytes), length);
+#endif
+		}
+
+		/** Returns the contents of the file. */
+		const char *data() const { return bytes; }
+
+		/** Returns the size of the file. */
+		size_t size() const { return length; }
+
+		/** Returns why the file could not be mapped, or an empty string. */
+		const std::string& error() const { return problem; }
+	};
+}
+
+#endif
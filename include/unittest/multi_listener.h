@@ -0,0 +1,296 @@
+#ifndef __TEST_MULTI_LISTENER_H__
+#define __TEST_MULTI_LISTENER_H__
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include "listener.h"
+#include "threads.h"
+
+namespace unittest
+{
+	/** Forwards every event to a list of other listeners, so one run can
+	 * feed several outputters at once. */
+	class MultiListener : public Listener
+	{
+		/** The type for listener lists. */
+		typedef std::vector<Listener *> listener_list;
+
+		/** The listeners events are forwarded to, in the order they were added. */
+		listener_list listeners;
+
+	public:
+
+		/** Adds a listener to the fan-out list.  The listener is not owned. */
+		void addListener(Listener *l) { listeners.push_back(l); }
+
+		/** Stops forwarding events to a listener. */
+		void removeListener(Listener *l)
+		{
+			listeners.erase(std::remove(listeners.begin(), listeners.end(), l), listeners.end());
+		}
+
+		/** Returns the number of listeners events are forwarded to. */
+		size_t size() const { return listeners.size(); }
+
+		/** Handles event catches. */
+		virtual void OnEvent(Event &e)
+		{
+			Listener::OnEvent(e);
+
+			for(listener_list::iterator pos=listeners.begin(); pos!=listeners.end(); ++pos)
+				(*pos)->OnEvent(e);
+		}
+
+		/** Called when the suite is about to start. */
+		virtual void OnSuiteStart()
+		{
+			for(listener_list::iterator pos=listeners.begin(); pos!=listeners.end(); ++pos)
+				(*pos)->OnSuiteStart();
+		}
+
+		/** When a fixture is starting, this is called. */
+		virtual void OnFixtureStart(const std::string &name)
+		{
+			for(listener_list::iterator pos=listeners.begin(); pos!=listeners.end(); ++pos)
+				(*pos)->OnFixtureStart(name);
+		}
+
+		/** Called just before a test runs. */
+		virtual void OnTestStart(const std::string &name)
+		{
+			for(listener_list::iterator pos=listeners.begin(); pos!=listeners.end(); ++pos)
+				(*pos)->OnTestStart(name);
+		}
+
+		/** Reports something measured about a test. */
+		virtual void OnMetric(const std::string &test, const std::string &name, double value)
+		{
+			for(listener_list::iterator pos=listeners.begin(); pos!=listeners.end(); ++pos)
+				(*pos)->OnMetric(test, name, value);
+		}
+
+		/** Called just after a test has run. */
+		virtual void OnTestDone(const std::string &name)
+		{
+			for(listener_list::iterator pos=listeners.begin(); pos!=listeners.end(); ++pos)
+				(*pos)->OnTestDone(name);
+		}
+
+		/** When a fixture is done with all it's tests, this is called. */
+		virtual void OnFixtureDone()
+		{
+			for(listener_list::iterator pos=listeners.begin(); pos!=listeners.end(); ++pos)
+				(*pos)->OnFixtureDone();
+		}
+
+		/** When a suite is done with all it's tests, this is called. */
+		virtual void OnSuiteDone()
+		{
+			for(listener_list::iterator pos=listeners.begin(); pos!=listeners.end(); ++pos)
+				(*pos)->OnSuiteDone();
+		}
+	};
+
+	/** @brief Feeds another listener from a background thread.
+	 *
+	 *  Events are copied into a queue on the test thread and handed to the
+	 * wrapped listener by a worker thread, so slow sinks (files, html) do not
+	 * hold up the tests.  The worker drains the queue in batches.  OnSuiteDone
+	 * blocks until everything queued has been delivered. */
+	class AsyncListener : public Listener, private Thread
+	{
+		/** The kinds of callbacks that can be queued. */
+		enum RecordType { SUITE_START, FIXTURE_START, TEST_START, EVENT, METRIC, TEST_DONE, FIXTURE_DONE, SUITE_DONE };
+
+		/** One queued callback. */
+		struct Record
+		{
+			RecordType type;
+			Event e;
+			std::string name;
+			std::string metric;
+			double value;
+		};
+
+		/** The type for the record queue. */
+		typedef std::deque<Record> record_queue;
+
+		/** The listener that actually handles the callbacks. */
+		Listener &target;
+
+		/** Protects pending and done. */
+		Mutex lock;
+
+		/** Signalled when records are queued. */
+		Condition ready;
+
+		/** Records waiting for the worker. */
+		record_queue pending;
+
+		/** Set once the suite is done and nothing else will be queued. */
+		bool done;
+
+		/** False if the worker could not be started.  Records are then delivered directly. */
+		bool running;
+
+		/** Hands a record to the target listener. */
+		void dispatch(Record &r)
+		{
+			switch(r.type)
+			{
+			case SUITE_START:   target.OnSuiteStart(); break;
+			case FIXTURE_START: target.OnFixtureStart(r.name); break;
+			case TEST_START:    target.OnTestStart(r.name); break;
+			case EVENT:         target.OnEvent(r.e); break;
+			case METRIC:        target.OnMetric(r.name, r.metric, r.value); break;
+			case TEST_DONE:     target.OnTestDone(r.name); break;
+			case FIXTURE_DONE:  target.OnFixtureDone(); break;
+			case SUITE_DONE:    target.OnSuiteDone(); break;
+			}
+		}
+
+		/** Queues a record, or delivers it directly if there is no worker. */
+		void push(Record &r)
+		{
+			if (!running)
+			{
+				dispatch(r);
+				return;
+			}
+
+			ScopedLock l(lock);
+			pending.push_back(r);
+			ready.signal();
+		}
+
+		/** Drains the queue until the suite is done. */
+		virtual void run()
+		{
+			record_queue batch;
+
+			for(;;)
+			{
+				{
+					ScopedLock l(lock);
+					while (pending.empty() && !done) ready.wait(lock);
+
+					if (pending.empty()) return;
+
+					batch.swap(pending);
+				}
+
+				for(record_queue::iterator pos=batch.begin(); pos!=batch.end(); ++pos)
+					dispatch(*pos);
+
+				batch.clear();
+			}
+		}
+
+	public:
+		/** Wraps a listener.  The listener is not owned. */
+		AsyncListener(Listener &_target):target(_target), done(false), running(false) {}
+
+		~AsyncListener()
+		{
+			finish();
+		}
+
+		/** Handles event catches. */
+		virtual void OnEvent(Event &e)
+		{
+			Listener::OnEvent(e);
+
+			Record r;
+			r.type = EVENT;
+			r.e = e;
+			push(r);
+		}
+
+		/** Called when the suite is about to start. Starts the worker. */
+		virtual void OnSuiteStart()
+		{
+			done = false;
+			running = start();
+
+			Record r;
+			r.type = SUITE_START;
+			push(r);
+		}
+
+		/** When a fixture is starting, this is called. */
+		virtual void OnFixtureStart(const std::string &name)
+		{
+			Record r;
+			r.type = FIXTURE_START;
+			r.name = name;
+			push(r);
+		}
+
+		/** Called just before a test runs. */
+		virtual void OnTestStart(const std::string &name)
+		{
+			Record r;
+			r.type = TEST_START;
+			r.name = name;
+			push(r);
+		}
+
+		/** Reports something measured about a test. */
+		virtual void OnMetric(const std::string &test, const std::string &name, double value)
+		{
+			Record r;
+			r.type = METRIC;
+			r.name = test;
+			r.metric = name;
+			r.value = value;
+			push(r);
+		}
+
+		/** Called just after a test has run. */
+		virtual void OnTestDone(const std::string &name)
+		{
+			Record r;
+			r.type = TEST_DONE;
+			r.name = name;
+			push(r);
+		}
+
+		/** When a fixture is done with all it's tests, this is called. */
+		virtual void OnFixtureDone()
+		{
+			Record r;
+			r.type = FIXTURE_DONE;
+			push(r);
+		}
+
+		/** When a suite is done with all it's tests, this is called.  Waits
+		 * for the worker to deliver everything that was queued. */
+		virtual void OnSuiteDone()
+		{
+			Record r;
+			r.type = SUITE_DONE;
+			push(r);
+
+			finish();
+		}
+
+	private:
+		/** Stops the worker once the queue is empty. */
+		void finish()
+		{
+			if (!running) return;
+
+			{
+				ScopedLock l(lock);
+				done = true;
+				ready.signal();
+			}
+
+			join();
+			running = false;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef __TEST_OPTIONS_H__
+#define __TEST_OPTIONS_H__
+
+#include <map>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+namespace unittest
+{
+	/** @brief Run time options for the test binary.
+	 *
+	 *  Options are given on the command line as <tt>--name=value</tt> or
+	 * <tt>--name</tt>.  Any option not on the command line may instead be set
+	 * in the environment as UT_NAME, with dashes turned into underscores, so
+	 * <tt>--async-output</tt> can also be given as UT_ASYNC_OUTPUT=1. */
+	class Options
+	{
+		/** The type for the option map. */
+		typedef std::map<std::string, std::string> option_map;
+
+		/** Options given on the command line. */
+		option_map values;
+
+		/** Command line arguments that are not options. */
+		std::vector<std::string> args;
+
+		/** The whole command line, the program first. */
+		std::vector<std::string> line;
+
+		/** Returns the environment variable name for an option. */
+		static std::string envName(const std::string &name)
+		{
+			std::string result = "UT_";
+
+			for(std::string::const_iterator pos=name.begin(); pos!=name.end(); ++pos)
+			{
+				if (*pos == '-') result += '_';
+				else if (*pos >= 'a' && *pos <= 'z') result += static_cast<char>(*pos - 'a' + 'A');
+				else result += *pos;
+			}
+
+			return result;
+		}
+
+	public:
+
+		/** Reads options from the command line. */
+		void parse(int argc, char *argv[])
+		{
+			line.assign(argv, argv + argc);
+
+			for(int i=1; i<argc; ++i)
+			{
+				std::string arg = argv[i];
+
+				if (arg.size() <= 2 || arg.compare(0, 2, "--") != 0)
+				{
+					args.push_back(arg);
+					continue;
+				}
+
+				size_t split_pos = arg.find('=');
+
+				if (split_pos == std::string::npos) values[arg.substr(2)] = "1";
+				else values[arg.substr(2, split_pos-2)] = arg.substr(split_pos+1);
+			}
+		}
+
+		/** Sets an option, overriding the command line and environment. */
+		void set(const std::string &name, const std::string &value) { values[name] = value; }
+
+		/** Returns true if the option was given. */
+		bool has(const std::string &name) const
+		{
+			return values.find(name) != values.end() || std::getenv(envName(name).c_str()) != NULL;
+		}
+
+		/** Returns the value of an option, or def if it was not given. */
+		std::string get(const std::string &name, const std::string &def = "") const
+		{
+			option_map::const_iterator pos = values.find(name);
+			if (pos != values.end()) return pos->second;
+
+			const char *env = std::getenv(envName(name).c_str());
+			if (env != NULL) return env;
+
+			return def;
+		}
+
+		/** Returns the value of a numeric option, or def if it was not given. */
+		long getInt(const std::string &name, long def = 0) const
+		{
+			std::string value = get(name);
+			if (value.empty()) return def;
+
+			return std::strtol(value.c_str(), NULL, 0);
+		}
+
+		/** Returns the command line arguments that were not options. */
+		const std::vector<std::string>& arguments() const { return args; }
+
+		/** Returns the command line the options were read from, to start
+		 * more of the same program with. */
+		const std::vector<std::string>& commandLine() const { return line; }
+	};
+
+	/** Returns the options for this run. */
+	inline Options& getOptions()
+	{
+		static Options options;
+		return options;
+	}
+}
+
+#endif
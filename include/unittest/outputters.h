@@ -0,0 +1,221 @@
+#ifndef __TEST_OUTPUTTERS_H__
+#define __TEST_OUTPUTTERS_H__
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
+
+#include "options.h"
+#include "multi_listener.h"
+#include "compiler_outputter.h"
+#include "xml_outputter.h"
+#include "html_outputter.h"
+#include "junit_outputter.h"
+#include "binary_outputter.h"
+#include "trace_outputter.h"
+
+namespace unittest
+{
+	/** Creates an outputter that writes to the given stream. */
+	typedef Listener *(*outputter_factory)(std::ostream *out);
+
+	/** The name of the factory function exported by outputter plugins.  A plugin
+	 * named "foo" is a shared library called libunittest_foo.so (unittest_foo.dll
+	 * on Windows) that exports
+	 * <tt>extern "C" unittest::Listener *unittest_create_outputter(std::ostream *out)</tt>. */
+	static const char outputter_plugin_entry[] = "unittest_create_outputter";
+
+	/** Creates an outputter of type T. */
+	template<class T>
+	Listener *createOutputter(std::ostream *out) { return new T(*out); }
+
+	/** @brief Selects outputters at startup.
+	 *
+	 *  Outputters are chosen by name from a comma separated list such as
+	 * "compiler,junit:results.xml".  Only the selected outputters are
+	 * constructed.  The built in ones are compiler, xml, html, junit, binary
+	 * and trace.  Any other name is loaded as a plugin when it is selected, which
+	 * is how the Gtk GUI is provided, so test binaries do not link Gtk unless
+	 * it is used. */
+	class Outputters
+	{
+		/** A built in outputter. */
+		struct Entry
+		{
+			const char *name;
+			outputter_factory create;
+		};
+
+		/** The listener the selected outputters are added to. */
+		MultiListener &target;
+
+		/** The directory plugins are looked for in first, if not empty. */
+		std::string plugin_path;
+
+		/** Outputters, streams and wrappers created here. */
+		std::vector<Listener *> listeners;
+		std::vector<std::ostream *> streams;
+
+		/** Returns the factory for a built in outputter, or NULL. */
+		static outputter_factory builtin(const std::string &name)
+		{
+			static const Entry entries[] =
+			{
+				{ "compiler", &createOutputter<CompilerOutputter> },
+				{ "xml",      &createOutputter<XmlOutputter> },
+				{ "html",     &createOutputter<HtmlOutputter> },
+				{ "junit",    &createOutputter<JUnitOutputter> },
+				{ "binary",   &createOutputter<BinaryOutputter> },
+				{ "trace",    &createOutputter<TraceOutputter> }
+			};
+
+			for(size_t i=0; i<sizeof(entries)/sizeof(entries[0]); ++i)
+				if (name == entries[i].name) return entries[i].create;
+
+			return NULL;
+		}
+
+		/** Returns the directory of the test binary, or an empty string if it
+		 * can not be found. */
+		static std::string binaryDirectory()
+		{
+			char path[4096];
+#ifdef _WIN32
+			DWORD size = GetModuleFileNameA(NULL, path, sizeof(path));
+			if (size == 0 || size >= sizeof(path)) return "";
+			std::string exe(path, size);
+			size_t slash = exe.find_last_of("\\/");
+#else
+			ssize_t size = readlink("/proc/self/exe", path, sizeof(path));
+			if (size <= 0 || size >= ssize_t(sizeof(path))) return "";
+			std::string exe(path, size);
+			size_t slash = exe.rfind('/');
+#endif
+			return slash == std::string::npos ? "" : exe.substr(0, slash);
+		}
+
+		/** Loads the factory for a plugin outputter, or returns NULL. The library
+		 * is looked for in --plugin-path, then beside the test binary, then, but
+		 * for Windows, on the system's search path; never in the working
+		 * directory, unless that is one of these.  It stays loaded for the rest
+		 * of the run. */
+		outputter_factory plugin(const std::string &name)
+		{
+			std::string binary_dir = binaryDirectory();
+#ifdef _WIN32
+			std::string lib = "unittest_" + name + ".dll";
+			HMODULE handle = NULL;
+
+			if (!plugin_path.empty()) handle = LoadLibraryA((plugin_path + "\\" + lib).c_str());
+			if (handle == NULL && !binary_dir.empty()) handle = LoadLibraryA((binary_dir + "\\" + lib).c_str());
+			if (handle == NULL) return NULL;
+
+			return reinterpret_cast<outputter_factory>(GetProcAddress(handle, outputter_plugin_entry));
+#else
+			std::string lib = "libunittest_" + name + ".so";
+			void *handle = NULL;
+
+			if (!plugin_path.empty()) handle = dlopen((plugin_path + "/" + lib).c_str(), RTLD_NOW);
+			if (handle == NULL && !binary_dir.empty()) handle = dlopen((binary_dir + "/" + lib).c_str(), RTLD_NOW);
+			if (handle == NULL) handle = dlopen(lib.c_str(), RTLD_NOW);
+
+			if (handle == NULL)
+			{
+				std::cerr << "unittest: " << dlerror() << std::endl;
+				return NULL;
+			}
+
+			return reinterpret_cast<outputter_factory>(dlsym(handle, outputter_plugin_entry));
+#endif
+		}
+
+	public:
+		/** Selected outputters are added to the given listener. */
+		Outputters(MultiListener &_target, const std::string &_plugin_path = ""):
+			target(_target), plugin_path(_plugin_path) {}
+
+		/** Deletes the outputters and closes their files. */
+		~Outputters()
+		{
+			for(size_t i=listeners.size(); i>0; --i) delete listeners[i-1];
+			for(size_t i=streams.size(); i>0; --i) delete streams[i-1];
+		}
+
+		/** Creates one outputter.  spec is a name optionally followed by ':' and
+		 * the file to write to.  If async is true, outputters writing to files
+		 * are fed from a background thread.  Returns false if the outputter is
+		 * unknown or its file could not be opened. */
+		bool add(const std::string &spec, bool async)
+		{
+			size_t split_pos = spec.find(':');
+			std::string name = spec.substr(0, split_pos);
+			std::ostream *out = &std::cout;
+
+			outputter_factory create = builtin(name);
+			if (create == NULL) create = plugin(name);
+
+			if (create == NULL)
+			{
+				std::cerr << "unittest: unknown outputter '" << name << "'" << std::endl;
+				return false;
+			}
+
+			if (split_pos != std::string::npos)
+			{
+				std::ofstream *file = new std::ofstream(spec.substr(split_pos+1).c_str(), std::ios::out | std::ios::binary);
+				streams.push_back(file);
+
+				if (!*file)
+				{
+					std::cerr << "unittest: could not open '" << spec.substr(split_pos+1) << "'" << std::endl;
+					return false;
+				}
+
+				out = file;
+			}
+
+			Listener *l = create(out);
+			if (l == NULL) return false;
+
+			listeners.push_back(l);
+
+			// The trace is timed as events arrive, and only written at the end.
+			if (async && out != &std::cout && name != "trace")
+			{
+				l = new AsyncListener(*l);
+				listeners.push_back(l);
+			}
+
+			target.addListener(l);
+			return true;
+		}
+
+		/** Creates every outputter in a comma separated list. */
+		bool select(const std::string &specs, bool async)
+		{
+			size_t start = 0;
+
+			while (start <= specs.size())
+			{
+				size_t end = specs.find(',', start);
+				if (end == std::string::npos) end = specs.size();
+
+				if (end > start && !add(specs.substr(start, end-start), async)) return false;
+
+				start = end+1;
+			}
+
+			return true;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,404 @@
+#ifndef __TEST_PERF_COUNTERS_H__
+#define __TEST_PERF_COUNTERS_H__
+
+#include <string>
+#include <sstream>
+#include <iostream>
+#include "config.h"
+#include "listener.h"
+#include "options.h"
+#include "instruments.h"
+
+#if defined(__linux__)
+#include <cstring>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#if defined(__linux__) && defined(__NR_perf_event_open)
+#define UT_HAVE_PERF_EVENTS
+#endif
+
+namespace unittest
+{
+	/** The hardware counters that are measured. */
+	enum PerfCounter
+	{
+		perf_instructions,
+		perf_cycles,
+		perf_cache_misses,
+		perf_branch_misses,
+		perf_counter_count
+	};
+
+	/** Returns the metric name of a counter, such as "cache-misses". */
+	inline const char *perfCounterName(int counter)
+	{
+		static const char *const names[perf_counter_count] = { "instructions", "cycles", "cache-misses", "branch-misses" };
+		return names[counter];
+	}
+
+	/** The counters read at one moment.  A counter the machine does not have
+	 * is left out of available. */
+	struct PerfCounts
+	{
+		uint64_t value[perf_counter_count];
+		unsigned available;
+
+		PerfCounts():available(0) { for(int i=0; i<perf_counter_count; ++i) value[i] = 0; }
+
+		bool has(int counter) const { return (available & (1u << counter)) != 0; }
+	};
+
+	/** @brief A perf_event_open counter group for one thread.
+	 *
+	 *  The counters only count user space, which an unprivileged process may
+	 * do for itself when perf_event_paranoid is 2 or less.  They start
+	 * disabled; enable() and disable() nest, so a measurement can be made
+	 * inside another.  Where there are no counters, such as in a container
+	 * without perf access or a virtual machine without a PMU, available() is
+	 * false and everything else does nothing. */
+	class PerfGroup
+	{
+		int fds[perf_counter_count];
+		int leader, depth;
+
+		/** Where each counter is in the values read from the group. */
+		int slot[perf_counter_count];
+		int opened;
+
+		PerfGroup(const PerfGroup &);
+		PerfGroup& operator=(const PerfGroup &);
+
+#ifdef UT_HAVE_PERF_EVENTS
+		int open(int counter)
+		{
+			static const uint64_t configs[perf_counter_count] = {
+				PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES,
+				PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+
+			struct perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = configs[counter];
+			attr.disabled = leader < 0;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+			return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0));
+		}
+#endif
+
+	public:
+		PerfGroup():leader(-1), depth(0), opened(0)
+		{
+			for(int i=0; i<perf_counter_count; ++i) fds[i] = slot[i] = -1;
+
+#ifdef UT_HAVE_PERF_EVENTS
+			// Without instructions the group is not worth having.
+			for(int i=0; i<perf_counter_count; ++i)
+			{
+				fds[i] = open(i);
+
+				if (fds[i] < 0)
+				{
+					if (i == perf_instructions) return;
+					continue;
+				}
+
+				if (leader < 0) leader = fds[i];
+				slot[i] = opened++;
+			}
+#endif
+		}
+
+		~PerfGroup()
+		{
+#ifdef UT_HAVE_PERF_EVENTS
+			for(int i=0; i<perf_counter_count; ++i) if (fds[i] >= 0) close(fds[i]);
+#endif
+		}
+
+		/** Returns true if the instruction counter, at least, could be opened. */
+		bool available() const { return leader >= 0; }
+
+		/** Returns true while the counters are enabled. */
+		bool running() const { return depth > 0; }
+
+		void enable()
+		{
+#ifdef UT_HAVE_PERF_EVENTS
+			if (depth++ == 0 && leader >= 0) ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+		}
+
+		void disable()
+		{
+#ifdef UT_HAVE_PERF_EVENTS
+			if (--depth == 0 && leader >= 0) ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#endif
+		}
+
+		/** Reads the counters so far.  If the kernel had to share the hardware
+		 * with other groups, the counts are scaled up to the whole time the
+		 * group was enabled. */
+		bool read(PerfCounts &counts) const
+		{
+			counts.available = 0;
+
+#ifdef UT_HAVE_PERF_EVENTS
+			if (leader < 0) return false;
+
+			uint64_t data[3 + perf_counter_count];
+			if (::read(leader, data, sizeof(data)) < ssize_t(3 * sizeof(uint64_t))) return false;
+
+			uint64_t time_enabled = data[1], time_running = data[2];
+
+			for(int i=0; i<perf_counter_count; ++i)
+			{
+				if (slot[i] < 0) continue;
+
+				uint64_t value = data[3 + slot[i]];
+				if (time_running > 0 && time_running < time_enabled) value = uint64_t(double(value) * time_enabled / time_running);
+
+				counts.value[i] = value;
+				counts.available |= 1u << i;
+			}
+
+			return true;
+#else
+			return false;
+#endif
+		}
+	};
+
+	/** Holds the counter group of this thread, if it has one yet. */
+	inline PerfGroup *&perfGroupSlot()
+	{
+		static __thread PerfGroup *group = NULL;
+		return group;
+	}
+
+#ifdef UT_HAVE_PERF_EVENTS
+	inline void deletePerfGroup(void *group) { delete static_cast<PerfGroup *>(group); }
+
+	inline pthread_key_t& perfGroupKey()
+	{
+		static pthread_key_t key;
+		return key;
+	}
+
+	inline void makePerfGroupKey() { pthread_key_create(&perfGroupKey(), deletePerfGroup); }
+#endif
+
+	/** Returns the counter group of this thread, opening it the first time.
+	 * It is closed when the thread exits. */
+	inline PerfGroup& perfGroup()
+	{
+		PerfGroup *&group = perfGroupSlot();
+
+		if (group == NULL)
+		{
+			group = new PerfGroup;
+
+#ifdef UT_HAVE_PERF_EVENTS
+			static pthread_once_t once = PTHREAD_ONCE_INIT;
+			pthread_once(&once, makePerfGroupKey);
+			pthread_setspecific(perfGroupKey(), group);
+#endif
+		}
+
+		return *group;
+	}
+
+	/** @brief Counts the instructions, and the other counters, of some code.
+	 *
+	 *  start() and stop() are read as close to the code as they can be, and
+	 * the instructions of an empty measurement are taken off, so a short
+	 * expression is counted almost exactly. */
+	class PerfMeasure
+	{
+		PerfGroup &group;
+		PerfCounts before, after;
+
+		/** The instructions an empty measurement counts on this thread. */
+		static uint64_t& overhead()
+		{
+			static __thread uint64_t instructions = ~uint64_t(0);
+			return instructions;
+		}
+
+		uint64_t raw(int counter) const { return after.value[counter] - before.value[counter]; }
+
+	public:
+		PerfMeasure():group(perfGroup())
+		{
+			if (overhead() != ~uint64_t(0) || !group.available()) return;
+
+			// The least of a few tries, so the first page faults do not count.
+			uint64_t least = ~uint64_t(0);
+			for(int i=0; i<3; ++i)
+			{
+				start();
+				stop();
+				if (raw(perf_instructions) < least) least = raw(perf_instructions);
+			}
+
+			overhead() = least;
+		}
+
+		bool available() const { return group.available(); }
+
+		void start()
+		{
+			group.enable();
+			group.read(before);
+		}
+
+		/** Returns true, so it can end a comma expression. */
+		bool stop()
+		{
+			group.read(after);
+			group.disable();
+			return true;
+		}
+
+		/** Returns true if the counter was measured. */
+		bool has(int counter) const { return before.has(counter) && after.has(counter); }
+
+		/** Returns what a counter counted between start() and stop(). */
+		uint64_t count(int counter) const
+		{
+			uint64_t value = raw(counter);
+
+			if (counter == perf_instructions && overhead() != ~uint64_t(0))
+				value = value > overhead() ? value - overhead() : 0;
+
+			return value;
+		}
+	};
+
+	/** Checks UT_ASSERT_INSTRUCTIONS_LESS, after the expression has been
+	 * measured.  Without counters it passes, and says it could not check. */
+	inline bool checkInstructionsLess(const PerfMeasure &measure, uint64_t limit, std::string &report)
+	{
+		if (!measure.has(perf_instructions))
+		{
+			report = "instruction counters are not available, so this was not checked";
+			return true;
+		}
+
+		uint64_t count = measure.count(perf_instructions);
+		if (count < limit) return true;
+
+		std::ostringstream out;
+		out << "took " << count << " instructions, not fewer than " << limit;
+		report = out.str();
+
+		return false;
+	}
+
+	/** @brief Reports the hardware counters of every test.
+	 *
+	 *  Registered by the test binary when it is run with --perf-counters.
+	 * Each test reports the metrics "instructions", "cycles",
+	 * "cache-misses" and "branch-misses", for its setup, body and teardown,
+	 * without the work of the listener.  If the counters can not be opened
+	 * this says so once and measures nothing. */
+	class PerfInstrument : public Instrument
+	{
+		static PerfCounts& start()
+		{
+			static __thread PerfCounts *counts = NULL;
+			if (counts == NULL) counts = new PerfCounts;
+			return *counts;
+		}
+
+		static int& paused()
+		{
+			static __thread int depth = 0;
+			return depth;
+		}
+
+		static bool& stopped()
+		{
+			static __thread bool disabled = false;
+			return disabled;
+		}
+
+		static bool usable()
+		{
+			if (perfGroup().available()) return true;
+
+			static bool warned = false;
+			if (!warned)
+			{
+				warned = true;
+				std::cerr << "warning: hardware counters are not available (see /proc/sys/kernel/perf_event_paranoid); tests will not be counted" << std::endl;
+			}
+
+			return false;
+		}
+
+	public:
+		virtual void startTest()
+		{
+			if (!usable()) return;
+
+			PerfGroup &group = perfGroup();
+			group.enable();
+			group.read(start());
+		}
+
+		/** Stops counting while the listener runs, on a thread that is
+		 * counting.  Listeners can be called from inside one another, so
+		 * only the outermost call does anything. */
+		virtual void pause()
+		{
+			PerfGroup *group = perfGroupSlot();
+			if (paused()++ == 0 && group != NULL && group->running())
+			{
+				group->disable();
+				stopped() = true;
+			}
+		}
+
+		virtual void resume()
+		{
+			if (--paused() == 0 && stopped())
+			{
+				perfGroupSlot()->enable();
+				stopped() = false;
+			}
+		}
+
+		virtual void stopTest(Listener &listener, const std::string &test, const char * /*source*/, uint32_t /*line*/)
+		{
+			PerfGroup &group = perfGroup();
+			if (!group.available() || !group.running()) return;
+
+			PerfCounts end;
+			group.read(end);
+			group.disable();
+
+			PerfCounts &begin = start();
+			for(int i=0; i<perf_counter_count; ++i)
+				if (begin.has(i) && end.has(i)) listener.OnMetric(test, perfCounterName(i), double(end.value[i] - begin.value[i]));
+		}
+	};
+
+	/** Returns the instrument --perf-counters registers. */
+	inline PerfInstrument& getPerfInstrument()
+	{
+		static PerfInstrument instrument;
+		return instrument;
+	}
+}
+
+#endif
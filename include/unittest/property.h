@@ -0,0 +1,574 @@
+#ifndef __TEST_PROPERTY_H__
+#define __TEST_PROPERTY_H__
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <exception>
+#include <cmath>
+#include <ctime>
+#include <cstdlib>
+#include <unistd.h>
+#include "config.h"
+#include "listener.h"
+#include "options.h"
+#include "threads.h"
+#include "random.h"
+
+/**
+ * \def UT_PROPERTY_CHECK
+ * @param expr The condition that must hold for every input.
+ *
+ * @brief Falsifies the property being checked if expr is false.  May
+ * only be used in the body of a UT_PROPERTY. */
+#define UT_PROPERTY_CHECK(expr) \
+	if (!(expr)) { __why__ = #expr; return false; }
+
+namespace unittest
+{
+	/** Formats a generated value for a counterexample. */
+	template<class T>
+	std::string formatValue(const T &v)
+	{
+		std::ostringstream out;
+		out.precision(17);
+		out << v;
+		return out.str();
+	}
+
+	inline std::string formatValue(const char &v) { return formatValue(int(v)); }
+	inline std::string formatValue(const signed char &v) { return formatValue(int(v)); }
+	inline std::string formatValue(const unsigned char &v) { return formatValue(int(v)); }
+	inline std::string formatValue(const bool &v) { return v ? "true" : "false"; }
+	inline std::string formatValue(const std::string &v) { return "\"" + v + "\""; }
+
+	/** @brief Generates integers of type T between lo and hi inclusive.
+	 *
+	 *  A generator has a value_type, fills arrays of values with generate(),
+	 * and gives simpler versions of a value with shrink().  One value in
+	 * sixteen is an edge of the range, where bugs tend to be.  Values shrink
+	 * towards zero, or the end of the range nearest to zero. */
+	template<class T>
+	class Integers
+	{
+		T lo, hi;
+
+		/** The simplest value in the range. */
+		T origin() const
+		{
+			if (lo > T(0)) return lo;
+			if (hi < T(0)) return hi;
+			return T(0);
+		}
+
+	public:
+		typedef T value_type;
+
+		Integers(T _lo, T _hi):lo(_lo), hi(_hi) {}
+
+		void generate(XorShift &rng, T *out, size_t count) const
+		{
+			// Wraps to zero for the full 64 bit range, which below() allows for.
+			uint64_t span = uint64_t(hi) - uint64_t(lo) + 1;
+
+			for(size_t i=0; i<count; ++i)
+			{
+				uint64_t r = rng.next();
+
+				if ((r & 15) != 0) out[i] = T(uint64_t(lo) + rng.below(span));
+				else switch((r >> 4) % 5)
+				{
+				case 0: out[i] = lo; break;
+				case 1: out[i] = hi; break;
+				case 2: out[i] = origin(); break;
+				case 3: out[i] = lo < hi ? T(lo+1) : lo; break;
+				default: out[i] = lo < hi ? T(hi-1) : hi; break;
+				}
+			}
+		}
+
+		void shrink(const T &v, std::vector<T> &smaller) const
+		{
+			T target = origin();
+			if (v == target) return;
+
+			smaller.push_back(target);
+
+			// Halfway there, then one step there.
+			uint64_t distance = v > target ? uint64_t(v) - uint64_t(target) : uint64_t(target) - uint64_t(v);
+			T half = v > target ? T(uint64_t(target) + distance/2) : T(uint64_t(target) - distance/2);
+			T step = v > target ? T(v-1) : T(v+1);
+
+			if (half != target) smaller.push_back(half);
+			if (step != half && step != target) smaller.push_back(step);
+		}
+
+		std::string format(const T &v) const { return formatValue(v); }
+	};
+
+	/** The common integer generators. */
+	typedef Integers<int> Ints;
+	typedef Integers<unsigned int> UInts;
+	typedef Integers<int64_t> Int64s;
+
+	/** @brief Generates floating point numbers of type T between lo and hi.
+	 *
+	 *  Values shrink towards zero, or the end of the range nearest to it,
+	 * first to whole numbers and then by halving the distance. */
+	template<class T>
+	class Reals
+	{
+		T lo, hi;
+
+		T origin() const
+		{
+			if (lo > T(0)) return lo;
+			if (hi < T(0)) return hi;
+			return T(0);
+		}
+
+		/** Adds v to the list if it is in range and new. */
+		void offer(T v, const T &from, std::vector<T> &smaller) const
+		{
+			if (v < lo || v > hi || v == from) return;
+
+			for(size_t i=0; i<smaller.size(); ++i)
+				if (smaller[i] == v) return;
+
+			smaller.push_back(v);
+		}
+
+	public:
+		typedef T value_type;
+
+		Reals(T _lo, T _hi):lo(_lo), hi(_hi) {}
+
+		void generate(XorShift &rng, T *out, size_t count) const
+		{
+			for(size_t i=0; i<count; ++i)
+			{
+				uint64_t r = rng.next();
+
+				if ((r & 15) != 0) out[i] = T(lo + (hi - lo) * rng.unit());
+				else switch((r >> 4) % 3)
+				{
+				case 0: out[i] = lo; break;
+				case 1: out[i] = hi; break;
+				default: out[i] = origin(); break;
+				}
+			}
+		}
+
+		void shrink(const T &v, std::vector<T> &smaller) const
+		{
+			T target = origin();
+			if (v == target || v != v) return;
+
+			offer(target, v, smaller);
+			offer(T(v < target ? std::ceil(v) : std::floor(v)), v, smaller);
+			offer(T(target + (v - target) / 2), v, smaller);
+		}
+
+		std::string format(const T &v) const { return formatValue(v); }
+	};
+
+	/** The common floating point generators. */
+	typedef Reals<float> Floats;
+	typedef Reals<double> Doubles;
+
+	/** Generates true and false.  Shrinks true to false. */
+	class Bools
+	{
+	public:
+		typedef bool value_type;
+
+		void generate(XorShift &rng, bool *out, size_t count) const
+		{
+			for(size_t i=0; i<count; ++i) out[i] = (rng.next() >> 63) != 0;
+		}
+
+		void shrink(const bool &v, std::vector<bool> &smaller) const
+		{
+			if (v) smaller.push_back(false);
+		}
+
+		std::string format(const bool &v) const { return formatValue(v); }
+	};
+
+	/** @brief Generates strings of up to max_len characters from an alphabet.
+	 *
+	 *  Strings shrink by dropping halves, then single characters, then by
+	 * turning characters into the first letter of the alphabet. */
+	class Strings
+	{
+		size_t max_len;
+		std::string alphabet;
+
+	public:
+		typedef std::string value_type;
+
+		Strings(size_t _max_len, const std::string &_alphabet = "abcdefghijklmnopqrstuvwxyz0123456789 "):
+			max_len(_max_len), alphabet(_alphabet) {}
+
+		void generate(XorShift &rng, std::string *out, size_t count) const
+		{
+			for(size_t i=0; i<count; ++i)
+			{
+				size_t len = rng.below(max_len+1);
+
+				out[i].resize(len);
+				for(size_t j=0; j<len; ++j) out[i][j] = alphabet[rng.below(alphabet.size())];
+			}
+		}
+
+		void shrink(const std::string &v, std::vector<std::string> &smaller) const
+		{
+			if (v.empty()) return;
+
+			smaller.push_back("");
+
+			if (v.size() > 1)
+			{
+				smaller.push_back(v.substr(0, v.size()/2));
+				smaller.push_back(v.substr(v.size()/2));
+			}
+
+			for(size_t i=0; i<v.size() && i<16; ++i)
+				smaller.push_back(v.substr(0, i) + v.substr(i+1));
+
+			size_t pos = v.find_first_not_of(alphabet[0]);
+			if (pos != std::string::npos)
+			{
+				std::string simpler = v;
+				simpler[pos] = alphabet[0];
+				smaller.push_back(simpler);
+			}
+		}
+
+		std::string format(const std::string &v) const { return formatValue(v); }
+	};
+
+	/** Fills the unused generator slots of a property. */
+	struct Nothing
+	{
+		typedef Nothing value_type;
+
+		void generate(XorShift & /*rng*/, Nothing * /*out*/, size_t /*count*/) const {}
+		void shrink(const Nothing & /*v*/, std::vector<Nothing> & /*smaller*/) const {}
+		std::string format(const Nothing & /*v*/) const { return ""; }
+	};
+
+	/** A contiguous array of generated inputs.  Unlike std::vector<bool>,
+	 * it is a real array for every type. */
+	template<class V>
+	class PropertyInputs
+	{
+		V *items;
+		size_t count;
+
+		PropertyInputs(const PropertyInputs &);
+		PropertyInputs& operator=(const PropertyInputs &);
+
+	public:
+		PropertyInputs():items(NULL), count(0) {}
+		~PropertyInputs() { delete [] items; }
+
+		/** Makes room for at least n inputs. */
+		void reserve(size_t n)
+		{
+			if (n <= count) return;
+
+			delete [] items;
+			items = new V[n];
+			count = n;
+		}
+
+		V *data() { return items; }
+		V& operator[](size_t i) { return items[i]; }
+	};
+
+	/** The number of cases generated at a time, one array per generator. */
+	static const size_t property_batch = 1024;
+
+	/** The most simpler inputs tried when shrinking a counterexample. */
+	static const size_t property_max_shrinks = 2000;
+
+	/** @brief Checks a property against many random inputs.
+	 *
+	 *  Inputs are generated in batches, each from its own seed, so any case
+	 * can be generated again without the ones before it.  Batches are handed
+	 * out to worker threads, so the check function must not touch shared
+	 * state.  The first failing case is the same however many threads run:
+	 * workers stop only at batches past the earliest failure found.  That
+	 * case is then shrunk on the calling thread.
+	 *
+	 *  The number of cases, the seed and the number of threads come from the
+	 * --property-cases, --property-seed and --property-threads options. */
+	template<class G1, class G2, class G3, class G4>
+	class Property
+	{
+	public:
+		typedef typename G1::value_type V1;
+		typedef typename G2::value_type V2;
+		typedef typename G3::value_type V3;
+		typedef typename G4::value_type V4;
+
+		/** The property.  Returns false, and says why, if it does not hold. */
+		typedef bool (*check_fn)(std::string &why, const V1 &, const V2 &, const V3 &, const V4 &);
+
+	private:
+		/** One batch of inputs. */
+		struct Batch
+		{
+			PropertyInputs<V1> v1;
+			PropertyInputs<V2> v2;
+			PropertyInputs<V3> v3;
+			PropertyInputs<V4> v4;
+		};
+
+		/** Runs part of the property on a thread of its own. */
+		class Worker : public Thread
+		{
+			Property &p;
+
+		public:
+			Worker(Property &_p):p(_p) {}
+
+		protected:
+			virtual void run() { p.work(); }
+		};
+
+		check_fn check;
+		std::string names;
+		G1 g1;
+		G2 g2;
+		G3 g3;
+		G4 g4;
+
+		unsigned long seed;
+		size_t cases;
+
+		/** The next batch to hand out. */
+		volatile size_t next_batch;
+
+		/** The earliest failing case found, or cases if none. */
+		volatile size_t first_failure;
+		Mutex failure_lock;
+
+		/** Generates the inputs of a batch. */
+		void fill(Batch &b, size_t index, size_t count)
+		{
+			XorShift rng(uint64_t(seed) + uint64_t(index) * 0x9E3779B97F4A7C15ULL);
+
+			b.v1.reserve(count);
+			b.v2.reserve(count);
+			b.v3.reserve(count);
+			b.v4.reserve(count);
+
+			g1.generate(rng, b.v1.data(), count);
+			g2.generate(rng, b.v2.data(), count);
+			g3.generate(rng, b.v3.data(), count);
+			g4.generate(rng, b.v4.data(), count);
+		}
+
+		/** Checks one case.  Exceptions falsify the property. */
+		bool passes(std::string &why, const V1 &a, const V2 &b, const V3 &c, const V4 &d)
+		{
+			try
+			{
+				return check(why, a, b, c, d);
+			}
+			catch(std::exception &e)
+			{
+				why = std::string("Standard Exception: ") + e.what();
+			}
+			catch(...)
+			{
+				why = "Unknown exception.";
+			}
+
+			return false;
+		}
+
+		/** Notes a failing case if it is the earliest so far. */
+		void failed(size_t index)
+		{
+			ScopedLock l(failure_lock);
+			if (index < first_failure) first_failure = index;
+		}
+
+		/** Tries the simpler values for one input.  Keeps the first that still
+		 * fails and returns true, or returns false if none do. */
+		template<class G, class V>
+		bool shrinkInput(const G &g, V &input, V1 &a, V2 &b, V3 &c, V4 &d, std::string &why, size_t &tries)
+		{
+			std::vector<V> smaller;
+			g.shrink(input, smaller);
+
+			for(size_t i=0; i<smaller.size() && tries<property_max_shrinks; ++i, ++tries)
+			{
+				V old = input;
+				std::string tmp;
+
+				input = smaller[i];
+				if (!passes(tmp, a, b, c, d))
+				{
+					why = tmp;
+					return true;
+				}
+
+				input = old;
+			}
+
+			return false;
+		}
+
+		/** Adds "name = value" for one input to a counterexample. */
+		template<class G, class V>
+		void describe(std::ostringstream &out, const G &g, const V &v, size_t &name_pos)
+		{
+			std::string text = g.format(v);
+			if (text.empty()) return;
+
+			size_t end = names.find(',', name_pos);
+			if (end == std::string::npos) end = names.size();
+
+			if (name_pos) out << ", ";
+			out << names.substr(name_pos, end-name_pos) << " = " << text;
+			name_pos = end < names.size() ? end+1 : end;
+		}
+
+	public:
+		/** names lists the names of the inputs, separated by commas. */
+		Property(check_fn _check, const char *_names, const G1 &_g1, const G2 &_g2, const G3 &_g3, const G4 &_g4):
+			check(_check), names(_names), g1(_g1), g2(_g2), g3(_g3), g4(_g4), next_batch(0)
+		{
+			Options &options = getOptions();
+
+			cases = options.getInt("property-cases", 10000);
+
+			if (options.has("property-seed")) seed = std::strtoul(options.get("property-seed").c_str(), NULL, 0);
+			else seed = (unsigned long)(std::time(NULL)) ^ ((unsigned long)(getpid()) << 16);
+
+			first_failure = cases;
+		}
+
+		/** Checks batches until there are none left.  Called by every thread. */
+		void work()
+		{
+			Batch b;
+			std::string why;
+
+			for(;;)
+			{
+				size_t index = __sync_fetch_and_add(&next_batch, 1);
+				size_t start = index * property_batch;
+
+				if (start >= cases || start >= first_failure) break;
+
+				size_t count = cases - start < property_batch ? cases - start : property_batch;
+				fill(b, index, count);
+
+				for(size_t i=0; i<count; ++i)
+				{
+					if (!passes(why, b.v1[i], b.v2[i], b.v3[i], b.v4[i]))
+					{
+						failed(start+i);
+						break;
+					}
+				}
+			}
+		}
+
+		/** Checks the property and sets pass and msg of the event.  On failure
+		 * msg holds the shrunk counterexample and the seed to repeat it. */
+		void run(Event &e)
+		{
+			long threads = getOptions().getInt("property-threads", processorCount());
+			std::vector<Worker *> workers;
+
+			// This thread is a worker too.
+			for(long i=1; i<threads && size_t(i)*property_batch < cases; ++i)
+			{
+				Worker *w = new Worker(*this);
+
+				if (w->start()) workers.push_back(w);
+				else delete w;
+			}
+
+			work();
+
+			for(size_t i=0; i<workers.size(); ++i)
+			{
+				workers[i]->join();
+				delete workers[i];
+			}
+
+			std::ostringstream out;
+
+			if (first_failure >= cases)
+			{
+				e.pass = true;
+				out << cases << " cases, --property-seed=" << seed;
+				e.msg = out.str();
+				return;
+			}
+
+			// Make the failing case again, from a batch of the size it was
+			// checked in, as the generators share the batch's seed.
+			Batch b;
+			size_t index = first_failure / property_batch, offset = first_failure % property_batch;
+			size_t start = index * property_batch;
+			fill(b, index, cases - start < property_batch ? cases - start : property_batch);
+
+			V1 a = b.v1[offset];
+			V2 bb = b.v2[offset];
+			V3 c = b.v3[offset];
+			V4 d = b.v4[offset];
+			std::string why;
+			size_t tries = 0, shrinks = 0;
+
+			e.pass = false;
+
+			if (passes(why, a, bb, c, d))
+			{
+				out << "Falsified after " << first_failure+1 << " cases, but the case passed when checked again,"
+				    << " so the property depends on more than its inputs (--property-seed=" << seed << ")";
+				e.msg = out.str();
+				return;
+			}
+
+			// Then look for a simpler one.
+
+			while (tries < property_max_shrinks &&
+			       (shrinkInput(g1, a, a, bb, c, d, why, tries) ||
+			        shrinkInput(g2, bb, a, bb, c, d, why, tries) ||
+			        shrinkInput(g3, c, a, bb, c, d, why, tries) ||
+			        shrinkInput(g4, d, a, bb, c, d, why, tries)))
+				++shrinks;
+
+			size_t name_pos = 0;
+
+			out << "Falsified after " << first_failure+1 << " cases by ";
+			describe(out, g1, a, name_pos);
+			describe(out, g2, bb, name_pos);
+			describe(out, g3, c, name_pos);
+			describe(out, g4, d, name_pos);
+			out << " (" << why << "; shrunk " << shrinks << " times, --property-seed=" << seed << ")";
+
+			e.msg = out.str();
+		}
+	};
+
+	/** Checks a property and fills in the result in e.  Unused generators
+	 * are Nothing. */
+	template<class G1, class G2, class G3, class G4>
+	void checkProperty(Event &e, typename Property<G1, G2, G3, G4>::check_fn check, const char *names,
+	                   const G1 &g1, const G2 &g2, const G3 &g3, const G4 &g4)
+	{
+		Property<G1, G2, G3, G4> p(check, names, g1, g2, g3, g4);
+		p.run(e);
+	}
+}
+
+#endif
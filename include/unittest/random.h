@@ -0,0 +1,98 @@
+#ifndef __TEST_RANDOM_H__
+#define __TEST_RANDOM_H__
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+#include "config.h"
+#include "options.h"
+
+namespace unittest
+{
+	/** @brief A fast xorshift128+ random number generator.
+	 *
+	 *  Not for cryptography, but fast and good enough for test inputs.  The
+	 * same seed always gives the same numbers. */
+	class XorShift
+	{
+		uint64_t s0, s1;
+
+		/** Steps a splitmix64 generator, used to spread the bits of a seed. */
+		static uint64_t mix(uint64_t &x)
+		{
+			uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			return z ^ (z >> 31);
+		}
+
+	public:
+		XorShift(uint64_t seed) { s0 = mix(seed); s1 = mix(seed); }
+
+		/** Returns the next 64 random bits. */
+		uint64_t next()
+		{
+			uint64_t x = s0;
+			const uint64_t y = s1;
+
+			s0 = y;
+			x ^= x << 23;
+			s1 = x ^ y ^ (x >> 17) ^ (y >> 26);
+			return s1 + y;
+		}
+
+		/** Returns a number below n.  n of 0 means any 64 bit number. */
+		uint64_t below(uint64_t n) { return n ? next() % n : next(); }
+
+		/** Returns a number in [0, 1). */
+		double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+	};
+
+	/** @brief Returns the seed that orders the tests, from --seed.
+	 *
+	 *  If --seed was not given one is made from the time and set as
+	 * --seed, so the outputters can report it and the run can be
+	 * repeated. */
+	inline uint64_t runSeed()
+	{
+		Options &options = getOptions();
+
+		if (!options.has("seed"))
+		{
+			std::ostringstream tmp;
+			tmp << (uint64_t(std::time(NULL)) ^ (uint64_t(getpid()) << 16));
+			options.set("seed", tmp.str());
+		}
+
+		return std::strtoull(options.get("seed").c_str(), NULL, 0);
+	}
+
+	/** Puts the items in a random order, the same for the same seed. */
+	template<class T>
+	void shuffle(std::vector<T> &items, XorShift &rng)
+	{
+		for(size_t i=items.size(); i>1; --i)
+		{
+			size_t j = size_t(rng.below(i));
+			T item = items[i-1];
+			items[i-1] = items[j];
+			items[j] = item;
+		}
+	}
+
+	/** Returns the numbers below count in an order shuffled from seed. */
+	inline std::vector<unsigned int> shuffledOrder(unsigned int count, uint64_t seed)
+	{
+		std::vector<unsigned int> order;
+		for(unsigned int i=0; i<count; ++i) order.push_back(i);
+
+		XorShift rng(seed);
+		shuffle(order, rng);
+		return order;
+	}
+}
+
+#endif
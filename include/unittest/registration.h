@@ -0,0 +1,193 @@
+#ifndef __TEST_REGISTRATION_H__
+#define __TEST_REGISTRATION_H__
+
+#include <vector>
+#include <string>
+#include "config.h"
+#include "listener.h"
+#include "fixture.h"
+#include "instruments.h"
+#include "suite.h"
+
+#if defined(__GNUC__) && defined(__ELF__)
+#define UT_FIXTURE_SECTION
+
+/* The linker defines these around the section.  They are weak, so a
+ * binary without any such fixtures still links. */
+extern "C" unittest::FixtureEntry __start_ut_fixtures[] __attribute__((weak, visibility("hidden")));
+extern "C" unittest::FixtureEntry __stop_ut_fixtures[] __attribute__((weak, visibility("hidden")));
+#endif
+
+namespace unittest
+{
+	/** The entries of fixtures without a section, most recent first. */
+	inline FixtureEntry *&fixtureEntries()
+	{
+		static FixtureEntry *first = NULL;
+		return first;
+	}
+
+	/** Adds an entry to fixtureEntries() when constructed.  It only stores
+	 * two pointers. */
+	struct FixtureRegistrar
+	{
+		FixtureRegistrar(FixtureEntry &entry)
+		{
+			entry.next = fixtureEntries();
+			fixtureEntries() = &entry;
+		}
+	};
+
+	/** Registers every fixture in the fixture table with the suite, in the
+	 * order they were linked.  It costs a pointer for each and makes none
+	 * of them.  It is static so that a test module loaded by a daemon built
+	 * with -rdynamic reads its own table, not the daemon's. */
+	static inline void registerFixtures(Suite &suite)
+	{
+#ifdef UT_FIXTURE_SECTION
+		for(FixtureEntry *e = __start_ut_fixtures; e != NULL && e < __stop_ut_fixtures; ++e)
+			suite.registerFixture(*e);
+#else
+		std::vector<FixtureEntry *> entries;
+		for(FixtureEntry *e = fixtureEntries(); e != NULL; e = e->next) entries.push_back(e);
+
+		for(size_t i=entries.size(); i>0; --i) suite.registerFixture(*entries[i-1]);
+#endif
+	}
+
+	/** Picks the overload of a test by its number. */
+	template<int N>
+	struct TestIndex {};
+
+	/** A test of fixture T. */
+	template<class T>
+	struct TestInfo
+	{
+		const char *name;
+		void (T::*run)();
+
+		/** Where the test is written. */
+		const char *source;
+		uint32_t line;
+	};
+
+	/** @brief Finds a test of T by its number, between Lo and Hi, by halving.
+	 *
+	 *  Each UT_TEST declares an overload of T::__ut_test__ for its number,
+	 * so the table is looked up without being stored anywhere. */
+	template<class T, int Lo, int Hi, int Size = Hi - Lo>
+	struct TestTable
+	{
+		enum { Mid = Lo + Size / 2 };
+
+		static TestInfo<T> get(unsigned int index)
+		{
+			return int(index) < Mid ? TestTable<T, Lo, Mid>::get(index) : TestTable<T, Mid, Hi>::get(index);
+		}
+	};
+
+	template<class T, int Lo, int Hi>
+	struct TestTable<T, Lo, Hi, 1>
+	{
+		static TestInfo<T> get(unsigned int) { return T::__ut_test__(TestIndex<Lo>()); }
+	};
+
+	template<class T, int Lo, int Hi>
+	struct TestTable<T, Lo, Hi, 0>
+	{
+		static TestInfo<T> get(unsigned int)
+		{
+			TestInfo<T> none = { "", NULL, "", 0 };
+			return none;
+		}
+	};
+
+	/** @brief The base of a fixture written with the macros.
+	 *
+	 *  It fills in what unittest.py generates for a fixture: the test
+	 * table, running one test and making new instances.  T is the fixture
+	 * itself. */
+	template<class T>
+	class RegisteredFixture : public Fixture
+	{
+		/** The names of the tests, as "Fixture::test", made when first asked for. */
+		mutable std::vector<std::string> names;
+
+	protected:
+		unsigned int __total_tests__, __current_test__;
+
+	public:
+		/** UT_FRESH_FIXTURE sets this in the fixture. */
+		enum { __ut_fresh__ = 0 };
+
+		RegisteredFixture(const char *_name):Fixture(_name), __total_tests__(0), __current_test__(0) {}
+
+		/** Makes an instance, for the fixture table. */
+		static Fixture *make()
+		{
+			T *fixture = new T;
+			if (T::__ut_fresh__) fixture->setFresh(true);
+			return fixture;
+		}
+
+		/** Returns the number of tests, for the fixture table. */
+		static unsigned int tests() { return T::__ut_count__; }
+
+		/** Returns the name of a test, for the fixture table. */
+		static const char *test(unsigned int index) { return TestTable<T, 0, T::__ut_count__>::get(index).name; }
+
+		virtual unsigned int testCount() const { return T::__ut_count__; }
+
+		virtual const char *testName(unsigned int index) const
+		{
+			if (names.empty())
+			{
+				for(unsigned int i=0; i<testCount(); ++i)
+					names.push_back(name + "::" + TestTable<T, 0, T::__ut_count__>::get(i).name);
+			}
+
+			return names[index].c_str();
+		}
+
+		virtual Fixture *create() const { return new T; }
+
+		virtual void runTest(unsigned int index)
+		{
+			__total_tests__ = testCount();
+			__current_test__ = index;
+
+			TestInfo<T> info = TestTable<T, 0, T::__ut_count__>::get(index);
+			TestRun run(listener, testName(index), info.source, info.line);
+			ListenerGuard guard(listener, &run);
+
+			UT_TEST_TRY
+			{
+				setupTest();
+				(static_cast<T *>(this)->*info.run)();
+				teardownTest();
+			}
+			UT_TEST_CATCH(run)
+		}
+	};
+}
+
+/**
+ * \def UT_FIXTURE_ENTRY
+ * Adds a fixture to the fixture table: its name, and functions that make
+ * it, count its tests and name them. */
+#ifdef UT_FIXTURE_SECTION
+#define UT_FIXTURE_ENTRY(name, create, count, test) \
+	static unittest::FixtureEntry ut_fixture_##name __attribute__((section("ut_fixtures"), used, aligned(sizeof(void *)))) = \
+		{ #name, create, count, test, NULL };
+#else
+#define UT_FIXTURE_ENTRY(name, create, count, test) \
+	static unittest::FixtureEntry ut_fixture_##name = { #name, create, count, test, NULL }; \
+	static unittest::FixtureRegistrar ut_registrar_##name(ut_fixture_##name);
+#endif
+
+/** Adds a fixture written with the macros to the fixture table. */
+#define UT_REGISTER_FIXTURE(name) \
+	UT_FIXTURE_ENTRY(name, &unittest::RegisteredFixture<test_##name>::make, \
+	                 &unittest::RegisteredFixture<test_##name>::tests, &unittest::RegisteredFixture<test_##name>::test)
+
+#endif
@@ -0,0 +1,371 @@
+#ifndef __TEST_REPEAT_H__
+#define __TEST_REPEAT_H__
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+#include <unistd.h>
+#include "config.h"
+#include "listener.h"
+#include "fixture.h"
+#include "suite.h"
+#include "options.h"
+#include "threads.h"
+#include "random.h"
+
+namespace unittest
+{
+	/** Reads a length of time, such as "90", "90s", "10m" or "2h", in
+	 * seconds.  Returns 0 if it can not be read. */
+	inline double parseDuration(const std::string &text)
+	{
+		char *end;
+		double value = std::strtod(text.c_str(), &end);
+
+		switch(*end)
+		{
+		case 0:
+		case 's': return value;
+		case 'm': return value * 60;
+		case 'h': return value * 3600;
+		default:  return 0;
+		}
+	}
+
+	/** Returns true if the test binary was asked to run the tests over and
+	 * over, with --repeat, --until-fail or --duration. */
+	inline bool repeating(const Options &options)
+	{
+		return options.has("repeat") || options.has("until-fail") || options.has("duration");
+	}
+
+	/** One test of a fixture. */
+	struct TestRef
+	{
+		Fixture *fixture;
+		unsigned int index;
+
+		/** Where the test is in the suite, counting from the first test of
+		 * the first fixture. */
+		unsigned int slot;
+	};
+
+	/** Returns every test of the suite, in the order they were registered. */
+	inline std::vector<TestRef> testTable(Suite &suite)
+	{
+		std::vector<TestRef> table;
+		const std::vector<Fixture *> &fixtures = suite.getFixtures();
+
+		for(size_t i=0; i<fixtures.size(); ++i)
+		{
+			for(unsigned int j=0; j<fixtures[i]->testCount(); ++j)
+			{
+				TestRef t = { fixtures[i], j, unsigned(table.size()) };
+				table.push_back(t);
+			}
+		}
+
+		return table;
+	}
+
+	/** @brief Runs the tests of a suite over and over, to find the ones
+	 * that only fail now and then.
+	 *
+	 *  Every round runs each test once, in the order --shuffle runs them
+	 * with the seed of the round, and each run is on a new instance of its fixture, with
+	 * its own setup and teardown.  Runs are shared out to --repeat-threads
+	 * threads, by default one per processor.  It stops after --repeat=n
+	 * rounds, after --duration, such as "10m", or, with --until-fail, at the
+	 * first failure.  The first round's seed is --seed, or one made from
+	 * the time if it is not given.
+	 *
+	 *  Each test is then reported once, with the metrics "runs",
+	 * "failures" and "failure-rate".  A test that always passed reports the
+	 * events of one run, and one that always failed the events of its first
+	 * failing run.  A test that failed only sometimes is flaky: it reports a
+	 * single failure with the expression "--FLAKY--", saying how often it
+	 * failed, the seed of the first round it failed in, and what failed. */
+	class Repeater
+	{
+		/** Keeps the events of one run. */
+		class Recorder : public Listener
+		{
+		public:
+			std::vector<Event> events;
+			bool failed;
+
+			Recorder():failed(false) {}
+
+			virtual void OnEvent(Event &e)
+			{
+				events.push_back(e);
+				if (!e.pass) failed = true;
+			}
+		};
+
+		/** What happened to one test over all its runs. */
+		struct Result
+		{
+			uint64_t runs, failures;
+
+			/** The number of the first failing run, or of the first run if
+			 * none failed, and its events. */
+			uint64_t first;
+			std::vector<Event> events;
+			bool failed;
+
+			Result():runs(0), failures(0), first(~uint64_t(0)), failed(false) {}
+
+			void add(uint64_t run, Recorder &r)
+			{
+				++runs;
+				if (r.failed) ++failures;
+
+				// A failing run beats any passing one, and an earlier run a later one.
+				if (r.failed != failed ? r.failed : run < first)
+				{
+					first = run;
+					failed = r.failed;
+					events.swap(r.events);
+				}
+			}
+
+			void add(Result &other)
+			{
+				runs += other.runs;
+				failures += other.failures;
+
+				if (other.runs > 0 && (other.failed != failed ? other.failed : other.first < first))
+				{
+					first = other.first;
+					failed = other.failed;
+					events.swap(other.events);
+				}
+			}
+		};
+
+		class Worker : public Thread
+		{
+			Repeater &repeater;
+
+		public:
+			std::vector<Result> results;
+
+			Worker(Repeater &_repeater):repeater(_repeater), results(_repeater.table.size()) {}
+
+			virtual void run() { repeater.work(results); }
+		};
+
+		Suite &suite;
+		Listener &listener;
+
+		/** The fixtures, all made, and every test of them. */
+		std::vector<Fixture *> fixtures;
+		std::vector<TestRef> table;
+
+		/** Where the first test of each fixture is in the table. */
+		std::vector<unsigned int> starts;
+
+		/** Whether each test of the table was selected to run, and how many were. */
+		std::vector<bool> selected;
+		size_t round_size;
+
+		uint64_t seed;
+
+		/** The number of runs to make, or 0 for no limit, and when to stop,
+		 * or 0 for never. */
+		uint64_t limit, deadline;
+		bool until_fail;
+
+		/** The next run to hand out. */
+		volatile uint64_t next;
+		volatile int stop;
+
+		/** Returns the seed of a round. */
+		uint64_t roundSeed(uint64_t round) const { return seed + round * 0x9E3779B97F4A7C15ULL; }
+
+		/** Puts the tests in the order --shuffle --seed=seed runs them in:
+		 * the fixtures shuffled, then the tests of each. */
+		void shuffled(uint64_t seed, std::vector<TestRef> &order) const
+		{
+
+			std::vector<unsigned int> fixture_order;
+			for(unsigned int i=0; i<fixtures.size(); ++i) fixture_order.push_back(i);
+
+			XorShift rng(seed);
+			shuffle(fixture_order, rng);
+
+			order.clear();
+
+			for(size_t i=0; i<fixture_order.size(); ++i)
+			{
+				unsigned int f = fixture_order[i];
+				std::vector<unsigned int> tests = shuffledOrder(fixtures[f]->testCount(), rng.next());
+
+				for(size_t j=0; j<tests.size(); ++j)
+				{
+					const TestRef &t = table[starts[f] + tests[j]];
+					if (selected[t.slot]) order.push_back(t);
+				}
+			}
+		}
+
+		/** Runs tests until there are no more to run. */
+		void work(std::vector<Result> &results)
+		{
+			std::vector<TestRef> order;
+			uint64_t round = ~uint64_t(0);
+
+			while (!stop)
+			{
+				uint64_t run = __sync_fetch_and_add(&next, 1);
+
+				if (limit != 0 && run >= limit) break;
+				if (deadline != 0 && monotonicClock() >= deadline) break;
+
+				if (run / round_size != round)
+				{
+					round = run / round_size;
+					shuffled(roundSeed(round), order);
+				}
+
+				const TestRef &t = order[run % round_size];
+
+				Fixture *instance = t.fixture->create();
+				if (instance == NULL) continue;
+
+				Recorder recorder;
+
+				instance->setListener(&recorder);
+				instance->setup();
+				instance->runTest(t.index);
+				instance->teardown();
+				delete instance;
+
+				if (recorder.failed && until_fail) stop = 1;
+				results[t.slot].add(run, recorder);
+			}
+		}
+
+		/** Reports one test. */
+		void report(const TestRef &t, Result &r)
+		{
+			std::string name = t.fixture->testName(t.index);
+
+			listener.OnTestStart(name);
+
+			if (r.failures == 0 || r.failures == r.runs)
+			{
+				for(size_t i=0; i<r.events.size(); ++i) listener.OnEvent(r.events[i]);
+			}
+			else
+			{
+				// Report where the first failing run failed first.
+				Event e;
+				for(size_t i=0; i<r.events.size(); ++i)
+				{
+					if (r.events[i].pass) continue;
+					e = r.events[i];
+					break;
+				}
+
+				std::ostringstream msg;
+				msg << "failed " << r.failures << " of " << r.runs << " runs (" << 100.0 * r.failures / r.runs
+				    << "%), first with --shuffle --seed=" << roundSeed(r.first / round_size) << ": " << e.expr << " failed";
+				if (e.msg.size() > 0) msg << " : " << e.msg;
+
+				e.pass = false;
+				e.expr = "--FLAKY--";
+				e.msg = msg.str();
+				listener.OnEvent(e);
+			}
+
+			listener.OnMetric(name, "runs", double(r.runs));
+			listener.OnMetric(name, "failures", double(r.failures));
+			listener.OnMetric(name, "failure-rate", r.runs ? double(r.failures) / r.runs : 0);
+
+			listener.OnTestDone(name);
+		}
+
+	public:
+		Repeater(Suite &_suite, Listener &_listener):
+			suite(_suite), listener(_listener), fixtures(_suite.getFixtures()), table(testTable(_suite)), round_size(0), limit(0), deadline(0), next(0), stop(0)
+		{
+			Options &options = getOptions();
+			seed = runSeed();
+
+			for(unsigned int i=0, start=0; i<fixtures.size(); start += fixtures[i]->testCount(), ++i) starts.push_back(start);
+
+			for(size_t i=0; i<table.size(); ++i)
+			{
+				selected.push_back(suite.isSelected(table[i].fixture->testName(table[i].index)));
+				if (selected.back()) ++round_size;
+			}
+
+			until_fail = options.has("until-fail");
+
+			if (options.has("repeat")) limit = uint64_t(std::max(1L, options.getInt("repeat", 1))) * round_size;
+			else if (!until_fail && !options.has("duration")) limit = round_size;
+
+			double seconds = parseDuration(options.get("duration"));
+			if (seconds > 0) deadline = monotonicClock() + uint64_t(seconds * 1e9);
+		}
+
+		/** Runs the tests and reports them, fixture by fixture. */
+		void run()
+		{
+			listener.OnSuiteStart();
+			suite.setupGlobals();
+
+			std::vector<Result> results(table.size());
+
+			if (round_size > 0)
+			{
+				long threads = std::max(1L, getOptions().getInt("repeat-threads", processorCount()));
+				std::vector<Worker *> workers;
+
+				for(long i=1; i<threads; ++i)
+				{
+					Worker *w = new Worker(*this);
+					if (w->start()) workers.push_back(w);
+					else delete w;
+				}
+
+				work(results);
+
+				for(size_t i=0; i<workers.size(); ++i)
+				{
+					workers[i]->join();
+
+					for(size_t j=0; j<results.size(); ++j) results[j].add(workers[i]->results[j]);
+					delete workers[i];
+				}
+			}
+
+			for(size_t i=0; i<table.size(); )
+			{
+				Fixture *f = table[i].fixture;
+				size_t end = i;
+				bool any = false;
+
+				for(; end<table.size() && table[end].fixture == f; ++end) any = any || selected[end];
+				if (!any)
+				{
+					i = end;
+					continue;
+				}
+
+				listener.OnFixtureStart(f->Name());
+				for(; i<end; ++i) if (selected[i]) report(table[i], results[i]);
+				listener.OnFixtureDone();
+			}
+
+			suite.teardownGlobals();
+			listener.OnSuiteDone();
+		}
+	};
+}
+
+#endif
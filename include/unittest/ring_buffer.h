@@ -0,0 +1,86 @@
+#ifndef __TEST_RING_BUFFER_H__
+#define __TEST_RING_BUFFER_H__
+
+#include <vector>
+#include <sched.h>
+
+namespace unittest
+{
+	/** @brief A bounded lock-free queue for one producer and one consumer.
+	 *
+	 *  The producer only writes head and the consumer only writes tail, so no
+	 * locks are needed; memory barriers order the slot writes against the index
+	 * updates.  Several threads may produce as long as they are serialized by
+	 * something else (for example the suite running one fixture at a time). */
+	template<class T>
+	class RingBuffer
+	{
+		/** The slots.  The size is a power of two. */
+		std::vector<T> slots;
+
+		/** slots.size()-1, used to wrap indices. */
+		size_t mask;
+
+		/** The number of items ever pushed.  Written by the producer. */
+		volatile size_t head;
+
+		/** The number of items ever popped.  Written by the consumer. */
+		volatile size_t tail;
+
+	public:
+		/** Creates a queue that holds at least capacity items. */
+		RingBuffer(size_t capacity):head(0), tail(0)
+		{
+			size_t size = 2;
+			while (size < capacity) size <<= 1;
+
+			slots.resize(size);
+			mask = size-1;
+		}
+
+		/** Adds an item.  Returns false if the queue is full.  Producer only. */
+		bool push(const T &item)
+		{
+			size_t h = head;
+			if (h - tail > mask) return false;
+
+			slots[h & mask] = item;
+			__sync_synchronize();
+			head = h+1;
+			return true;
+		}
+
+		/** Adds an item, yielding until there is room.  Gives up and returns
+		 * false if abandon becomes true while waiting.  Producer only. */
+		bool pushWait(const T &item, volatile bool &abandon)
+		{
+			while (!push(item))
+			{
+				if (abandon) return false;
+				sched_yield();
+			}
+
+			return true;
+		}
+
+		/** Removes an item into item.  Returns false if the queue is empty.
+		 * Consumer only. */
+		bool pop(T &item)
+		{
+			size_t t = tail;
+			if (t == head) return false;
+
+			__sync_synchronize();
+			item = slots[t & mask];
+			slots[t & mask] = T();
+			__sync_synchronize();
+			tail = t+1;
+			return true;
+		}
+
+		/** Returns true if there is nothing to pop. */
+		bool empty() const { return tail == head; }
+	};
+}
+
+#endif
@@ -0,0 +1,469 @@
+#ifndef __TEST_ROWS_H__
+#define __TEST_ROWS_H__
+
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <exception>
+#include <unistd.h>
+#include "listener.h"
+#include "options.h"
+#include "threads.h"
+#include "mapped_file.h"
+#include "trace.h"
+
+namespace unittest
+{
+	/** @brief One line of a CSV file.
+	 *
+	 *  Nothing is parsed until a field is asked for.  Fields are separated by
+	 * commas; quoting is not supported. */
+	class CsvRow
+	{
+		const char *begin, *end;
+
+	public:
+		CsvRow():begin(NULL), end(NULL) {}
+		CsvRow(const char *_begin, const char *_end):begin(_begin), end(_end) {}
+
+		/** Returns the number of fields. */
+		size_t size() const
+		{
+			size_t count = 1;
+
+			for(const char *pos=begin; pos!=end; ++pos)
+				if (*pos == ',') ++count;
+
+			return count;
+		}
+
+		/** Returns a field, or an empty string if there is no such field. */
+		std::string get(size_t field) const
+		{
+			const char *pos = begin;
+
+			for(; field > 0 && pos != end; ++pos)
+				if (*pos == ',') --field;
+
+			if (field > 0) return "";
+
+			const char *stop = static_cast<const char *>(std::memchr(pos, ',', end-pos));
+			if (stop == NULL) stop = end;
+
+			return std::string(pos, stop);
+		}
+
+		/** Returns a field as an integer. */
+		long getInt(size_t field) const { return std::strtol(get(field).c_str(), NULL, 0); }
+
+		/** Returns a field as a floating point number. */
+		double getDouble(size_t field) const { return std::strtod(get(field).c_str(), NULL); }
+
+		/** Returns the whole line. */
+		std::string line() const { return std::string(begin, end); }
+	};
+
+	/** @brief The rows of a CSV file, for UT_TEST_P.
+	 *
+	 *  The file is mapped, not read.  Opening it only finds where every
+	 * 1024th row starts, so any row can be reached quickly; the fields are
+	 * parsed when the test asks for them.  Blank lines and lines starting
+	 * with '#' are skipped, and so is the first row if it is a header. */
+	class CsvRows
+	{
+		/** Every index_step rows the start of the row is remembered. */
+		static const size_t index_step = 1024;
+
+		MappedFile file;
+		std::vector<size_t> index;
+		size_t rows;
+
+		/** Returns the end of the line starting at pos, without any '\r'. */
+		static const char *lineEnd(const char *pos, const char *end, const char *&next)
+		{
+			const char *stop = static_cast<const char *>(std::memchr(pos, '\n', end-pos));
+
+			if (stop == NULL) next = stop = end;
+			else next = stop+1;
+
+			if (stop != pos && stop[-1] == '\r') --stop;
+			return stop;
+		}
+
+		/** Returns true if a line holds a row. */
+		static bool isRow(const char *pos, const char *stop) { return pos != stop && *pos != '#'; }
+
+	public:
+		typedef CsvRow row_type;
+
+		/** Visits the rows from some row on. */
+		class Cursor
+		{
+			const char *pos, *end;
+
+		public:
+			Cursor(const CsvRows &source, size_t first):pos(NULL), end(NULL)
+			{
+				if (first >= source.rows) return;
+
+				pos = source.file.data() + source.index[first / index_step];
+				end = source.file.data() + source.file.size();
+
+				CsvRow skipped;
+				for(size_t i=first % index_step; i>0; --i) next(skipped);
+			}
+
+			/** Moves to the next row.  Returns false after the last one. */
+			bool next(CsvRow &row)
+			{
+				while (pos != end)
+				{
+					const char *line = pos;
+					const char *stop = lineEnd(line, end, pos);
+
+					if (isRow(line, stop))
+					{
+						row = CsvRow(line, stop);
+						return true;
+					}
+				}
+
+				return false;
+			}
+		};
+
+		CsvRows(const std::string &path, bool header = false):file(path), rows(0)
+		{
+			const char *start = file.data(), *pos = start, *end = start + file.size();
+
+			while (pos != end)
+			{
+				const char *line = pos;
+				const char *stop = lineEnd(line, end, pos);
+
+				if (!isRow(line, stop)) continue;
+
+				if (header)
+				{
+					header = false;
+					continue;
+				}
+
+				if (rows % index_step == 0) index.push_back(line - start);
+				++rows;
+			}
+		}
+
+		/** Returns why the rows could not be read, or an empty string. */
+		const std::string& error() const { return file.error(); }
+
+		/** Returns the number of rows. */
+		size_t size() const { return rows; }
+	};
+
+	/** @brief The rows of a file of fixed size binary records, for UT_TEST_P.
+	 *
+	 *  T must be a plain struct, written to the file as it is laid out in
+	 * memory.  The file is mapped, and each record copied out as it is
+	 * visited. */
+	template<class T>
+	class BinaryRows
+	{
+		MappedFile file;
+		std::string problem;
+
+	public:
+		typedef T row_type;
+
+		class Cursor
+		{
+			const char *pos, *end;
+
+		public:
+			Cursor(const BinaryRows &source, size_t first):
+				pos(source.file.data() + first*sizeof(T)), end(source.file.data() + source.size()*sizeof(T))
+			{
+				if (first >= source.size()) pos = end;
+			}
+
+			bool next(T &row)
+			{
+				if (pos == end) return false;
+
+				std::memcpy(&row, pos, sizeof(T));
+				pos += sizeof(T);
+				return true;
+			}
+		};
+
+		BinaryRows(const std::string &path):file(path)
+		{
+			problem = file.error();
+
+			if (problem.empty() && file.size() % sizeof(T) != 0)
+			{
+				std::ostringstream tmp;
+				tmp << "'" << path << "' is not a whole number of " << sizeof(T) << " byte records";
+				problem = tmp.str();
+			}
+		}
+
+		const std::string& error() const { return problem; }
+
+		size_t size() const { return problem.empty() ? file.size() / sizeof(T) : 0; }
+	};
+
+	/** @brief The rows of an array in the test source, for UT_TEST_P.
+	 *
+	 *  Usually made with table(). */
+	template<class T>
+	class TableRows
+	{
+		const T *rows;
+		size_t count;
+		std::string problem;
+
+	public:
+		typedef T row_type;
+
+		class Cursor
+		{
+			const T *pos, *end;
+
+		public:
+			Cursor(const TableRows &source, size_t first):
+				pos(source.rows + (first < source.count ? first : source.count)), end(source.rows + source.count) {}
+
+			bool next(T &row)
+			{
+				if (pos == end) return false;
+
+				row = *pos++;
+				return true;
+			}
+		};
+
+		TableRows(const T *_rows, size_t _count):rows(_rows), count(_count) {}
+
+		const std::string& error() const { return problem; }
+
+		size_t size() const { return count; }
+	};
+
+	/** Returns the rows of an array. */
+	template<class T, size_t N>
+	TableRows<T> table(const T (&rows)[N]) { return TableRows<T>(rows, N); }
+
+	/** @brief Reports the events of one row as a test of its own.
+	 *
+	 *  The row number is added to the test name, and to the message of
+	 * failures.  When rows run in parallel the events are kept until the
+	 * rows before them have been reported. */
+	class RowListener : public Listener
+	{
+		Listener &target;
+		bool buffered;
+		std::string suffix, prefix;
+		std::vector<Event> events;
+
+	public:
+		RowListener(Listener &_target, bool _buffered):target(_target), buffered(_buffered) {}
+
+		/** Starts a new row. */
+		void setRow(size_t row)
+		{
+			std::ostringstream tmp;
+			tmp << row;
+
+			suffix = "[" + tmp.str() + "]";
+			prefix = "row " + tmp.str() + ": ";
+		}
+
+		virtual void OnEvent(Event &e)
+		{
+			Event row_event = e;
+
+			row_event.filename += suffix;
+			if (!row_event.pass) row_event.msg = prefix + row_event.msg;
+
+			if (buffered) events.push_back(row_event);
+			else target.OnEvent(row_event);
+		}
+
+		/** Returns the events kept so far. */
+		std::vector<Event>& kept() { return events; }
+	};
+
+	/** Runs one row.  An exception that escapes the row fails it. */
+	template<class F, class Row>
+	void runRow(F &fixture, void (F::*body)(Listener *, const Row &, size_t), RowListener &rows,
+	            const Row &row, size_t row_num, const Event &test)
+	{
+		rows.setRow(row_num);
+
+		try
+		{
+			(fixture.*body)(&rows, row, row_num);
+		}
+		catch(std::exception &ex)
+		{
+			Event e = test;
+			e.msg = std::string("Standard Exception: ") + ex.what();
+			rows.OnEvent(e);
+		}
+		catch(...)
+		{
+			Event e = test;
+			e.msg = "Unknown exception.";
+			rows.OnEvent(e);
+		}
+	}
+
+	/** Runs UT_TEST_P rows from several threads, reporting them in order. */
+	template<class F, class S>
+	class ParallelRows
+	{
+	public:
+		typedef void (F::*row_fn)(Listener *, const typename S::row_type &, size_t);
+
+	private:
+		/** The number of rows a thread takes at a time. */
+		static const size_t chunk_rows = 4096;
+
+		class Worker : public Thread
+		{
+			ParallelRows &p;
+
+		public:
+			Worker(ParallelRows &_p):p(_p) {}
+
+		protected:
+			virtual void run() { p.work(); }
+		};
+
+		F &fixture;
+		row_fn body;
+		const S &source;
+		Listener &target;
+		const Event &test;
+
+		/** The next chunk to hand out. */
+		volatile size_t next_chunk;
+
+		/** Finished chunks waiting for the ones before them. */
+		Mutex lock;
+		std::map<size_t, std::vector<Event> > finished;
+		size_t next_report;
+
+		/** Hands over the events of a chunk, and reports every chunk whose
+		 * turn has come. */
+		void done(size_t chunk, std::vector<Event> &events)
+		{
+			ScopedLock l(lock);
+
+			finished[chunk].swap(events);
+
+			std::map<size_t, std::vector<Event> >::iterator pos;
+			while ((pos = finished.find(next_report)) != finished.end())
+			{
+				for(size_t i=0; i<pos->second.size(); ++i) target.OnEvent(pos->second[i]);
+
+				finished.erase(pos);
+				++next_report;
+			}
+		}
+
+	public:
+		ParallelRows(F &_fixture, row_fn _body, const S &_source, Listener &_target, const Event &_test):
+			fixture(_fixture), body(_body), source(_source), target(_target), test(_test), next_chunk(0), next_report(0) {}
+
+		/** Runs chunks until there are none left.  Called by every thread. */
+		void work()
+		{
+			RowListener rows(target, true);
+			typename S::row_type row;
+
+			for(;;)
+			{
+				size_t chunk = __sync_fetch_and_add(&next_chunk, 1);
+				size_t first = chunk * chunk_rows;
+
+				if (first >= source.size()) break;
+
+				std::ostringstream span;
+				span << "rows " << first << "-" << std::min(first + chunk_rows, source.size()) - 1;
+				TraceSpan trace(span.str(), "rows");
+
+				typename S::Cursor cursor(source, first);
+
+				for(size_t i=first; i<first+chunk_rows && cursor.next(row); ++i)
+					runRow(fixture, body, rows, row, i, test);
+
+				done(chunk, rows.kept());
+				rows.kept().clear();
+			}
+		}
+
+		/** Runs all the rows on the given number of threads, this one included. */
+		void run(long threads)
+		{
+			std::vector<Worker *> workers;
+
+			for(long i=1; i<threads && size_t(i)*chunk_rows < source.size(); ++i)
+			{
+				Worker *w = new Worker(*this);
+
+				if (w->start()) workers.push_back(w);
+				else delete w;
+			}
+
+			work();
+
+			for(size_t i=0; i<workers.size(); ++i)
+			{
+				workers[i]->join();
+				delete workers[i];
+			}
+		}
+	};
+
+	/** @brief Runs the body of a UT_TEST_P once for every row of a source.
+	 *
+	 *  A source has a row_type, a Cursor that visits rows from any row on,
+	 * size() and error().  test describes the test itself, and is reported
+	 * failed if the source can not be read.  If parallel is true the rows
+	 * are spread over --row-threads threads, by default one per processor. */
+	template<class F, class S>
+	void runRows(F &fixture, void (F::*body)(Listener *, const typename S::row_type &, size_t),
+	             const S &source, Listener *listener, bool parallel, Event &test)
+	{
+		if (!source.error().empty())
+		{
+			test.pass = false;
+			test.msg = source.error();
+			listener->OnEvent(test);
+			return;
+		}
+
+		long threads = parallel ? getOptions().getInt("row-threads", processorCount()) : 1;
+
+		if (threads > 1)
+		{
+			ParallelRows<F, S> p(fixture, body, source, *listener, test);
+			p.run(threads);
+			return;
+		}
+
+		RowListener rows(*listener, false);
+		typename S::Cursor cursor(source, 0);
+		typename S::row_type row;
+
+		for(size_t i=0; cursor.next(row); ++i) runRow(fixture, body, rows, row, i, test);
+	}
+}
+
+#endif
@@ -1,60 +1,336 @@
 #ifndef __TEST_SUITE_H__
 #define __TEST_SUITE_H__
 
+#include <set>
 #include <vector>
+#include <string>
+#include <ostream>
 #include "fixture.h"
+#include "global.h"
+#include "random.h"
 
 namespace unittest
-{	
-	/** Collects all fixtures and runs all tests in each fixture. */
+{
+	/** @brief Collects all fixtures and runs all tests in each fixture.
+	 *
+	 *  Fixtures are usually registered as entries of the fixture table and
+	 * only made when they are about to run, so listing the tests, or running
+	 * one of them, makes no other fixture. */
 	class Suite
 	{
 		/** The listener for this suite. */
 		Listener &listener;
-		
+
+		/** A registered fixture: its entry, its instance once made, or both. */
+		struct Registered
+		{
+			const FixtureEntry *entry;
+			Fixture *fixture;
+		};
+
 		/** The type of container for fixtures. */
-		typedef std::vector<Fixture *> fixture_list;
-		
+		typedef std::vector<Registered> fixture_list;
+
 		/** The list of all fixtures. */
 		fixture_list fixtures;
-		
+
+		/** Every fixture, made, for getFixtures(). */
+		std::vector<Fixture *> made;
+
+		/** The type of container for globals. */
+		typedef std::vector<Global *> global_list;
+
+		/** The list of all globals. */
+		global_list globals;
+
+		/** If true, every fixture runs each test on a fresh instance. */
+		bool fresh_fixtures;
+
+		/** If true, fixtures and their tests run in an order shuffled from seed. */
+		bool shuffled;
+		uint64_t seed;
+
+		/** The fixtures and tests to run, as "Fixture" or "Fixture::test", or empty
+		 * to run them all. */
+		std::vector<std::string> selection;
+
+		/** The fixtures not to run, such as those a resumed run has already run. */
+		std::set<std::string> skipped;
+
+		/** Returns fixture i, making it the first time. */
+		Fixture *fixture(size_t i)
+		{
+			Registered &r = fixtures[i];
+			if (r.fixture == NULL) r.fixture = r.entry->create();
+			return r.fixture;
+		}
+
+		/** Returns the tests of fixture i that are selected, shuffled if the
+		 * suite is, from test_seed. */
+		std::vector<unsigned int> selectedTests(size_t i, uint64_t test_seed)
+		{
+			std::vector<unsigned int> all;
+			if (shuffled) all = shuffledOrder(testCount(i), test_seed);
+			else for(unsigned int j=0; j<testCount(i); ++j) all.push_back(j);
+
+			std::vector<unsigned int> tests;
+			for(size_t j=0; j<all.size(); ++j)
+				if (isSelected(testName(i, all[j]))) tests.push_back(all[j]);
+
+			return tests;
+		}
+
 	public:
 		/** Constructs a suite, requires a listener. */
-		Suite(Listener &l):listener(l) {}
-		
-		~Suite() {}
-		
-		/** Run all tests from all fixtures. */
+		Suite(Listener &l):listener(l), fresh_fixtures(false), shuffled(false), seed(0) {}
+
+		/** Deletes the fixtures made from the fixture table. */
+		~Suite()
+		{
+			for(size_t i=0; i<fixtures.size(); ++i)
+				if (fixtures[i].entry != NULL) delete fixtures[i].fixture;
+		}
+
+		/** Sets up every global.  They are built once and shared by all fixtures. */
+		void setupGlobals()
+		{
+			for(global_list::iterator pos = globals.begin(); pos!=globals.end(); ++pos)
+				(*pos)->setup();
+		}
+
+		/** Tears down every global, in reverse order. */
+		void teardownGlobals()
+		{
+			for(global_list::reverse_iterator pos = globals.rbegin(); pos!=globals.rend(); ++pos)
+				(*pos)->teardown();
+		}
+
+		/** Run all selected tests from all fixtures. */
 		void runTests()
-		{			
+		{
 			listener.OnSuiteStart();
-						
-			for(fixture_list::iterator pos = fixtures.begin(); pos!=fixtures.end(); ++pos)
+			setupGlobals();
+
+			runFixtures();
+
+			teardownGlobals();
+			listener.OnSuiteDone();
+		}
+
+		/** Runs the selected tests of every fixture, without starting the
+		 * suite or setting up the globals, so a caller that keeps them set up
+		 * can run the fixtures again and again. */
+		void runFixtures()
+		{
+			std::vector<size_t> order;
+			std::vector<uint64_t> test_seeds;
+			runOrder(order, test_seeds);
+
+			for(size_t i=0; i<order.size(); ++i)
 			{
-				Fixture *f = *pos;
-				
-				listener.OnFixtureStart(f->Name());
-				
-				f->setListener(&listener);
-				f->runTests();
-				
-				listener.OnFixtureDone();
-			}		
-			
-			listener.OnSuiteDone();				
-		}		
-		
+				if (!skipped.empty() && skipped.count(fixtureName(order[i]))) continue;
+
+				runFixture(order[i], test_seeds[i]);
+			}
+		}
+
+		/** Returns every fixture in the order runFixtures() runs them, and
+		 * the seed the tests of each are shuffled from, or 0 if the suite is
+		 * not shuffled.  Seeds are drawn for skipped fixtures too, so a
+		 * resumed run keeps the order of the first. */
+		void runOrder(std::vector<size_t> &order, std::vector<uint64_t> &test_seeds)
+		{
+			order.clear();
+			for(size_t i=0; i<fixtures.size(); ++i) order.push_back(i);
+
+			XorShift rng(seed);
+			if (shuffled) shuffle(order, rng);
+
+			test_seeds.clear();
+			for(size_t i=0; i<order.size(); ++i) test_seeds.push_back(shuffled ? rng.next() : 0);
+		}
+
+		/** Runs the selected tests of fixture i, shuffled from test_seed if
+		 * the suite is.  Nothing runs if none of them is selected. */
+		void runFixture(size_t i, uint64_t test_seed = 0)
+		{
+			std::vector<unsigned int> tests = selectedTests(i, test_seed);
+			if (tests.empty() && !selection.empty()) return;
+
+			Fixture *f = fixture(i);
+
+			listener.OnFixtureStart(f->Name());
+
+			if (fresh_fixtures) f->setFresh(true);
+			f->setOrder(tests);
+
+			f->setListener(&listener);
+			f->runTests();
+
+			listener.OnFixtureDone();
+		}
+
+		/** Returns true if runFixtures() would run fixture i: it is not
+		 * skipped, and some of its tests are selected. */
+		bool willRun(size_t i)
+		{
+			if (!skipped.empty() && skipped.count(fixtureName(i))) return false;
+			if (selection.empty()) return true;
+
+			for(unsigned int j=0; j<testCount(i); ++j)
+				if (isSelected(testName(i, j))) return true;
+
+			return false;
+		}
+
 		/** Register a fixture to be run. */
 		void registerFixture(Fixture *f)
 		{
-			fixtures.push_back(f);	
+			Registered r = { NULL, f };
+			fixtures.push_back(r);
+		}
+
+		/** Register an entry of the fixture table, to be made when it runs. */
+		void registerFixture(const FixtureEntry &e)
+		{
+			Registered r = { &e, NULL };
+			fixtures.push_back(r);
+		}
+
+		/** Register a global to be shared by all fixtures. */
+		void registerGlobal(Global *g)
+		{
+			globals.push_back(g);
+		}
+
+		/** Returns the number of fixtures. */
+		size_t fixtureCount() const { return fixtures.size(); }
+
+		/** Returns the name of fixture i, without making it. */
+		std::string fixtureName(size_t i)
+		{
+			const Registered &r = fixtures[i];
+			return r.entry ? std::string(r.entry->name) : r.fixture->Name();
+		}
+
+		/** Returns the number of tests of fixture i, without making it. */
+		unsigned int testCount(size_t i)
+		{
+			const Registered &r = fixtures[i];
+			return r.entry ? r.entry->count() : r.fixture->testCount();
+		}
+
+		/** Returns the name of test j of fixture i, as "Fixture::test", without
+		 * making the fixture. */
+		std::string testName(size_t i, unsigned int j)
+		{
+			const Registered &r = fixtures[i];
+			return r.entry ? std::string(r.entry->name) + "::" + r.entry->test(j) : std::string(r.fixture->testName(j));
+		}
+
+		/** Returns every fixture, making those not made yet. */
+		const std::vector<Fixture *>& getFixtures()
+		{
+			made.clear();
+			for(size_t i=0; i<fixtures.size(); ++i) made.push_back(fixture(i));
+			return made;
+		}
+
+		/** Returns the listener of the suite. */
+		Listener& getListener() { return listener; }
+
+		/** Makes every fixture run each test on a fresh instance. */
+		void setFreshFixtures(bool fresh)
+		{
+			fresh_fixtures = fresh;
+		}
+
+		/** Runs the fixtures, and the tests of each, in an order shuffled from
+		 * _seed.  The same seed gives the same order. */
+		void setShuffle(uint64_t _seed)
+		{
+			shuffled = true;
+			seed = _seed;
+		}
+
+		/** Returns true if the suite is shuffled, from seed(). */
+		bool isShuffled() const { return shuffled; }
+		uint64_t shuffleSeed() const { return seed; }
+
+		/** Runs only some of the tests, given as a comma separated list of
+		 * "Fixture" or "Fixture::test".  An empty list runs them all. */
+		void select(const std::string &names)
+		{
+			selection.clear();
+
+			for(size_t start = 0; start < names.size(); )
+			{
+				size_t end = names.find(',', start);
+				if (end == std::string::npos) end = names.size();
+
+				if (end > start) selection.push_back(names.substr(start, end - start));
+				start = end + 1;
+			}
+		}
+
+		/** Returns the tests to run, as select() takes them, however they
+		 * were chosen. */
+		std::string selected() const
+		{
+			std::string names;
+
+			for(size_t i=0; i<selection.size(); ++i)
+			{
+				if (i > 0) names += ",";
+				names += selection[i];
+			}
+
+			return names;
+		}
+
+		/** Does not run the fixture, even if it is selected. */
+		void skip(const std::string &fixture)
+		{
+			skipped.insert(fixture);
+		}
+
+		/** Returns true if the test, "Fixture::test", is selected. */
+		bool isSelected(const std::string &test) const
+		{
+			if (selection.empty()) return true;
+
+			for(size_t i=0; i<selection.size(); ++i)
+			{
+				const std::string &s = selection[i];
+
+				if (test == s) return true;
+				if (test.size() > s.size() + 2 && test.compare(0, s.size(), s) == 0 && test.compare(s.size(), 2, "::") == 0) return true;
+			}
+
+			return false;
+		}
+
+		/** Writes the selected tests, one "Fixture::test" to a line, without
+		 * making any fixture. */
+		void list(std::ostream &out)
+		{
+			for(size_t i=0; i<fixtures.size(); ++i)
+			{
+				for(unsigned int j=0; j<testCount(i); ++j)
+				{
+					std::string name = testName(i, j);
+					if (isSelected(name)) out << name << "\n";
+				}
+			}
+
+			out.flush();
 		}
 	};
-	
-	
+
+
 	/** Returns the global suite. */
 	extern Suite& getSuite();
-	
+
 }
 
 #endif
@@ -0,0 +1,274 @@
+#ifndef __TEST_SUMMARY_H__
+#define __TEST_SUMMARY_H__
+
+#include <map>
+#include <new>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include "config.h"
+#include "threads.h"
+
+namespace unittest
+{
+	struct Summary
+	{
+		Summary():failures(0), passes(0), event_count(0) {}
+
+		/** The number of failing events. */
+		uint64_t failures;
+
+		/** The number of passing events. */
+		uint64_t passes;
+
+		/** The total number of events. */
+		uint64_t event_count;
+
+		Summary& operator+=(const Summary &other)
+		{
+			failures += other.failures;
+			passes += other.passes;
+			event_count += other.event_count;
+			return *this;
+		}
+	};
+
+	/** The number of threads that get a slot of their own. */
+	static const unsigned summary_slots = 64;
+
+	/** The size of a cache line, which slots are aligned to. */
+	static const size_t cache_line = 64;
+
+	/** @brief Gives each running thread a small number, below summary_slots
+	 * if it can.
+	 *
+	 *  A number is handed back when its thread exits, so threads that come
+	 * and go, such as the workers of parallel rows, reuse the same few. */
+	class ThreadSlots
+	{
+		Mutex lock;
+		std::vector<unsigned> free;
+		unsigned next;
+
+		static ThreadSlots& get()
+		{
+			static ThreadSlots slots;
+			return slots;
+		}
+
+		static void release(void *slot)
+		{
+			ThreadSlots &slots = get();
+			ScopedLock l(slots.lock);
+			slots.free.push_back(static_cast<unsigned>(reinterpret_cast<size_t>(slot)) - 1);
+		}
+
+		/** Holds each thread's number plus one, to hand it back. */
+		ThreadKey<release> key;
+
+		ThreadSlots():next(0) {}
+
+		unsigned take()
+		{
+			unsigned slot;
+
+			{
+				ScopedLock l(lock);
+
+				if (free.empty()) slot = next++;
+				else
+				{
+					slot = free.back();
+					free.pop_back();
+				}
+			}
+
+			key.set(reinterpret_cast<void *>(size_t(slot) + 1));
+			return slot;
+		}
+
+	public:
+		/** Returns the number of this thread. */
+		static unsigned current()
+		{
+			static __thread unsigned slot = 0;
+			if (slot == 0) slot = get().take() + 1;
+			return slot - 1;
+		}
+	};
+
+	/** @brief Counts events for a listener, from any number of threads.
+	 *
+	 *  Each thread counts in a slot of its own, on its own cache lines, so
+	 * threads never wait for or slow down each other; the counts are only
+	 * added up when they are asked for.  Past summary_slots threads at once,
+	 * the rest share one slot under a lock.  Each slot also counts per test,
+	 * looking the test up only when it changes.  The per test counts may
+	 * only be read once the threads have stopped counting. */
+	class SummaryCounters
+	{
+		struct Slot
+		{
+			Summary total;
+
+			/** The counts of each test, as "Fixture::test". */
+			std::map<std::string, Summary> tests;
+
+			/** The test last counted. */
+			std::string last_name;
+			Summary *last;
+
+			Slot():last(NULL) {}
+		};
+
+		/** The slot of each thread, made by the thread when it first counts. */
+		Slot *volatile slots[summary_slots + 1];
+
+		/** Guards the shared slot. */
+		Mutex shared;
+
+		SummaryCounters(const SummaryCounters &);
+		SummaryCounters& operator=(const SummaryCounters &);
+
+		/** Makes a slot that starts on a cache line and is padded to one,
+		 * so no other slot shares its lines. */
+		static Slot *makeSlot()
+		{
+			const size_t size = (sizeof(Slot) + cache_line - 1) / cache_line * cache_line;
+
+			return new(alignedAlloc(size, cache_line)) Slot;
+		}
+
+		Slot &slot(unsigned index)
+		{
+			Slot *s = slots[index];
+			if (s != NULL) return *s;
+
+			s = makeSlot();
+			if (!__sync_bool_compare_and_swap(&slots[index], NULL, s))
+			{
+				s->~Slot();
+				alignedFree(s);
+			}
+
+			return *slots[index];
+		}
+
+		/** Finds the "Fixture::test" part of an event's filename, which
+		 * looks like "source::Fixture::test[row]". */
+		static void testName(const std::string &filename, size_t &start, size_t &size)
+		{
+			size_t end = filename.size();
+			if (end > 0 && filename[end-1] == ']')
+			{
+				size_t bracket = filename.rfind('[');
+				if (bracket != std::string::npos) end = bracket;
+			}
+
+			size_t last = end > 0 ? filename.rfind("::", end-1) : std::string::npos;
+			size_t first = last != std::string::npos && last > 0 ? filename.rfind("::", last-1) : std::string::npos;
+
+			start = first == std::string::npos ? 0 : first + 2;
+			size = end - start;
+		}
+
+		static void count(Slot &s, bool pass, const std::string &filename)
+		{
+			size_t start, size;
+			testName(filename, start, size);
+
+			if (s.last == NULL || s.last_name.compare(0, std::string::npos, filename, start, size) != 0)
+			{
+				s.last_name.assign(filename, start, size);
+				s.last = &s.tests[s.last_name];
+			}
+
+			if (pass)
+			{
+				++s.total.passes;
+				++s.last->passes;
+			}
+			else
+			{
+				++s.total.failures;
+				++s.last->failures;
+			}
+
+			++s.total.event_count;
+			++s.last->event_count;
+		}
+
+	public:
+		SummaryCounters()
+		{
+			for(unsigned i=0; i<=summary_slots; ++i) slots[i] = NULL;
+		}
+
+		~SummaryCounters()
+		{
+			for(unsigned i=0; i<=summary_slots; ++i)
+			{
+				if (slots[i] == NULL) continue;
+
+				slots[i]->~Slot();
+				alignedFree(slots[i]);
+			}
+		}
+
+		/** Counts one event, from its filename. */
+		void add(bool pass, const std::string &filename)
+		{
+			unsigned index = ThreadSlots::current();
+
+			if (index < summary_slots)
+			{
+				count(slot(index), pass, filename);
+				return;
+			}
+
+			ScopedLock l(shared);
+			count(slot(summary_slots), pass, filename);
+		}
+
+		/** Adds up every thread's counts. */
+		Summary total() const
+		{
+			Summary result;
+
+			for(unsigned i=0; i<=summary_slots; ++i)
+				if (slots[i] != NULL) result += slots[i]->total;
+
+			return result;
+		}
+
+		/** Returns the counts of each test, by "Fixture::test". */
+		std::map<std::string, Summary> byTest() const
+		{
+			std::map<std::string, Summary> result;
+
+			for(unsigned i=0; i<=summary_slots; ++i)
+			{
+				if (slots[i] == NULL) continue;
+
+				const std::map<std::string, Summary> &tests = slots[i]->tests;
+				for(std::map<std::string, Summary>::const_iterator pos=tests.begin(); pos!=tests.end(); ++pos)
+					result[pos->first] += pos->second;
+			}
+
+			return result;
+		}
+
+		/** Returns the counts of each fixture. */
+		std::map<std::string, Summary> byFixture() const
+		{
+			std::map<std::string, Summary> tests = byTest(), result;
+
+			for(std::map<std::string, Summary>::const_iterator pos=tests.begin(); pos!=tests.end(); ++pos)
+				result[pos->first.substr(0, pos->first.find("::"))] += pos->second;
+
+			return result;
+		}
+	};
+}
+
+#endif
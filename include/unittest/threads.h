@@ -0,0 +1,192 @@
+#ifndef __TEST_THREADS_H__
+#define __TEST_THREADS_H__
+
+#include <pthread.h>
+#include <time.h>
+#include <cstdlib>
+#include <new>
+#include "config.h"
+
+/* Threads, mutexes and conditions are pthreads everywhere; MinGW builds
+ * link winpthreads.  What winpthreads lacks is below, with a Win32 branch. */
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace unittest
+{
+	/** Allocates size bytes starting on a multiple of alignment, a power of
+	 * two.  Throws std::bad_alloc if it cannot.  Free it with alignedFree(). */
+	inline void *alignedAlloc(size_t size, size_t alignment)
+	{
+#ifdef _WIN32
+		void *memory = _aligned_malloc(size, alignment);
+		if (memory == NULL) throw std::bad_alloc();
+#else
+		void *memory;
+		if (posix_memalign(&memory, alignment, size) != 0) throw std::bad_alloc();
+#endif
+		return memory;
+	}
+
+	/** Frees memory from alignedAlloc(). */
+	inline void alignedFree(void *memory)
+	{
+#ifdef _WIN32
+		_aligned_free(memory);
+#else
+		std::free(memory);
+#endif
+	}
+
+	/** Returns the number of processors online, for sizing thread pools. */
+	inline long processorCount()
+	{
+#ifdef _WIN32
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return long(info.dwNumberOfProcessors);
+#else
+		return sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	}
+
+	/** @brief A value of each thread, handed to Destroy when the thread
+	 * exits, if it is not NULL. */
+	template<void (*Destroy)(void *)>
+	class ThreadKey
+	{
+#ifdef _WIN32
+		DWORD key;
+
+		static VOID WINAPI destroy(PVOID value) { if (value != NULL) Destroy(value); }
+#else
+		pthread_key_t key;
+#endif
+
+		ThreadKey(const ThreadKey &);
+		ThreadKey& operator=(const ThreadKey &);
+
+	public:
+#ifdef _WIN32
+		ThreadKey()  { key = FlsAlloc(destroy); }
+		~ThreadKey() { FlsFree(key); }
+
+		void set(void *value) { FlsSetValue(key, value); }
+		void *get() const     { return FlsGetValue(key); }
+#else
+		ThreadKey()  { pthread_key_create(&key, Destroy); }
+		~ThreadKey() { pthread_key_delete(key); }
+
+		void set(void *value) { pthread_setspecific(key, value); }
+		void *get() const     { return pthread_getspecific(key); }
+#endif
+	};
+
+	/** Returns a monotonic clock in nanoseconds. */
+	inline uint64_t monotonicClock()
+	{
+#ifdef _WIN32
+		LARGE_INTEGER now, frequency;
+		QueryPerformanceCounter(&now);
+		QueryPerformanceFrequency(&frequency);
+		return uint64_t(now.QuadPart / frequency.QuadPart) * 1000000000u
+		     + uint64_t(now.QuadPart % frequency.QuadPart) * 1000000000u / frequency.QuadPart;
+#else
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return uint64_t(now.tv_sec) * 1000000000u + now.tv_nsec;
+#endif
+	}
+
+	/** A thin wrapper around a pthread mutex. */
+	class Mutex
+	{
+		pthread_mutex_t m;
+
+		Mutex(const Mutex &);
+		Mutex& operator=(const Mutex &);
+
+	public:
+		Mutex()  { pthread_mutex_init(&m, NULL); }
+		~Mutex() { pthread_mutex_destroy(&m); }
+
+		void lock()   { pthread_mutex_lock(&m); }
+		void unlock() { pthread_mutex_unlock(&m); }
+
+		/** Returns the native handle, used by Condition. */
+		pthread_mutex_t *native() { return &m; }
+	};
+
+	/** Locks a mutex for the lifetime of the object. */
+	class ScopedLock
+	{
+		Mutex &m;
+
+	public:
+		ScopedLock(Mutex &_m):m(_m) { m.lock(); }
+		~ScopedLock() { m.unlock(); }
+	};
+
+	/** A thin wrapper around a pthread condition variable. */
+	class Condition
+	{
+		pthread_cond_t c;
+
+		Condition(const Condition &);
+		Condition& operator=(const Condition &);
+
+	public:
+		Condition()  { pthread_cond_init(&c, NULL); }
+		~Condition() { pthread_cond_destroy(&c); }
+
+		/** Waits on the condition. The mutex must be locked by the caller. */
+		void wait(Mutex &m) { pthread_cond_wait(&c, m.native()); }
+
+		void signal()    { pthread_cond_signal(&c); }
+		void broadcast() { pthread_cond_broadcast(&c); }
+	};
+
+	/** A joinable thread.  Subclasses implement run(). */
+	class Thread
+	{
+		pthread_t handle;
+		bool started;
+
+		static void *entry(void *self)
+		{
+			static_cast<Thread *>(self)->run();
+			return NULL;
+		}
+
+	protected:
+		/** The body of the thread. */
+		virtual void run() = 0;
+
+	public:
+		Thread():started(false) {}
+		virtual ~Thread() {}
+
+		/** Starts the thread.  Returns false if it could not be created. */
+		bool start()
+		{
+			started = (pthread_create(&handle, NULL, &Thread::entry, this) == 0);
+			return started;
+		}
+
+		/** Waits for the thread to finish. */
+		void join()
+		{
+			if (started) pthread_join(handle, NULL);
+			started = false;
+		}
+	};
+}
+
+#endif
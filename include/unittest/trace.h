@@ -0,0 +1,233 @@
+#ifndef __TEST_TRACE_H__
+#define __TEST_TRACE_H__
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <unistd.h>
+#include "config.h"
+#include "threads.h"
+
+namespace unittest
+{
+	/** One entry of a trace, in the phases of the Chrome trace event format:
+	 * 'B' and 'E' begin and end a span, 'X' is a whole span and 'i' an
+	 * instant. */
+	struct TraceRecord
+	{
+		char phase;
+
+		/** Nanoseconds since the trace started, and the length of an 'X'. */
+		uint64_t time, duration;
+
+		std::string name, category;
+
+		/** The members of the args object, already in JSON, or empty. */
+		std::string args;
+	};
+
+	/** The records of one thread.  Only that thread adds to it, so it needs
+	 * no lock; it is read once every thread is done. */
+	struct TraceBuffer
+	{
+		std::vector<TraceRecord> records;
+		int thread;
+		std::string thread_name;
+		TraceBuffer *next;
+	};
+
+	/** @brief Records spans and instants from any thread.
+	 *
+	 *  Each thread records into a TraceBuffer of its own, found through a
+	 * thread key of the tracer's own, and the buffers are kept in a list that
+	 * threads join with a compare and swap.  Recording takes no lock and costs a
+	 * clock read and a record, so it is cheap enough to leave on.  The trace
+	 * is written out with json() after the threads have stopped recording. */
+	class Tracer
+	{
+		/** Every thread's buffer. */
+		TraceBuffer *volatile buffers;
+		volatile int thread_count;
+
+		uint64_t origin;
+		pthread_t main_thread;
+
+		/** The buffers are the tracer's to delete, not the threads'. */
+		static void keep(void *) {}
+
+		/** This thread's buffer, one for each tracer and thread. */
+		ThreadKey<keep> mine;
+
+		Tracer(const Tracer &);
+		Tracer& operator=(const Tracer &);
+
+		/** Returns the buffer of this thread, making it the first time. */
+		TraceBuffer& buffer()
+		{
+			TraceBuffer *b = static_cast<TraceBuffer *>(mine.get());
+			if (b != NULL) return *b;
+
+			b = new TraceBuffer;
+			b->thread = __sync_add_and_fetch(&thread_count, 1);
+
+			if (pthread_equal(pthread_self(), main_thread)) b->thread_name = "main";
+			else
+			{
+				std::ostringstream tmp;
+				tmp << "worker " << b->thread - 1;
+				b->thread_name = tmp.str();
+			}
+
+			do b->next = buffers;
+			while (!__sync_bool_compare_and_swap(&buffers, b->next, b));
+
+			mine.set(b);
+			return *b;
+		}
+
+		void add(char phase, uint64_t time, uint64_t duration, const std::string &name, const char *category, const std::string &args)
+		{
+			std::vector<TraceRecord> &records = buffer().records;
+
+			records.resize(records.size() + 1);
+			TraceRecord &r = records.back();
+
+			r.phase = phase;
+			r.time = time - origin;
+			r.duration = duration;
+			r.name = name;
+			r.category = category;
+			r.args = args;
+		}
+
+		/** Writes microseconds, as the format wants, to the nanosecond. */
+		static void micros(std::ostream &out, uint64_t nanos)
+		{
+			out << nanos / 1000 << '.' << std::setw(3) << std::setfill('0') << nanos % 1000 << std::setfill(' ');
+		}
+
+	public:
+		/** Starts the trace.  The thread that makes it is named "main". */
+		Tracer():buffers(NULL), thread_count(0), origin(monotonicClock()), main_thread(pthread_self()) {}
+
+		~Tracer()
+		{
+			for(TraceBuffer *b = buffers; b != NULL; )
+			{
+				TraceBuffer *next = b->next;
+				delete b;
+				b = next;
+			}
+		}
+
+		/** The tracer that TraceSpan and the test runner record into, if
+		 * tracing is on. */
+		static Tracer *&current()
+		{
+			static Tracer *tracer = NULL;
+			return tracer;
+		}
+
+		/** Returns the time, to pass to complete() later. */
+		uint64_t now() const { return monotonicClock(); }
+
+		void begin(const std::string &name, const char *category) { add('B', now(), 0, name, category, ""); }
+		void end(const std::string &name, const char *category) { add('E', now(), 0, name, category, ""); }
+
+		/** Records a span that has already happened. */
+		void complete(const std::string &name, const char *category, uint64_t start, uint64_t end)
+		{
+			add('X', start, end > start ? end - start : 0, name, category, "");
+		}
+
+		/** Records a moment.  args are the members of the args object, in
+		 * JSON, such as "\"line\": 12". */
+		void instant(const std::string &name, const char *category, const std::string &args)
+		{
+			add('i', now(), 0, name, category, args);
+		}
+
+		/** Escapes text for a JSON string. */
+		static std::string escape(const std::string &text)
+		{
+			std::ostringstream out;
+
+			for(std::string::const_iterator pos=text.begin(); pos!=text.end(); ++pos)
+			{
+				unsigned char c = static_cast<unsigned char>(*pos);
+
+				switch(c)
+				{
+				case '"':  out << "\\\""; break;
+				case '\\': out << "\\\\"; break;
+				case '\n': out << "\\n"; break;
+				case '\t': out << "\\t"; break;
+				default:
+					if (c < 0x20) out << "\\u00" << std::hex << std::setw(2) << std::setfill('0') << int(c) << std::dec << std::setfill(' ');
+					else out << *pos;
+				}
+			}
+
+			return out.str();
+		}
+
+		/** Writes the whole trace as a Chrome trace event JSON object, which
+		 * chrome://tracing and Perfetto open. */
+		void json(std::ostream &out) const
+		{
+			int pid = getpid();
+			bool first = true;
+
+			out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [" << std::endl;
+
+			for(TraceBuffer *b = buffers; b != NULL; b = b->next)
+			{
+				out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid << ", \"tid\": " << b->thread
+				    << ", \"args\": {\"name\": \"" << escape(b->thread_name) << "\"}}";
+				first = false;
+
+				for(std::vector<TraceRecord>::const_iterator r = b->records.begin(); r != b->records.end(); ++r)
+				{
+					out << ",\n{\"name\": \"" << escape(r->name) << "\", \"cat\": \"" << r->category << "\", \"ph\": \"" << r->phase
+					    << "\", \"pid\": " << pid << ", \"tid\": " << b->thread << ", \"ts\": ";
+					micros(out, r->time);
+
+					if (r->phase == 'X')
+					{
+						out << ", \"dur\": ";
+						micros(out, r->duration);
+					}
+
+					if (r->phase == 'i') out << ", \"s\": \"t\"";
+					if (!r->args.empty()) out << ", \"args\": {" << r->args << "}";
+
+					out << "}";
+				}
+			}
+
+			out << std::endl << "]}" << std::endl;
+		}
+	};
+
+	/** Records a span around a scope, if tracing is on. */
+	class TraceSpan
+	{
+		Tracer *tracer;
+		std::string name;
+		const char *category;
+
+	public:
+		TraceSpan(const std::string &_name, const char *_category):tracer(Tracer::current()), category(_category)
+		{
+			if (tracer == NULL) return;
+
+			name = _name;
+			tracer->begin(name, category);
+		}
+
+		~TraceSpan() { if (tracer != NULL) tracer->end(name, category); }
+	};
+}
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef __TRACE_OUTPUTTER_H__
+#define __TRACE_OUTPUTTER_H__
+
+#include <string>
+#include <sstream>
+#include <iostream>
+#include "listener.h"
+#include "trace.h"
+
+namespace unittest
+{
+	/** @brief Writes a Chrome trace event JSON file of the run.
+	 *
+	 *  The suite, each fixture and each test is a span, on the thread that
+	 * ran it, and each failed assertion an instant.  A fixture's span holds
+	 * "setup", from its start to its first test, "tests" and "teardown",
+	 * from its last test to its end.  While it exists it is the current
+	 * Tracer, so rows run in parallel show up as spans on their workers.
+	 * Nothing is written until the suite is done.  Open the file in
+	 * chrome://tracing or Perfetto. */
+	class TraceOutputter : public Listener
+	{
+		/** The stream the trace is written to. */
+		std::ostream &out;
+
+		Tracer tracer;
+
+		/** The running fixture, and when it started. */
+		std::string fixture;
+		uint64_t fixture_start;
+
+		/** When the fixture's first test started and its last test ended.
+		 * Tests may run on other threads, so these are set atomically. */
+		volatile uint64_t first_test, last_test;
+
+	public:
+		/** Constructs an outputter that writes to the given stream. */
+		TraceOutputter(std::ostream &_out = std::cout):out(_out), fixture_start(0), first_test(0), last_test(0)
+		{
+			Tracer::current() = &tracer;
+		}
+
+		~TraceOutputter()
+		{
+			if (Tracer::current() == &tracer) Tracer::current() = NULL;
+		}
+
+		/** Handles event catches. */
+		virtual void OnEvent(Event &e)
+		{
+			Listener::OnEvent(e);
+
+			if (e.pass) return;
+
+			std::ostringstream args;
+			args << "\"file\": \"" << Tracer::escape(e.filename) << "\", \"line\": " << e.line_num
+			     << ", \"msg\": \"" << Tracer::escape(e.msg) << "\"";
+
+			tracer.instant(e.expr, "failure", args.str());
+		}
+
+		/** Called when the suite is about to start. */
+		virtual void OnSuiteStart()
+		{
+			tracer.begin("suite", "suite");
+		}
+
+		/** When a fixture is starting, this is called. */
+		virtual void OnFixtureStart(const std::string &name)
+		{
+			fixture = name;
+			fixture_start = tracer.now();
+			first_test = last_test = 0;
+
+			tracer.begin(name, "fixture");
+		}
+
+		virtual void OnTestStart(const std::string &name)
+		{
+			__sync_bool_compare_and_swap(&first_test, 0, tracer.now());
+			tracer.begin(name, "test");
+		}
+
+		virtual void OnTestDone(const std::string &name)
+		{
+			tracer.end(name, "test");
+
+			uint64_t done = tracer.now(), last;
+			while ((last = last_test) < done && !__sync_bool_compare_and_swap(&last_test, last, done)) {}
+		}
+
+		/** When a fixture is done with all it's tests, this is called. */
+		virtual void OnFixtureDone()
+		{
+			uint64_t done = tracer.now();
+
+			if (first_test != 0)
+			{
+				tracer.complete("setup", "fixture", fixture_start, first_test);
+				tracer.complete("tests", "fixture", first_test, last_test);
+				tracer.complete("teardown", "fixture", last_test, done);
+			}
+
+			tracer.end(fixture, "fixture");
+		}
+
+		/** When a suite is done with all it's tests, this is called. */
+		virtual void OnSuiteDone()
+		{
+			Listener::OnSuiteDone();
+
+			tracer.end("suite", "suite");
+
+			tracer.json(out);
+			out.flush();
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef __TEST_UNITTEST_H__
+#define __TEST_UNITTEST_H__
+
+#include <unittest/assertions.h>
+#include <unittest/allocations.h>
+#include <unittest/arrays.h>
+#include <unittest/benchmark.h>
+#include <unittest/golden.h>
+#include <unittest/instruments.h>
+#include <unittest/perf_counters.h>
+#include <unittest/values.h>
+#include <unittest/suite.h>
+#include <unittest/outputters.h>
+#include <unittest/repeat.h>
+#include <unittest/registration.h>
+#include <unittest/daemon.h>
+#include <unittest/coverage.h>
+#include <unittest/journal.h>
+#include <unittest/distributed.h>
+#include <iostream>
+
+/* Tests written with the macros alone name themselves at run time, rather
+ * than having unittest.py define their name. */
+#ifndef __TEST_NAME__
+#define __TEST_NAME__ __ut_test_name__
+#endif
+
+namespace unittest
+{
+	/** Registers the fixtures, and any globals, of a test binary with the suite. */
+	typedef void (*Registration)(Suite &suite);
+
+	/** The main function of a test binary: parses the options and runs the
+	 * fixtures that registration gives the suite, as they ask.  output and
+	 * async_output are the outputters used when --output and --async-output
+	 * are not given. */
+	inline int runMain(int argc, char *argv[], MultiListener &outputter,
+	                   Registration registration = registerFixtures,
+	                   const std::string &output = "compiler", bool async_output = false)
+	{
+		Options &options = getOptions();
+		options.parse(argc, argv);
+
+#ifndef _WIN32
+		if (options.has("daemon")) return Daemon(options.get("daemon"), options.arguments()).serve();
+		if (options.has("connect") && options.has("list")) return runRemote(options.get("connect"), "list " + options.get("tests"), outputter, std::cout);
+#endif
+
+		registration(getSuite());
+		getSuite().select(options.get("tests"));
+
+#ifndef _WIN32
+		if (!startImpact(getSuite())) return 0;
+#endif
+
+		if (options.has("list"))
+		{
+			getSuite().list(std::cout);
+			return 0;
+		}
+
+		getSuite().setFreshFixtures(options.has("fresh-fixtures"));
+		if (options.has("shuffle")) getSuite().setShuffle(runSeed());
+		if (options.has("perf-counters")) registerInstrument(&getPerfInstrument());
+
+#ifndef _WIN32
+		if (options.has("worker")) return Worker(getSuite(), outputter, options.get("worker")).serve();
+#endif
+
+		Outputters outputters(outputter, options.get("plugin-path"));
+		if (!outputters.select(options.get("output", output),
+		                       options.get("async-output", async_output ? "1" : "0") != "0")) return 1;
+
+#ifndef _WIN32
+		if (options.has("connect")) return runRemote(options.get("connect"), "run " + options.get("tests"), outputter, std::cerr);
+		if (!startJournal(getSuite(), outputter)) return 1;
+		if (options.has("workers") || options.has("coordinate"))
+			return Coordinator(getSuite(), outputter).run(options.get("coordinate"), options.getInt("workers"));
+#endif
+
+		if (repeating(options)) Repeater(getSuite(), outputter).run();
+		else getSuite().runTests();
+
+#ifndef _WIN32
+		finishImpact();
+#endif
+		return 0;
+	}
+}
+
+/**
+ * \def UT_MAIN
+ * Defines the suite and the main function of a test binary whose fixtures
+ * are written with the macros.  Put it in exactly one source file. */
+#define UT_MAIN() \
+	static unittest::MultiListener& ut_outputter() \
+	{ \
+		static unittest::MultiListener listener; \
+		return listener; \
+	} \
+	unittest::Suite& unittest::getSuite() \
+	{ \
+		static unittest::Suite suite(ut_outputter()); \
+		return suite; \
+	} \
+	int main(int argc, char *argv[]) { return unittest::runMain(argc, argv, ut_outputter()); }
+
+/**
+ * \def UT_MODULE
+ * Makes a shared object of the fixtures written with the macros, for
+ * run_tests --daemon to load, in place of UT_MAIN(). */
+#define UT_MODULE() \
+	extern "C" void unittest_register_module(unittest::Suite &suite) { unittest::registerFixtures(suite); }
+
+#endif
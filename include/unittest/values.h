@@ -0,0 +1,271 @@
+#ifndef __TEST_VALUES_H__
+#define __TEST_VALUES_H__
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include "config.h"
+
+namespace unittest
+{
+	/** @brief Tells types that can be written to a std::ostream from those
+	 * that can not.
+	 *
+	 *  Anything converts to Unstreamable, so the operator<< below matches any
+	 * type, but it loses to a real operator<< because its stream is const. */
+	namespace streamable
+	{
+		struct Yes { char size[1]; };
+		struct No { char size[2]; };
+
+		struct Unstreamable
+		{
+			template<class T> Unstreamable(const T &) {}
+		};
+
+		No operator<<(const std::ostream &, const Unstreamable &);
+
+		Yes& test(std::ostream &);
+		No test(No);
+
+		template<class T>
+		struct Check
+		{
+			static std::ostream &out;
+			static const T &value;
+
+			enum { yes = sizeof(test(out << value)) == sizeof(Yes) };
+		};
+	}
+
+	/** Writes a value with operator<<, or "{?}" if it has none. */
+	template<class T, bool Streamable = streamable::Check<T>::yes>
+	struct StreamToString
+	{
+		static std::string convert(const T &value)
+		{
+			std::ostringstream out;
+			out << value;
+			return out.str();
+		}
+	};
+
+	template<class T>
+	struct StreamToString<T, false>
+	{
+		static std::string convert(const T &) { return "{?}"; }
+	};
+
+	/** @brief Turns an operand into text for a failure message.
+	 *
+	 *  Used only when an assertion fails.  Specialize it to show your own
+	 * types, for example:
+	 *
+	 *  template<> struct unittest::ToString<Point>
+	 *  { static std::string convert(const Point &p) { ... } };
+	 *
+	 *  By default operator<< is used if there is one. */
+	template<class T>
+	struct ToString : public StreamToString<T> {};
+
+	template<>
+	struct ToString<bool>
+	{
+		static std::string convert(bool value) { return value ? "true" : "false"; }
+	};
+
+	/** Characters are quoted, unless they do not print. */
+	template<class T>
+	struct CharToString
+	{
+		static std::string convert(T value)
+		{
+			std::ostringstream out;
+
+			if (value >= 32 && value < 127) out << '\'' << char(value) << '\'';
+			else out << int(value);
+
+			return out.str();
+		}
+	};
+
+	template<> struct ToString<char> : public CharToString<char> {};
+	template<> struct ToString<signed char> : public CharToString<signed char> {};
+	template<> struct ToString<unsigned char> : public CharToString<unsigned char> {};
+
+	/** Floating point values are shown with every digit that matters. */
+	template<class T>
+	struct FloatToString
+	{
+		static std::string convert(T value)
+		{
+			std::ostringstream out;
+			out << std::setprecision(std::numeric_limits<T>::digits10 + 2) << value;
+			return out.str();
+		}
+	};
+
+	template<> struct ToString<float> : public FloatToString<float> {};
+	template<> struct ToString<double> : public FloatToString<double> {};
+	template<> struct ToString<long double> : public FloatToString<long double> {};
+
+	/** Strings are quoted. */
+	template<>
+	struct ToString<std::string>
+	{
+		static std::string convert(const std::string &value) { return "\"" + value + "\""; }
+	};
+
+	template<>
+	struct ToString<const char *>
+	{
+		static std::string convert(const char *value) { return value ? "\"" + std::string(value) + "\"" : "NULL"; }
+	};
+
+	template<> struct ToString<char *> : public ToString<const char *> {};
+	template<size_t N> struct ToString<char[N]> : public ToString<const char *> {};
+	template<size_t N> struct ToString<const char[N]> : public ToString<const char *> {};
+
+	/** Returns the text for a value, through ToString. */
+	template<class T>
+	std::string toString(const T &value) { return ToString<T>::convert(value); }
+
+	/** @brief A literal 0 or NULL given to UT_ASSERT_EQUALS.
+	 *
+	 *  Passed to a template, 0 or NULL would be an integer that no pointer
+	 * compares with, so the assertion passes it on as this instead. */
+	struct NullLiteral {};
+
+	template<> struct ToString<NullLiteral>
+	{
+		static std::string convert(NullLiteral) { return "0"; }
+	};
+
+	/** @brief Tells a null pointer constant from any other operand.
+	 *
+	 *  Only a null pointer constant converts to a pointer to Secret. */
+	namespace null_literal
+	{
+		struct Secret;
+
+		char test(Secret *);
+		char (&test(...))[2];
+
+		/** Passes an operand on as it is, or as a NullLiteral. */
+		template<bool IsNull> struct Operand
+		{
+			template<class T> static const T &pass(const T &value) { return value; }
+		};
+
+		template<> struct Operand<true>
+		{
+			static NullLiteral pass(Secret *) { return NullLiteral(); }
+		};
+	}
+
+	/** Tells if a value is negative, without comparing an unsigned one with 0. */
+	template<class T, bool Signed = std::numeric_limits<T>::is_signed>
+	struct Sign
+	{
+		static bool negative(const T &value) { return value < T(0); }
+	};
+
+	template<class T>
+	struct Sign<T, false>
+	{
+		static bool negative(const T &) { return false; }
+	};
+
+	/** @brief Compares operands with == and <, but integers of mixed sign by
+	 * their values.
+	 *
+	 *  The usual conversions would make a negative integer a large unsigned
+	 * one, and warn with -Wsign-compare. */
+	template<class A, class B, bool MixedSign = std::numeric_limits<A>::is_integer && std::numeric_limits<B>::is_integer &&
+	                                            std::numeric_limits<A>::is_signed != std::numeric_limits<B>::is_signed>
+	struct Compare
+	{
+		static bool equal(const A &a, const B &b) { return a == b; }
+		static bool less(const A &a, const B &b) { return a < b; }
+	};
+
+	template<class A, class B>
+	struct Compare<A, B, true>
+	{
+		static bool equal(const A &a, const B &b)
+		{
+			if (Sign<A>::negative(a) || Sign<B>::negative(b)) return false;
+			return uint64_t(a) == uint64_t(b);
+		}
+
+		static bool less(const A &a, const B &b)
+		{
+			if (Sign<A>::negative(a) || Sign<B>::negative(b)) return Sign<A>::negative(a);
+			return uint64_t(a) < uint64_t(b);
+		}
+	};
+
+	/** @brief The comparisons of the binary assertions.
+	 *
+	 *  A NullLiteral, from 0 or NULL, equals a null pointer or a zero. */
+	struct Equal
+	{
+		static const char *name() { return " == "; }
+
+		template<class A, class B> bool operator()(const A &a, const B &b) const { return Compare<A, B>::equal(a, b); }
+		template<class A> bool operator()(const A &a, NullLiteral) const { return a == 0; }
+		template<class B> bool operator()(NullLiteral, const B &b) const { return b == 0; }
+		bool operator()(NullLiteral, NullLiteral) const { return true; }
+	};
+
+	struct Less
+	{
+		static const char *name() { return " < "; }
+
+		template<class A, class B> bool operator()(const A &a, const B &b) const { return Compare<A, B>::less(a, b); }
+	};
+
+	struct Greater
+	{
+		static const char *name() { return " > "; }
+
+		template<class A, class B> bool operator()(const A &a, const B &b) const { return Compare<B, A>::less(b, a); }
+	};
+
+	/** @brief Compares two operands, each evaluated once into the parameters.
+	 *
+	 *  Only if the comparison fails are they turned into text, in values. */
+	template<class Op, class A, class B>
+	bool checkValues(const A &a, const B &b, Op op, std::string &values)
+	{
+		if (op(a, b)) return true;
+
+		values = toString(a) + Op::name() + toString(b);
+		return false;
+	}
+
+	/** Checks UT_ASSERT_NEAR. */
+	template<class A, class B, class E>
+	bool checkNear(const A &a, const B &b, const E &epsilon, std::string &values)
+	{
+		if (std::abs(a - b) < epsilon) return true;
+
+		values = toString(a) + " near " + toString(b) + " by " + toString(epsilon);
+		return false;
+	}
+
+	/** Checks UT_ASSERT_FLOAT_NEAR. */
+	template<class A, class B, class E>
+	bool checkFloatNear(const A &a, const B &b, const E &epsilon, std::string &values)
+	{
+		if (std::fabs(a - b) < epsilon) return true;
+
+		values = toString(a) + " near " + toString(b) + " by " + toString(epsilon);
+		return false;
+	}
+}
+
+#endif
@@ -1,9 +1,12 @@
 #ifndef __XML_OUTPUTTER_H__
 #define __XML_OUTPUTTER_H__
 
+#include <map>
 #include <vector>
+#include <string>
 #include <iostream>
 #include "listener.h"
+#include "options.h"
 
 namespace unittest
 {
@@ -13,52 +16,87 @@ namespace unittest
 		/** The type for event lists. */
 		typedef std::vector<Event> event_list;
 		
-		/** The list of events processed. */
+		/** The list of failing events processed. */
 		event_list events;
 		
+		/** A metric reported for a test. */
+		struct Metric
+		{
+			std::string test, name;
+			double value;
+		};
+		
+		/** The metrics reported, in order. */
+		std::vector<Metric> metrics;
+		
+		/** The stream the output is written to. */
+		std::ostream &out;
+		
 	public:
+		/** Constructs an outputter that writes to the given stream. */
+		XmlOutputter(std::ostream &_out = std::cout):out(_out) {}
 	
 		/** Handles event catches. */		
 		virtual void OnEvent(Event &e)
 		{
 			Listener::OnEvent(e);	
 			
-			events.push_back(e);
-			
-			if (e.pass) std::cout << ".";
-			else		std::cout << "f";						
+			if (!e.pass) events.push_back(e);
 		}
 		
-		/** When a fixture is done with all it's tests, this is called. */
-		virtual void OnFixtureDone()
+		/** Keeps metrics, such as benchmark results. */
+		virtual void OnMetric(const std::string &test, const std::string &name, double value)
 		{
-			Listener::OnFixtureDone();	
-			
-			std::cout << std::endl;
+			Metric m;
+			m.test = test;
+			m.name = name;
+			m.value = value;
+			metrics.push_back(m);
 		}
 		
 		/** When a suite is done with all it's tests, this is called. */
 		virtual void OnSuiteDone()
 		{
 			Listener::OnSuiteDone();				
+			Summary s = getSummary();
 			
-			std::cout << std::endl << std::endl;
+			out << "<?xml version=\"1.0\"?>" << std::endl << "<results>" << std::endl;
 			
 			for(event_list::iterator pos=events.begin(); pos!=events.end(); ++pos)
 			{
-				if (!(pos->pass))
-				{
-					std::cout << "<error filename=\""pos->filename << "\" line=\"" << pos->line_num << "\">" << std::endl 
-						      << "  <expr>" << pos->expr << "</expr>" << std::endl
-						      << "  <msg>"  << pos->msg  << "</msg>" << std::endl
-						      << "</error>" << std::endl;
-				}					 
+				out << "<error filename=\"" << pos->filename << "\" line=\"" << pos->line_num << "\">" << std::endl 
+					<< "  <expr>" << pos->expr << "</expr>" << std::endl
+					<< "  <msg>"  << pos->msg  << "</msg>" << std::endl
+					<< "</error>" << std::endl;
 			}
 			
-			std::cout << std::endl << "<summary "
+			std::streamsize precision = out.precision(12);
+			
+			for(std::vector<Metric>::iterator pos=metrics.begin(); pos!=metrics.end(); ++pos)
+			{
+				out << "<metric test=\"" << pos->test << "\" name=\"" << pos->name
+					<< "\" value=\"" << pos->value << "\" />" << std::endl;
+			}
+			
+			out.precision(precision);
+			
+			std::map<std::string, Summary> tests = getTestSummaries();
+			
+			for(std::map<std::string, Summary>::iterator pos=tests.begin(); pos!=tests.end(); ++pos)
+			{
+				out << "<test name=\"" << pos->first << "\" failures=\"" << pos->second.failures
+					<< "\" passes=\"" << pos->second.passes << "\" event_count=\"" << pos->second.event_count << "\" />" << std::endl;
+			}
+			
+			out << "<summary "
 				 << "failures=\""  << s.failures << "\" " << std::endl
 				 << "passes=\""    << s.passes   << "\" " << std::endl
-				 << "event_count=\"" << s.event_count << "\" />" << std::endl << std::endl;			
+				 << "event_count=\"" << s.event_count << "\"";
+			
+			if (getOptions().has("seed")) out << " " << std::endl << "seed=\"" << getOptions().get("seed") << "\"";
+			
+			out << " />" << std::endl
+				 << "</results>" << std::endl;			
 		}
 		
 	};
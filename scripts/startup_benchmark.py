@@ -0,0 +1,111 @@
+#!/usr/bin/python
+#
+# Measures how long a test binary takes to start: generates a suite of many
+# fixtures, builds it, and times running it with --list and with a single
+# test, against an empty program.
+
+import sys
+import os
+import os.path
+import time
+import tempfile
+import shutil
+
+fixture_count=200
+test_count=20
+runs=200
+keep=0
+
+def print_help():
+   print "\nstartup benchmark for unittest test binaries\n"
+   print "\t--fixtures=n     the number of fixtures to generate (200)"
+   print "\t--tests=n        the number of tests in each fixture (20)"
+   print "\t--runs=n         the number of times each command is run (200)"
+   print "\t--keep           leaves the generated suite in place"
+   print
+
+def run(cmd):
+   if os.system(cmd)!=0:
+      print "startup benchmark: '%s' failed" % cmd
+      sys.exit(1)
+
+def gen_suite(work):
+   "Writes fixture_count .test files of test_count tests each."
+
+   names = []
+
+   for f in range(fixture_count):
+      name = "F%d.test" % f
+      outf = open(os.path.join(work, name), "w")
+
+      outf.write("UT_FIXTURE(F%d)\n" % f)
+      outf.write("\tint value;\n\n")
+      outf.write("\tUT_SETUP_FIXTURE\n")
+      outf.write("\t\tvalue = %d;\n" % f)
+      outf.write("\tUT_SETUP_FIXTURE_END\n\n")
+
+      for t in range(test_count):
+         outf.write("\tUT_TEST(t%d)\n" % t)
+         outf.write("\t\tUT_ASSERT_EQUALS(value, %d);\n" % f)
+         outf.write("\tUT_TEST_END\n\n")
+
+      outf.write("UT_FIXTURE_END\n")
+      outf.close()
+
+      names.append(name)
+
+   return names
+
+def time_command(cmd):
+   "Returns the mean time of one run of cmd, in milliseconds."
+
+   start = time.time()
+
+   for i in range(runs):
+      run(cmd)
+
+   return (time.time() - start) * 1000.0 / runs
+
+
+for arg in sys.argv[1:]:
+   switch = arg.split("=")
+
+   if switch[0]=="--fixtures": fixture_count = int(switch[1])
+   elif switch[0]=="--tests": test_count = int(switch[1])
+   elif switch[0]=="--runs": runs = int(switch[1])
+   elif switch[0]=="--keep": keep = 1
+   else:
+      print_help()
+      sys.exit(0)
+
+script_dir = os.path.dirname(os.path.abspath(sys.argv[0]))
+include_dir = os.path.normpath(os.path.join(script_dir, "..", "include"))
+work = tempfile.mkdtemp(prefix="ut_startup_")
+cwd = os.getcwd()
+
+try:
+   os.chdir(work)
+
+   names = gen_suite(work)
+   run("%s %s --include-path=%s --build=unix %s > /dev/null" % (sys.executable, os.path.join(script_dir, "unittest.py"), include_dir, " ".join(names)))
+   run("sh build_tests.sh > /dev/null 2>&1")
+
+   outf = open("empty.cpp", "w")
+   outf.write("int main() { return 0; }\n")
+   outf.close()
+   run("g++ -O2 empty.cpp -o empty")
+
+   empty = time_command("./empty")
+   listing = time_command("./run_tests --list > /dev/null")
+   single = time_command("./run_tests --tests=F%d::t0 > /dev/null" % (fixture_count / 2))
+
+   print "%d fixtures of %d tests, %d runs each" % (fixture_count, test_count, runs)
+   print "empty program:     %8.3f ms" % empty
+   print "--list:            %8.3f ms (%+.3f)" % (listing, listing - empty)
+   print "one test:          %8.3f ms (%+.3f)" % (single, single - empty)
+
+finally:
+   os.chdir(cwd)
+
+   if keep: print "suite left in", work
+   else: shutil.rmtree(work)
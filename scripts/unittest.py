@@ -7,18 +7,34 @@ import re
 import os.path
 import glob
 import popen2
+import time
+import struct
+import select
 
 depth=0
 curline=0
 curfilename=""
 gen_build_type=0
-gen_output_type=0
+gen_outputs=[]
+async_output=0
 test_is_inline=0
 inline_embed=0
 preprocess=0
+track_allocations=0
+gen_module=0
+watch=0
+impact=0
 fixtures = []
+globals_list = []
+property_info = None
+test_p_info = None
+fixture_fresh = 0
 tests = []
+test_lines = []
 filenames = []
+sources = []
+source_fixtures = {}
+source_globals = {}
 includes = []
 libs = []
 lib_paths = []
@@ -36,6 +52,25 @@ teardown_fixture_re =      re.compile(r"UT_TEARDOWN_FIXTURE")
 setup_fixture_end_re =     re.compile(r"UT_SETUP_FIXTURE_END")
 teardown_fixture_end_re =  re.compile(r"UT_TEARDOWN_FIXTURE_END")
 
+setup_test_re =            re.compile(r"UT_SETUP_TEST")
+teardown_test_re =         re.compile(r"UT_TEARDOWN_TEST")
+setup_test_end_re =        re.compile(r"UT_SETUP_TEST_END")
+teardown_test_end_re =     re.compile(r"UT_TEARDOWN_TEST_END")
+
+fresh_fixture_re =         re.compile(r"UT_FRESH_FIXTURE")
+
+test_p_re  =      re.compile(r"UT_TEST_P\((?P<args>.*)\)")
+table_re   =      re.compile(r"UT_TABLE\((?P<args>.*)\)")
+table_end_re =    re.compile(r"UT_TABLE_END")
+
+property_re =     re.compile(r"UT_PROPERTY\((?P<args>.*)\)")
+property_end_re = re.compile(r"UT_PROPERTY_END")
+
+global_re =       re.compile(r"UT_GLOBAL\((?P<name>(\w)+)\)")
+global_end_re =   re.compile(r"UT_GLOBAL_END")
+
+alloc_assert_re = re.compile(r"UT_ASSERT_(NO_ALLOC|MAX_ALLOCS)")
+
 header_re =       re.compile("UT_INCLUDE\((?P<filename>([^)]+))\)")
 def_header_re =   re.compile("UT_DEFAULT_INCLUDE\((?P<filename>([^)]+))\)")
 src_include_re =  re.compile("UT_SOURCE_INCLUDE\((?P<filename>([^)]+))\)")
@@ -49,6 +84,9 @@ include_re = re.compile(r'#include\s*\"\s*(?P<name>[^"]+)\"')
 
 lib_find_version_re = re.compile(r"[0-9]+\.[0-9]+")
 
+# The outputters known to the test binary.  Other names are loaded as plugins.
+output_types = ["compiler", "xml", "html", "junit", "binary", "trace", "gtk"]
+
 
 # Matches inline stuff like class myObject /* %startUnitTest*/ or class myObject // %startUnitTest
 inline_fixture_re = re.compile(r"class (?P<name>[a-zA-Z0-9_]+)[^%]*%startFixture")
@@ -60,10 +98,20 @@ inline_test_start_re = re.compile(r"%test\((?P<name>(\w+))\)")
 inline_embed_start_re = re.compile(r"%{")
 # Matches inline end embed.
 inline_embed_end_re = re.compile(r"%}")
+# Matches inline %testP(name, source)
+inline_test_p_start_re = re.compile(r"%testP\((?P<args>.*)\)")
+# Matches inline %property(name, input = generator, ...)
+inline_property_start_re = re.compile(r"%property\((?P<args>.*)\)")
 # Inline setup
 inline_setup_fixture_re = re.compile("%setup")
 # Inline teardown
 inline_teardown_fixture_re = re.compile("%teardown")
+# Inline per test setup
+inline_setup_test_re = re.compile("%setupTest")
+# Inline per test teardown
+inline_teardown_test_re = re.compile("%teardownTest")
+# Inline fresh fixture
+inline_fresh_fixture_re = re.compile("%freshFixture")
 
 class LineCountingFile:
    def __init__(self):
@@ -109,6 +157,24 @@ class MutableFileStore:
 def print_error(lineno, msg):
    print "error:%d:%s" % (lineno, msg)
    
+# Splits a macro argument list on the commas that are not inside brackets.
+def split_args(args):
+   result=[]
+   depth=0
+   item=""
+   for c in args:
+      if c in "([{<": depth+=1
+      elif c in ")]}>": depth-=1
+      
+      if c==',' and depth==0:
+         result.append(item.strip())
+         item=""
+      else:
+         item+=c
+         
+   if item.strip()!="": result.append(item.strip())
+   return result
+   
 # Parses out some group of characters, obeying escapes.
 def parse_group(line, start_pos, start_grp, end_grp):
    started=0
@@ -371,13 +437,28 @@ def find_gtk():
          
            
    
+def gen_uses_gtk():
+   "Returns 1 if one of the outputs is the Gtk GUI."
+   for item in gen_outputs:
+      if item.split(":", 1)[0]=="gtk": return 1
+   return 0
+   
 def gen_fixture(name, outf):
-   # Special support for Gtk output
-   if gen_output_type==3:
-      outf.write("#include <gtk/gtk.h>\n#include <gtk/gtkmain.h>\n")
+   global fixture_fresh
+   
+   fixture_fresh = 0
    
-   # The rest of the fixture.   
    outf.write("#include <unittest/assertions.h>\n")
+   outf.write("#include <unittest/allocations.h>\n")
+   outf.write("#include <unittest/arrays.h>\n")
+   outf.write("#include <unittest/benchmark.h>\n")
+   outf.write("#include <unittest/golden.h>\n")
+   outf.write("#include <unittest/instruments.h>\n")
+   outf.write("#include <unittest/perf_counters.h>\n")
+   outf.write("#include <unittest/property.h>\n")
+   outf.write("#include <unittest/registration.h>\n")
+   outf.write("#include <unittest/rows.h>\n")
+   outf.write("#include <unittest/values.h>\n")
    outf.write("#include <unittest/suite.h>\n\n")   
    outf.write("class test_%s : public unittest::Fixture\n" % name)
    outf.write("{\n");
@@ -388,32 +469,60 @@ def gen_fixture(name, outf):
    outf.write("\n");
    
 def gen_fixture_end(name, outf):
-   global suite_f, fixtures, tests, gen_output_type
+   global suite_f, fixtures, tests, test_lines
    
-   outf.write("\tvirtual void runTests()\n")
+   # The entry in the fixture table names the fixture and its tests without
+   # making it, so nothing is made until it runs.
+   outf.write("\tstatic unittest::Fixture *make()\n")
    outf.write("\t{\n")
+   outf.write("\t\ttest_%s *fixture = new test_%s;\n" % (name, name))
+   if fixture_fresh: outf.write("\t\tfixture->setFresh(true);\n")
+   outf.write("\t\treturn fixture;\n")
+   outf.write("\t}\n\n")
+   outf.write("\tstatic unsigned int tests() { return %d; }\n\n" % len(tests))
+   outf.write("\tstatic const char *test(unsigned int index)\n")
+   outf.write("\t{\n")
+   outf.write("\t\tstatic const char *const names[] = { %s };\n" % (", ".join(['"%s"' % t for t in tests]) or '""'))
+   outf.write("\t\treturn names[index];\n")
+   outf.write("\t}\n\n")
    
-   # Save the number of tests in this fixture.
-   outf.write("\t\t__total_tests__ = %d;\n" % len(tests))
-   outf.write("\t\t__current_test__ = 0;\n")
-   
-   outf.write("\t\tsetup();\n\n")
+   # The table of tests, so they can be run one at a time and in any order.
+   outf.write("\tvirtual unsigned int testCount() const { return %d; }\n\n" % len(tests))
+   outf.write("\tvirtual const char *testName(unsigned int index) const\n")
+   outf.write("\t{\n")
+   outf.write("\t\tstatic const char *const names[] = { %s };\n" % (", ".join(['"%s::%s"' % (name, t) for t in tests]) or '""'))
+   outf.write("\t\treturn names[index];\n")
+   outf.write("\t}\n\n")
+   outf.write("\tvirtual unittest::Fixture *create() const { return new test_%s; }\n\n" % name)
    
-   for testname in tests:         
-      # Call test
-      outf.write("\t\ttest_%s();\n" % testname)
-      outf.write("\t\t++__current_test__;\n")
-      
-      
-   outf.write("\n\t\tteardown();\n")
+   # Run one test, with the per test setup and teardown around it.
+   outf.write("\tvirtual void runTest(unsigned int index)\n")
+   outf.write("\t{\n")
+   outf.write("\t\t__total_tests__ = %d;\n" % len(tests))
+   outf.write("\t\t__current_test__ = index;\n\n")
+   outf.write("\t\tstatic const char *const sources[] = { %s };\n" % (", ".join(['"%s"' % f for l, f in test_lines]) or '""'))
+   outf.write("\t\tstatic const unsigned int lines[] = { %s };\n" % (", ".join(['%d' % l for l, f in test_lines]) or '0'))
+   outf.write("\t\tunittest::TestRun run(listener, testName(index), sources[index], lines[index]);\n")
+   outf.write("\t\tunittest::ListenerGuard guard(listener, &run);\n\n")
+   outf.write("\t\tUT_TEST_TRY\n")
+   outf.write("\t\t{\n")
+   outf.write("\t\t\tsetupTest();\n\n")
+   outf.write("\t\t\tswitch(index)\n")
+   outf.write("\t\t\t{\n")
+   
+   i = 0
+   for testname in tests:
+      outf.write("\t\t\tcase %d: test_%s(); break;\n" % (i, testname))
+      i+=1
+      
+   outf.write("\t\t\t}\n\n")
+   outf.write("\t\t\tteardownTest();\n")
+   outf.write("\t\t}\n")
+   outf.write("\t\tUT_TEST_CATCH(run)\n")
    outf.write("\t}\n\n")
    
    outf.write("};\n\n")
-   outf.write("static test_%s the_fixture;\n\n" % name)
-   outf.write("void registerFixture_%s()\n" % name)
-   outf.write("{\n")
-   outf.write("\tunittest::getSuite().registerFixture(&the_fixture);\n")
-   outf.write("}\n\n")
+   outf.write("UT_FIXTURE_ENTRY(%s, &test_%s::make, &test_%s::tests, &test_%s::test)\n\n" % (name, name, name, name))
    
    fixtures.append(name)      
    
@@ -423,14 +532,141 @@ def gen_test_main(fix_name, test_name, outf):
    outf.write("\tvoid test_%s()\n" % test_name);
    outf.write("\t{\n");
    outf.write("\t\tunittest::Event __event__;\n")
-   outf.write('\t\t#define __TEST_NAME__ "%s::%s";\n\n' % (fix_name, test_name))
+   outf.write('\t\t#define __TEST_NAME__ "%s::%s"\n\n' % (fix_name, test_name))
    
    tests.append(test_name)
+   test_lines.append((curline, curfilename))
    
 def gen_test_end(name, outf):
+   global test_p_info
+   
    outf.write('\t\t#undef __TEST_NAME__\n')
    outf.write("\t}\n\n");
    
+   if test_p_info!=None and test_p_info[1]==name:
+      gen_test_p_end(outf)
+      test_p_info = None
+   
+def gen_test_p_main(fix_name, args, outf):
+   "Starts a test run once for every row of a source.  The body gets the row as 'row'."
+   global tests, test_p_info
+   
+   items = split_args(args)
+   if len(items)<2:
+      print_error(curline, "UT_TEST_P needs a name and a source")
+      items.append("unittest::TableRows<int>(0, 0)")
+      
+   name = items[0]
+   parallel = 0
+   if len(items)>2 and items[2]=="parallel": parallel = 1
+   
+   outf.write("\ttemplate<class Row>\n")
+   outf.write("\tvoid row_%s(unittest::Listener *listener, const Row &row, size_t row_num)\n" % name);
+   outf.write("\t{\n");
+   outf.write("\t\tunittest::Event __event__;\n")
+   outf.write('\t\t#define __TEST_NAME__ "%s::%s"\n\n' % (fix_name, name))
+   
+   test_p_info = (fix_name, name, items[1], parallel, curline, curfilename)
+   tests.append(name)
+   test_lines.append((curline, curfilename))
+   
+   return name
+   
+def gen_test_p_end(outf):
+   "Writes the test that runs the rows of a UT_TEST_P."
+   
+   fix_name, name, source, parallel, line, filename = test_p_info
+   
+   outf.write("\tvoid test_%s()\n" % name);
+   outf.write("\t{\n");
+   outf.write("\t\tunittest::Event __event__;\n\n")
+   outf.write('\t\t__event__.expr = "rows of %s";\n' % name)
+   outf.write('#line %d "%s"\n' % (line, filename))
+   outf.write('\t\t__event__.filename = __FILE__ "::%s::%s"; __event__.line_num = __LINE__;\n' % (fix_name, name))
+   outf.write('#line %d "%s"\n' % (outf.curline+2, outf.filename))
+   outf.write("\t\t__event__.total_tests = __total_tests__;\n")
+   outf.write("\t\t__event__.current_test = __current_test__;\n\n")
+   outf.write("\t\tunittest::runRows(*this, &test_%s::row_%s, %s, listener, %s, __event__);\n" % 
+              (fix_name, name, source, ["false", "true"][parallel]))
+   outf.write("\t}\n\n")
+   
+# The most generators a property may have.
+max_property_inputs = 4
+
+def gen_property_main(fix_name, args, outf):
+   "Starts a property.  The body becomes a static function of its inputs."
+   global tests, property_info
+   
+   items = split_args(args)
+   name = items[0]
+   inputs = []
+   
+   for item in items[1:]:
+      split_pos = item.find('=')
+      if split_pos<0:
+         print_error(curline, "property input '%s' should be name = generator" % item)
+         continue
+         
+      gen = item[split_pos+1:].strip()
+      
+      # The generator type is the expression up to its constructor arguments.
+      paren = gen.find('(')
+      if paren<0: 
+         gen_type = gen
+         gen = gen + "()"
+      else:
+         gen_type = gen[0:paren].strip()
+         
+      inputs.append((item[0:split_pos].strip(), gen_type, gen))
+      
+   if len(inputs)>max_property_inputs:
+      print_error(curline, "a property may have at most %d inputs" % max_property_inputs)
+      inputs = inputs[0:max_property_inputs]
+      
+   params = ["std::string &__why__"]
+   for input_name, gen_type, gen in inputs:
+      params.append("const %s::value_type &%s" % (gen_type, input_name))
+      
+   for i in range(len(inputs), max_property_inputs):
+      params.append("const unittest::Nothing &")
+      
+   outf.write("\tstatic bool property_%s(%s)\n" % (name, ", ".join(params)))
+   outf.write("\t{\n")
+   outf.write("\t\t(void)__why__;\n")
+   
+   property_info = (fix_name, name, inputs, curline, curfilename)
+   tests.append(name)
+   test_lines.append((curline, curfilename))
+   
+   return name
+   
+def gen_property_end(name, outf):
+   "Ends a property, and writes the test that checks it."
+   global property_info
+   
+   fix_name, name, inputs, line, filename = property_info
+   
+   gens = []
+   for input_name, gen_type, gen in inputs: gens.append(gen)
+   for i in range(len(inputs), max_property_inputs): gens.append("unittest::Nothing()")
+   
+   outf.write("\t\treturn true;\n")
+   outf.write("\t}\n\n")
+   
+   outf.write("\tvoid test_%s()\n" % name);
+   outf.write("\t{\n");
+   outf.write("\t\tunittest::Event __event__;\n\n")
+   outf.write('\t\t__event__.expr = "property %s";\n' % name)
+   outf.write('#line %d "%s"\n' % (line, filename))
+   outf.write('\t\t__event__.filename = __FILE__ "::%s::%s"; __event__.line_num = __LINE__;\n' % (fix_name, name))
+   outf.write('#line %d "%s"\n' % (outf.curline+2, outf.filename))
+   outf.write("\t\t__event__.total_tests = __total_tests__;\n")
+   outf.write("\t\t__event__.current_test = __current_test__;\n\n")
+   outf.write('\t\tunittest::checkProperty(__event__, &property_%s, "%s",\n' % (name, ",".join([i[0] for i in inputs])))
+   outf.write("\t\t                        %s);\n" % ", ".join(gens))
+   outf.write("\t\tlistener->OnEvent(__event__);\n")
+   outf.write("\t}\n\n")
+   
 def gen_header(filename, defheader, outf):
    if defheader!=0: outf.write('#include <%s>\n' % filename)
    else:           outf.write('#include "%s"\n' % filename)
@@ -442,6 +678,16 @@ def gen_setup_teardown(func_name, outf):
 def gen_setup_teardown_end(outf):
    outf.write("\t}\n")
    
+# The macros that start each kind of setup and teardown block.
+block_names = { "setup" : "UT_SETUP_FIXTURE", "teardown" : "UT_TEARDOWN_FIXTURE",
+                "setupTest" : "UT_SETUP_TEST", "teardownTest" : "UT_TEARDOWN_TEST" }
+
+# The macros that end them.
+block_ends = [ (setup_test_end_re, "UT_SETUP_TEST_END", "setupTest"),
+               (teardown_test_end_re, "UT_TEARDOWN_TEST_END", "teardownTest"),
+               (setup_fixture_end_re, "UT_SETUP_FIXTURE_END", "setup"),
+               (teardown_fixture_end_re, "UT_TEARDOWN_FIXTURE_END", "teardown") ]
+   
 def scan_in_setup_teardown_fixture(fixture_name, func_name, inf, outf):
    "Scans for valid macros in a setup or teardown."
    
@@ -463,20 +709,13 @@ def scan_in_setup_teardown_fixture(fixture_name, func_name, inf, outf):
             gen_setup_teardown_end(outf)  
             return;
       
-      if setup_fixture_end_re.match(line)!=None: 
-         gen_setup_teardown_end(outf)
-         if func_name=="teardown":
-            print_error(curline, "UT_TEARDOWN_FIXTURE_END in UT_SETUP_FIXTURE")
-         return
-         
-      if teardown_fixture_end_re.match(line)!=None: 
-         gen_setup_teardown_end(outf)
-         if func_name=="setup":
-            print_error(curline, "UT_SETUP_FIXTURE_END in UT_TEARDOWN_FIXTURE")
-         return
-         
-            
-      
+      # Check the per test ends first, UT_SETUP_TEST_END is not a fixture end.
+      for end_re, end_name, end_func in block_ends:
+         if end_re.match(line)!=None: 
+            gen_setup_teardown_end(outf)
+            if func_name!=end_func:
+               print_error(curline, "%s in %s" % (end_name, block_names[func_name]))
+            return
          
       # Just shovel the code into the output
       
@@ -486,11 +725,11 @@ def scan_in_setup_teardown_fixture(fixture_name, func_name, inf, outf):
       
       
       
-   print_error(curline, "End of file without UT_%s_FIXTURE_END" % func_name.upper())   
+   print_error(curline, "End of file without %s_END" % block_names[func_name])   
 
          
-def scan_in_test(fixture_name, test_name, inf, outf):
-   "Scans for valid macros in a test."
+def scan_in_test(fixture_name, test_name, inf, outf, is_property=0):
+   "Scans for valid macros in a test, or the body of a property."
    
    global curline
          
@@ -506,7 +745,12 @@ def scan_in_test(fixture_name, test_name, inf, outf):
       if test_is_inline:
          if inline_embed_start_re.search(line)!=None: continue 
       
-      if test_end_re.match(line)!=None or inline_embed_end_re.search(line)!=None: 
+      if is_property:
+         if property_end_re.match(line)!=None or inline_embed_end_re.search(line)!=None: 
+            gen_property_end(test_name, outf)
+            return
+            
+      elif test_end_re.match(line)!=None or inline_embed_end_re.search(line)!=None: 
          gen_test_end(test_name, outf)
          return
          
@@ -516,15 +760,17 @@ def scan_in_test(fixture_name, test_name, inf, outf):
       outf.write('#line %d "%s"\n' % (outf.curline+2, outf.filename))      
       
       
-   print_error(curline, "End of file without UT_TEST_END")  
+   if is_property: print_error(curline, "End of file without UT_PROPERTY_END")  
+   else: print_error(curline, "End of file without UT_TEST_END")  
    
    
 def scan_in_fixture(fixture_name, inf, outf):
    "Scans for valid macros in a fixture."
    
-   global curline, tests, test_is_inline, inline_embed
+   global curline, tests, test_lines, test_is_inline, inline_embed, fixture_fresh
    
    tests = []
+   test_lines = []
    
    while not inf.eof(): 
       line=inf.readline()
@@ -543,6 +789,34 @@ def scan_in_fixture(fixture_name, inf, outf):
             scan_in_test(fixture_name, tname, inf, outf)
             continue
             
+         r = inline_test_p_start_re.search(line)
+         if r != None:
+            tname = gen_test_p_main(fixture_name, r.group('args'), outf)
+            scan_in_test(fixture_name, tname, inf, outf)
+            continue
+            
+         r = inline_property_start_re.search(line)
+         if r != None:
+            tname = gen_property_main(fixture_name, r.group('args'), outf)
+            scan_in_test(fixture_name, tname, inf, outf, 1)
+            continue
+            
+         r = inline_setup_test_re.search(line)
+         if r != None:        
+            gen_setup_teardown("setupTest", outf)
+            scan_in_setup_teardown_fixture(fixture_name, "setupTest", inf, outf)
+            continue
+            
+         r = inline_teardown_test_re.search(line)
+         if r != None:        
+            gen_setup_teardown("teardownTest", outf)
+            scan_in_setup_teardown_fixture(fixture_name, "teardownTest", inf, outf)
+            continue
+            
+         if inline_fresh_fixture_re.search(line) != None:
+            fixture_fresh = 1
+            continue
+            
          r = inline_setup_fixture_re.search(line)
          if r != None:        
             gen_setup_teardown("setup", outf)
@@ -573,6 +847,18 @@ def scan_in_fixture(fixture_name, inf, outf):
             scan_in_test(fixture_name, tname, inf, outf)
             continue
             
+         r = test_p_re.search(line)
+         if r != None:
+            tname = gen_test_p_main(fixture_name, r.group('args'), outf)
+            scan_in_test(fixture_name, tname, inf, outf)
+            continue
+            
+         r = property_re.search(line)
+         if r != None:
+            tname = gen_property_main(fixture_name, r.group('args'), outf)
+            scan_in_test(fixture_name, tname, inf, outf, 1)
+            continue
+            
          r = setup_fixture_re.search(line)
          if r != None:        
             gen_setup_teardown("setup", outf)
@@ -585,6 +871,22 @@ def scan_in_fixture(fixture_name, inf, outf):
             scan_in_setup_teardown_fixture(fixture_name, "teardown", inf, outf)                          
             continue    
             
+         r = setup_test_re.search(line)
+         if r != None:        
+            gen_setup_teardown("setupTest", outf)
+            scan_in_setup_teardown_fixture(fixture_name, "setupTest", inf, outf)
+            continue
+            
+         r = teardown_test_re.search(line)
+         if r != None:        
+            gen_setup_teardown("teardownTest", outf)
+            scan_in_setup_teardown_fixture(fixture_name, "teardownTest", inf, outf)
+            continue
+            
+         if fresh_fixture_re.search(line) != None:
+            fixture_fresh = 1
+            continue
+            
       if fixture_end_re.search(line)!=None or inline_fixture_end_re.search(line)!=None:
          gen_fixture_end(fixture_name, outf)
          return      
@@ -601,6 +903,95 @@ def scan_in_fixture(fixture_name, inf, outf):
    
    
 
+def gen_global(name, outf):
+   outf.write("#include <unittest/values.h>\n")
+   outf.write("#include <unittest/suite.h>\n\n")
+   outf.write("class global_%s : public unittest::Global\n" % name)
+   outf.write("{\n")
+   outf.write("public:\n\n")
+   outf.write('\tglobal_%s():Global("%s") {}\n' % (name, name))
+   outf.write("\n")
+   
+def gen_global_end(name, outf):
+   global globals_list
+   
+   outf.write("};\n\n")
+   outf.write("static global_%s the_global_%s;\n\n" % (name, name))
+   
+   # Fixtures only get to read it.
+   outf.write("static const global_%s &%s = the_global_%s;\n\n" % (name, name, name))
+   outf.write("void registerGlobal_%s(unittest::Suite &suite)\n" % name)
+   outf.write("{\n")
+   outf.write("\tsuite.registerGlobal(&the_global_%s);\n" % name)
+   outf.write("}\n\n")
+   
+   globals_list.append(name)
+   
+def scan_in_global(global_name, inf, outf):
+   "Scans for valid macros in a global."
+   
+   global curline
+   
+   while not inf.eof(): 
+      line=inf.readline()
+      curline+=1;
+            
+      line=line.strip()
+      
+      check_depth(line)    
+      check_errors()    
+      
+      r = setup_fixture_re.search(line)
+      if r != None:        
+         gen_setup_teardown("setup", outf)
+         scan_in_setup_teardown_fixture(global_name, "setup", inf, outf)
+         continue
+         
+      r = teardown_fixture_re.search(line)
+      if r != None:        
+         gen_setup_teardown("teardown", outf)
+         scan_in_setup_teardown_fixture(global_name, "teardown", inf, outf)                          
+         continue    
+         
+      if global_end_re.search(line)!=None:
+         gen_global_end(global_name, outf)
+         return      
+         
+      # Just shovel the code into the output
+      outf.write('#line %d "%s"\n' % (curline, curfilename))
+      outf.write("\t%s\n" % line);      
+      outf.write('#line %d "%s"\n' % (outf.curline+2, outf.filename))
+      
+   print_error(curline, "End of file without UT_GLOBAL_END")
+   
+def scan_in_table(args, inf, outf):
+   "Copies the rows of an inline table into a static array."
+   
+   global curline
+   
+   items = split_args(args)
+   if len(items)!=2:
+      print_error(curline, "UT_TABLE needs a row type and a name")
+      return
+      
+   outf.write("static const %s %s[] =\n{\n" % (items[0], items[1]))
+   
+   while not inf.eof(): 
+      line=inf.readline()
+      curline+=1;
+            
+      line=line.strip()
+      
+      if table_end_re.match(line)!=None or inline_embed_end_re.search(line)!=None:
+         outf.write("};\n\n")
+         return
+         
+      outf.write('#line %d "%s"\n' % (curline, curfilename))
+      outf.write("\t%s\n" % line);      
+      outf.write('#line %d "%s"\n' % (outf.curline+2, outf.filename))
+      
+   print_error(curline, "End of file without UT_TABLE_END")
+   
 def gen_test(inf, outf):
    "Generates the test code for a test."
    global depth, curline, includes, test_is_inline, inline_embed
@@ -631,6 +1022,19 @@ def gen_test(inf, outf):
          scan_in_fixture(r.group('name'), inf, outf)
          continue
          
+      # Check for an inline table
+      r = table_re.search(line)
+      if r != None:
+         scan_in_table(r.group('args'), inf, outf)
+         continue
+         
+      # Check for a global declaration
+      r = global_re.search(line)
+      if r != None:
+         gen_global(r.group('name'), outf)
+         scan_in_global(r.group('name'), inf, outf)
+         continue
+         
       # Check for an inline fixture declaration
       r = inline_fixture_re.search(line)
       if r != None:
@@ -674,76 +1078,88 @@ def gen_test(inf, outf):
       
    if depth!=0: print_error(curline, "Missing a right brace '}'")
 
-def gen_outputter():
-   global gen_output_type, suite_f
-   
-   if gen_output_type==0:
-      suite_f.write("CompilerOutputter");
-   elif gen_output_type==1:
-      suite_f.write("XmlOutputter");
-   elif gen_output_type==2:
-      suite_f.write("HtmlOutputter");
-   elif gen_output_type==3:
-      suite_f.write("GtkOutputter");
-      
-def gen_outputter_include():
-   global gen_output_type, suite_f
-   
-   if gen_output_type==0:
-      suite_f.write("compiler_outputter.h");
-   elif gen_output_type==1:
-      suite_f.write("xml_outputter.h");
-   elif gen_output_type==2:
-      suite_f.write("html_outputter.h");
-   elif gen_output_type==3:
-      suite_f.write("gtk_outputter.h");
-
-
+def gen_daemon():
+   "Writes the source of a test binary without fixtures, to load modules with --daemon."
+   
+   text = ""
    
+   # Modules use the daemon's operator new, so it is replaced here.
+   if track_allocations: text += "#define UT_TRACK_ALLOCATIONS\n"
+   
+   text += "#include <unittest/unittest.h>\n\n"
+   text += "UT_MAIN()\n"
+   
+   # Left alone if it has not changed, so the build script need not rebuild the daemon.
+   if os.path.exists("test_daemon.cpp"):
+      inf = open("test_daemon.cpp", "r")
+      old = inf.read()
+      inf.close()
+      
+      if old == text: return
+      
+   outf = open("test_daemon.cpp", "w")
+   outf.write(text)
+   outf.close()
+
 def gen_suite():
    global suite_f
    
    suite_f = open("test_suite.cpp", "w");
    
-   suite_f.write("#include <unittest/suite.h>\n")
-   suite_f.write("#include <unittest/"); gen_outputter_include(); suite_f.write(">\n\n")
+   # A module only registers its fixtures; the daemon that loads it does the rest.
+   if gen_module:
+      suite_f.write("#include <unittest/suite.h>\n")
+      suite_f.write("#include <unittest/registration.h>\n\n")
+      gen_daemon()
+      return
    
-   suite_f.write("unittest::"); gen_outputter(); suite_f.write(" outputter;\n")
-   suite_f.write("unittest::Suite test_suite(outputter);\n")
+   # Replacing operator new has to happen in exactly one file.
+   if track_allocations: suite_f.write("#define UT_TRACK_ALLOCATIONS\n")
+      
+   # So does the coverage callback, in the one file built without coverage.
+   if impact: suite_f.write("#define UT_TRACE_COVERAGE\n")
+   suite_f.write("#include <unittest/unittest.h>\n\n")
    
-   suite_f.write("unittest::Suite& unittest::getSuite() { return test_suite; }\n\n")
+   # Made on first use, so a binary that only lists its tests makes neither.
+   suite_f.write("static unittest::MultiListener& outputter()\n")
+   suite_f.write("{\n")
+   suite_f.write("\tstatic unittest::MultiListener listener;\n")
+   suite_f.write("\treturn listener;\n")
+   suite_f.write("}\n\n")
+   suite_f.write("unittest::Suite& unittest::getSuite()\n")
+   suite_f.write("{\n")
+   suite_f.write("\tstatic unittest::Suite suite(outputter());\n")
+   suite_f.write("\treturn suite;\n")
+   suite_f.write("}\n\n")
       
    
 def gen_suite_end():
    global suite_f, fixtures
    
-   # Write out externs for fixtures.
-   for f in fixtures:
-      suite_f.write("extern void registerFixture_%s();\n" % f)
+   # Write out externs for globals.  Fixtures are found in the fixture table.
+   for g in globals_list:
+      suite_f.write("extern void registerGlobal_%s(unittest::Suite &suite);\n" % g)
    
    # Create fixture registration function.
-   suite_f.write("static void\nregister_fixtures()\n{\n");
-   
-   for f in fixtures:
-      suite_f.write("\tregisterFixture_%s();\n" % f)
+   suite_f.write("static void\nregister_fixtures(unittest::Suite &suite)\n{\n");
    
+   for g in globals_list:
+      suite_f.write("\tregisterGlobal_%s(suite);\n" % g)
+      
+   suite_f.write("\tunittest::registerFixtures(suite);\n")
    suite_f.write("}\n\n")
    
-   # Main function
+   if gen_module:
+      suite_f.write('extern "C" void\nunittest_register_module(unittest::Suite &suite)\n{\n')
+      suite_f.write("\tregister_fixtures(suite);\n")
+      suite_f.write("}\n\n")
+      suite_f.close()
+      return
+   
+   # Main function.  Outputters are chosen at startup; the generator only sets the defaults.
    suite_f.write("int\nmain(int argc, char *argv[])\n")
    suite_f.write("{\n")
-   
-   # Initialize any GUI stuff
-   if gen_output_type==3: #gtk
-      suite_f.write("\tgtk_init(&argc, &argv);\n")
-      
-   suite_f.write("\tregister_fixtures();\n")
-   suite_f.write("\tunittest::getSuite().runTests();\n")
-   
-   # Some GUIs require a loop at the end
-   if gen_output_type==3: #gtk
-      suite_f.write("\tgtk_main();\n")
-   
+   suite_f.write('\treturn unittest::runMain(argc, argv, outputter(), register_fixtures, "%s", %s);\n' % (",".join(gen_outputs), async_output and "true" or "false"))
    suite_f.write("}\n\n")
    
    suite_f.close()
@@ -785,11 +1201,26 @@ def gen_buildfile_filenames(bf):
    bf.write("]\n\n")
 
 
+def gen_gtk_plugin_source():
+   "Returns the path of the Gtk outputter plugin source."
+   return os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "gui", "gtk+", "unittest_gtk.cpp"))
+
+def test_libraries():
+   "Returns the libraries needed by the test binary itself."
+   if is_unix: return "-ldl -lpthread -lrt"
+   else:       return "-lpthread"
+
 def gen_build_file():
-   global gen_build_type, gen_output_type
+   global gen_build_type
    
-   if gen_output_type==3:
+   if gen_uses_gtk():
       find_gtk()
+      
+   if (gen_module or impact) and gen_build_type!=1:
+      print "unittest warning: --module and --impact only write a build script with --build=unix"
+      return
+      
+   test_libs = test_libraries()
    
    if gen_build_type==0:
       bf = open("build_tests.bat", "w")
@@ -808,7 +1239,10 @@ def gen_build_file():
       
       bf.write("@g++ -mms-bitfields %TEST_INCLUDES% %TEST_LIB_PATHS% ")      
       gen_gcc_filenames(bf)
-      bf.write(" %TEST_LIBRARIES% -o run_tests.exe\n")
+      bf.write(" %s -o run_tests.exe\n" % test_libs)
+      
+      if gen_uses_gtk():
+         bf.write("@g++ -shared -mms-bitfields %%TEST_INCLUDES%% %%TEST_LIB_PATHS%% %s %%TEST_LIBRARIES%% -o unittest_gtk.dll\n" % gen_gtk_plugin_source())
       bf.close()
       
    elif gen_build_type==1:
@@ -821,10 +1255,25 @@ def gen_build_file():
       gen_libraries(bf)      
       bf.write('"\n')
       
-      bf.write("g++ -mms-bitfields $TEST_INCLUDES ")
+      if impact:
+         # Everything but the suite, which records the coverage, is built to report it.
+         bf.write("g++ -c -gdwarf-4 -fsanitize-coverage=trace-pc $TEST_INCLUDES %s\n" % " ".join([f for f in filenames if f!="test_suite.cpp"]))
+         bf.write("g++ -c $TEST_INCLUDES test_suite.cpp\n")
+         bf.write("g++ %s %s -o run_tests\n" % (" ".join([os.path.splitext(f)[0] + ".o" for f in filenames]), test_libs))
+      elif gen_module:
+         # The daemon is only rebuilt when unittest.py changes it.
+         bf.write("g++ -shared -fPIC $TEST_INCLUDES ")
+         gen_gcc_filenames(bf)
+         bf.write(" -o libtests.so\n")
+         bf.write("[ run_tests -nt test_daemon.cpp ] || g++ -rdynamic $TEST_INCLUDES test_daemon.cpp %s -o run_tests\n" % test_libs)
+      else:
+         bf.write("g++ -mms-bitfields $TEST_INCLUDES ")
+         
+         gen_gcc_filenames(bf)
+         bf.write(" %s -o run_tests\n" % test_libs)
       
-      gen_gcc_filenames(bf)
-      bf.write(" $TEST_LIBRARIES -o run_tests\n")
+      if gen_uses_gtk():
+         bf.write("g++ -shared -fPIC $TEST_INCLUDES %s $TEST_LIBRARIES -o libunittest_gtk.so\n" % gen_gtk_plugin_source())
       bf.close()  
       
    elif gen_build_type==2:
@@ -842,7 +1291,7 @@ def gen_build_file():
       bf.write('target="run_tests"\n\n')
       gen_buildfile_filenames(bf)
       bf.write('compile_cmd="g++ $(TEST_CFLAGS) -c $(IN) -o $(OUT)"\n')       
-      bf.write('link_cmd   ="g++ $(TEST_LIBRARIES) $(IN) -o %s" % target\n')
+      bf.write('link_cmd   ="g++ $(TEST_LIBRARIES) $(IN) %s -o %%s" %% target\n' % test_libs)
       bf.write('other_build_cmds = []\n')
       bf.write('clean_cmds =["build/*.o", target]\n')
       bf.write('install_cmds = {}\n')
@@ -977,11 +1426,221 @@ def replace_tokens2(inf):
    for search, replace in repl_tokens:
       inf.replaceRe(search, replace)
    
+# inotify events that mean a file has a new version.
+IN_CLOSE_WRITE = 0x008
+IN_MOVED_TO =    0x080
+IN_CREATE =      0x100
+
+class FileWatcher:
+   "Waits for files to change, with inotify if it can be had, or by polling them."
+   
+   def __init__(self):
+      self.files = {}
+      self.dirs = {}
+      self.fd = -1
+      
+      try:
+         import ctypes, ctypes.util
+         self.libc = ctypes.CDLL(ctypes.util.find_library("c"), use_errno=True)
+         self.fd = self.libc.inotify_init()
+      except:
+         self.fd = -1
+         
+   def setFiles(self, paths):
+      "Watches these files, and no others."
+      old = self.files
+      self.files = {}
+      
+      for p in paths:
+         p = os.path.abspath(p)
+         self.files[p] = old.get(p, self.mtime(p))
+         
+         d = os.path.dirname(p)
+         if self.fd>=0 and d not in self.dirs.values():
+            wd = self.libc.inotify_add_watch(self.fd, d, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+            if wd>=0: self.dirs[wd] = d
+            
+   def mtime(self, path):
+      try: return os.stat(path).st_mtime
+      except OSError: return 0
+      
+   def events(self, timeout):
+      "Returns the watched files named by the inotify events that arrive within timeout seconds."
+      changed = []
+      
+      while select.select([self.fd], [], [], timeout)[0]:
+         data = os.read(self.fd, 65536)
+         pos = 0
+         
+         while pos + 16 <= len(data):
+            wd, mask, cookie, size = struct.unpack("iIII", data[pos:pos+16])
+            name = data[pos+16:pos+16+size].rstrip("\0")
+            pos += 16 + size
+            
+            path = os.path.join(self.dirs.get(wd, ""), name)
+            if path in self.files: changed.append(path)
+            
+         # Editors save in several steps, so gather what follows closely.
+         timeout = 0.1
+         
+      return changed
+      
+   def wait(self):
+      "Waits until some of the files change, and returns them."
+      while 1:
+         if self.fd>=0: changed = self.events(None)
+         else:
+            time.sleep(0.5)
+            changed = [p for p in self.files.keys() if self.mtime(p)!=self.files[p]]
+            
+         for p in changed: self.files[p] = self.mtime(p)
+         
+         if changed: 
+            result = []
+            for p in changed:
+               if p not in result: result.append(p)
+            return result
+            
+def watch_flags():
+   "Returns the include paths, library paths and libraries to build with."
+   flags = " ".join(["-I%s" % os.path.normpath(i) for i in includes])
+   libraries = " ".join(["-L%s" % os.path.normpath(l) for l in lib_paths] + ["-l%s" % os.path.normpath(l) for l in libs])
+   return flags, libraries
+   
+def watch_object(cpp):
+   return os.path.splitext(cpp)[0] + ".o"
+   
+def watch_compile(cpp):
+   "Compiles one file to an object, noting the headers it includes in a .d file.  Returns true if it compiled."
+   flags, libraries = watch_flags()
+   if impact and cpp!="test_suite.cpp": flags += " -gdwarf-4 -fsanitize-coverage=trace-pc"
+   
+   print "unittest: compiling %s" % cpp
+   return os.system("g++ -c -MMD %s %s -o %s" % (flags, cpp, watch_object(cpp)))==0
+   
+def watch_link():
+   flags, libraries = watch_flags()
+   objects = " ".join([watch_object(f) for f in filenames])
+   return os.system("g++ %s %s %s -o run_tests" % (objects, libraries, test_libraries()))==0
+   
+def watch_deps(cpp):
+   "Returns the files an object was built from, as written to its .d file."
+   try:
+      inf = open(os.path.splitext(cpp)[0] + ".d", "r")
+      data = inf.read().replace("\\\n", " ")
+      inf.close()
+   except IOError:
+      return []
+      
+   return [os.path.abspath(d) for d in data.split()[1:]]
+   
+def watch_command(dirty, generated):
+   "Returns the command that runs the fixtures of the objects that were built again."
+   run = []
+   
+   for f in dirty:
+      built_from = [src for src in sources if generated[src]==f]
+      
+      # Anything but a fixture, such as a source under test, may affect every test.
+      if not built_from: return "./run_tests"
+      
+      for src in built_from: run += source_fixtures[src]
+      
+   if not run: return None
+   return "./run_tests --tests=%s" % ",".join(run)
+   
+def watch_tests():
+   "Builds and runs the tests, then does it again for the files that change."
+   global depth
+   
+   generated = {}
+   for src in sources: generated[src] = os.path.splitext(os.path.split(src)[1])[0] + "_test.cpp"
+   
+   outputs = [os.path.abspath(f) for f in generated.values() + ["test_suite.cpp"]]
+   
+   watcher = FileWatcher()
+   dirty = filenames[:]
+   command = "./run_tests"
+   
+   while 1:
+      failed = [f for f in dirty if not watch_compile(f)]
+      
+      if not failed and watch_link() and command: 
+         os.system(command)
+         
+      # Watch the inputs and everything they were built from, but not what is generated here.
+      watched = [os.path.abspath(src) for src in sources]
+      for f in filenames: watched += [d for d in watch_deps(f) if d not in outputs]
+      watcher.setFiles(watched)
+      
+      print "unittest: watching %d files, press Ctrl-C to stop" % len(watcher.files)
+      sys.stdout.flush()
+      
+      try: changed = watcher.wait()
+      except KeyboardInterrupt: return
+      
+      # Anything that failed to compile, and anything built from a changed file, is compiled again.
+      dirty = failed[:]
+      suite_state = (globals_list[:], track_allocations)
+      
+      for src in sources:
+         if os.path.abspath(src) not in changed: continue
+         
+         # Forget what the file defined, then generate it again.
+         for name in source_fixtures[src]: fixtures.remove(name)
+         for name in source_globals[src]: globals_list.remove(name)
+         
+         count = len(fixtures)
+         global_count = len(globals_list)
+         depth = 0
+         
+         try: gen_file(src)
+         except SystemExit: continue
+         
+         source_fixtures[src] = fixtures[count:]
+         source_globals[src] = globals_list[global_count:]
+         
+         if generated[src] not in dirty: dirty.append(generated[src])
+         
+      for f in filenames:
+         if f not in dirty and [d for d in watch_deps(f) if d in changed]: dirty.append(f)
+         
+      if (globals_list, track_allocations)!=suite_state:
+         gen_suite()
+         gen_suite_end()
+         if "test_suite.cpp" not in dirty: dirty.append("test_suite.cpp")
+         
+      command = watch_command(dirty, generated)
+      
 def print_help():
    print "\nunittest generator (C)opyright 2006 Christopher Nelson\n"
    print "\t--build=n     where n=unix, windows, or buildfile"
    print "\t--include-path=n where n is the path. e.g. ../../include"
-   print "\t--output=n       where n=compiler, xml, or html"
+   print "\t--output=n       where n is a comma separated list of compiler, xml,"
+   print "\t                 html, junit, binary, trace or gtk.  Each entry may"
+   print "\t                 name a file to write to, e.g."
+   print "\t                 --output=compiler,junit:results.xml"
+   print "\t                 This is only the default; run_tests --output=... or"
+   print "\t                 UT_OUTPUT=... selects outputters at startup."
+   print "\t--async-output   feeds outputters that write to files from a"
+   print "\t                 background thread by default"
+   print "\t--track-allocations  links a counting operator new into the test"
+   print "\t                 binary, and reports the allocations of every test."
+   print "\t                 On by default if UT_ASSERT_NO_ALLOC or"
+   print "\t                 UT_ASSERT_MAX_ALLOCS is used."
+   print "\t--module         builds the fixtures into libtests.so, for run_tests"
+   print "\t                 --daemon=socket libtests.so to keep loaded and run"
+   print "\t                 when asked by run_tests --connect=socket.  Unix only."
+   print "\t--watch          builds and runs the tests, then watches the .test"
+   print "\t                 files and the headers they include.  When one"
+   print "\t                 changes, only the files it affects are generated"
+   print "\t                 and compiled again, and only their fixtures run."
+   print "\t                 Unix only."
+   print "\t--impact         builds the tests to record the source files each"
+   print "\t                 test runs code from.  run_tests --impact=index"
+   print "\t                 writes them to index, and run_tests --impact=index"
+   print "\t                 --changed-files=a.cpp,b.h only runs the tests that"
+   print "\t                 ran code from those files.  Unix only."
    print "\t--preprocess     causes the generator preprocess the input so that"
    print "\t                 UT_REPLACE_XXX can be used.  Without this flag,"
    print "\t                 that directive will cause an error." 
@@ -992,62 +1651,9 @@ def print_help():
 version = "0.2";  
 suite_f = None;
 
-sys.argv.pop(0)
-input_files = sys.argv
-
-filenames.append("test_suite.cpp")
-
-for filename in input_files:  
-   if len(filename)>2:
-      if filename[0:2]=="--":       
-         switch = filename.split("=")        
-         if len(switch)<2 and switch[0]!="--preprocess":
-            print "Bad switch: ", filename, " requires value after the '='"
-            print_help()
-            sys.exit(0)
-            
-         switch[0] = switch[0].strip();
-         if (len(switch)>1): switch[1] = switch[1].strip();
-         
-            
-         if switch[0]=="--include-path":
-            includes.append(switch[1])
-            continue
-         elif switch[0]=="--build":
-            if switch[1] == "unix": gen_build_type=1
-            elif switch[1] == "windows": gen_build_type=0
-            elif switch[1] == "buildfile": gen_build_type=2
-            else:
-               print "error: Unknown build type for --build"
-               print_help()
-               sys.exit(0)
-               
-            continue
-            
-         elif switch[0]=="--output":
-            if switch[1] == "compiler": gen_output_type=0
-            elif switch[1] == "xml": gen_output_type=1
-            elif switch[1] == "html": gen_output_type=2
-            elif switch[1] == "gtk": gen_output_type=3
-            else:
-               print "error: Unknown output type for --output"
-               print_help()
-               sys.exit(0)
-            
-            continue
-            
-         elif switch[0]=="--preprocess":
-            preprocess=1
-            continue
-            
-   
-   files = glob.glob(filename)
-   if len(files)>1:
-      for file in files:
-         input_files.append(file)
-      continue
-      
-   filename = files[0]
+def gen_file(filename):
+   "Generates the _test.cpp file for one input file, and returns its name."
+   global curfilename, curline, test_is_inline, inline_embed, repl_inc_map, repl_tokens, track_allocations
    
    curfilename=filename
    curline=0
@@ -1058,12 +1664,14 @@ for filename in input_files:
    
    tmp = os.path.splitext(filename)
    out_name = os.path.split(tmp[0])[1] + "_test.cpp";
-   filenames.append(out_name)
    
    inf_tmp=open(filename, "r"); 
    data = inf_tmp.read()
    inf_tmp.close()
    
+   # Allocation assertions need the tracking operator new.
+   if alloc_assert_re.search(data): track_allocations=1
+   
    # Check for replacement directives.
    r = replace_include_re.search(data)
    if r!=None:
@@ -1098,7 +1706,102 @@ for filename in input_files:
    gen_test(inf,outf)
          
    outf.close()
+   
+   return out_name
+
+
+sys.argv.pop(0)
+input_files = sys.argv
+
+filenames.append("test_suite.cpp")
+
+for filename in input_files:  
+   if len(filename)>2:
+      if filename[0:2]=="--":       
+         switch = filename.split("=")        
+         if len(switch)<2 and switch[0] not in ("--preprocess", "--async-output", "--track-allocations", "--module", "--watch", "--impact"):
+            print "Bad switch: ", filename, " requires value after the '='"
+            print_help()
+            sys.exit(0)
+            
+         switch[0] = switch[0].strip();
+         if (len(switch)>1): switch[1] = switch[1].strip();
          
+            
+         if switch[0]=="--include-path":
+            includes.append(switch[1])
+            continue
+         elif switch[0]=="--build":
+            if switch[1] == "unix": gen_build_type=1
+            elif switch[1] == "windows": gen_build_type=0
+            elif switch[1] == "buildfile": gen_build_type=2
+            else:
+               print "error: Unknown build type for --build"
+               print_help()
+               sys.exit(0)
+               
+            continue
+            
+         elif switch[0]=="--output":
+            for item in switch[1].split(","):
+               item = item.strip()
+               if item.split(":", 1)[0] not in output_types:
+                  print "unittest warning: '%s' is not a built in output type, it will be loaded as a plugin" % item
+                  
+               gen_outputs.append(item.replace("\\", "/"))
+            
+            continue
+            
+         elif switch[0]=="--async-output":
+            async_output=1
+            continue
+            
+         elif switch[0]=="--preprocess":
+            preprocess=1
+            continue
+            
+         elif switch[0]=="--track-allocations":
+            track_allocations=1
+            continue
+            
+         elif switch[0]=="--module":
+            gen_module=1
+            continue
+            
+         elif switch[0]=="--watch":
+            watch=1
+            continue
+            
+         elif switch[0]=="--impact":
+            impact=1
+            continue
+            
+   
+   files = glob.glob(filename)
+   if len(files)>1:
+      for file in files:
+         input_files.append(file)
+      continue
+      
+   filename = files[0]
+   
+   sources.append(filename)
+   
+   count = len(fixtures)
+   global_count = len(globals_list)
+   filenames.append(gen_file(filename))
+   source_fixtures[filename] = fixtures[count:]
+   source_globals[filename] = globals_list[global_count:]
+         
+if len(gen_outputs)==0: gen_outputs.append("compiler")
+
 gen_suite()
 gen_suite_end()   
 gen_build_file()
+
+if watch:
+   if gen_module or not is_unix:
+      print "error: --watch only builds a test binary on Unix, without --module."
+      sys.exit(1)
+      
+   watch_tests()